@@ -0,0 +1,33 @@
+QT += core sql testlib
+
+TARGET = cgDataBench
+
+TEMPLATE = app
+
+# the benchmarks use the functional test's data model
+HEADERS += databench.h \
+	../test/comment.h \
+	../test/datatypes.h \
+	../test/post.h \
+	../test/tag.h \
+	../test/user.h \
+	../test/userprofile.h
+
+SOURCES += databench.cpp \
+	main.cpp \
+	../test/comment.cpp \
+	../test/post.cpp \
+	../test/tag.cpp \
+	../test/user.cpp \
+	../test/userprofile.cpp
+
+INCLUDEPATH += ../src ../test
+
+CONFIG(debug, debug|release) {
+    LIBS += -L../src/debug -lcgData0
+    PRE_TARGETDEPS += ../src/debug/cgData0.dll
+}
+else {
+    LIBS += -L../src/release -lcgData0
+    PRE_TARGETDEPS += ../src/release/cgData0.dll
+}
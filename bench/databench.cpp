@@ -0,0 +1,346 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "databench.h"
+#include "datamanager.h"
+#include "user.h"
+#include "post.h"
+#include "comment.h"
+#include "tag.h"
+#include "userprofile.h"
+
+#include <QFile>
+#include <QTest>
+
+using namespace cg;
+
+DataBench::DataBench()
+    : m_pDataManager(nullptr)
+{
+    m_rowCounts << 1000 << 100000 << 1000000;
+
+    QByteArray rows = qgetenv("CGDATA_BENCH_ROWS");
+    if (!rows.isEmpty())
+    {
+        m_rowCounts.clear();
+        for (auto & count : rows.split(','))
+            m_rowCounts.append(count.trimmed().toInt());
+    }
+}
+
+DataBench::~DataBench()
+{
+    delete m_pDataManager;
+}
+
+void DataBench::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+
+    QList<const QMetaObject*> metaObjects;
+    metaObjects << &User::staticMetaObject;
+    metaObjects << &Post::staticMetaObject;
+    metaObjects << &Comment::staticMetaObject;
+    metaObjects << &Tag::staticMetaObject;
+    metaObjects << &UserProfile::staticMetaObject;
+
+    m_pDataManager = new DataManager(metaObjects);
+    m_pDataManager->registerClass<User>();
+    m_pDataManager->registerClass<Post>();
+    m_pDataManager->registerClass<Comment>();
+    m_pDataManager->registerClass<Tag>();
+    m_pDataManager->registerClass<UserProfile>();
+
+    for (auto rows : m_rowCounts)
+    {
+        QVERIFY(m_pDataManager->open(databasePath(rows)));
+        populate(rows);
+        m_pDataManager->close();
+    }
+}
+
+void DataBench::cleanupTestCase()
+{
+    delete m_pDataManager;
+    m_pDataManager = nullptr;
+}
+
+void DataBench::cleanup()
+{
+    if (m_pDataManager)
+        m_pDataManager->close();
+}
+
+void DataBench::addRows()
+{
+    QTest::addColumn<int>("rows");
+
+    for (auto rows : m_rowCounts)
+        QTest::newRow(QByteArray::number(rows)) << rows;
+}
+
+QString DataBench::databasePath(int rows, bool scratch) const
+{
+    return m_directory.filePath(QString("bench%1%2.db").arg(rows).arg(scratch ? "_scratch" : ""));
+}
+
+bool DataBench::openDatabase(int rows, bool scratch)
+{
+    m_pDataManager->close();
+
+    // benchmarks that destroy data work on a copy
+    if (scratch)
+    {
+        QFile::remove(databasePath(rows, true));
+        if (!QFile::copy(databasePath(rows), databasePath(rows, true)))
+            return false;
+    }
+
+    return m_pDataManager->open(databasePath(rows, scratch));
+}
+
+void DataBench::populate(int rows)
+{
+    const int tagCount = 100;
+    const int batchSize = 10000;
+
+    m_pDataManager->beginTransaction();
+
+    Tags tags;
+    for (int i = 0; i < tagCount; i++)
+    {
+        TagPtr pTag = m_pDataManager->createObject<Tag>();
+        pTag->setName(QString("Tag%1").arg(i));
+        pTag->update();
+        tags.append(pTag);
+    }
+
+    for (int i = 0; i < rows; i++)
+    {
+        UserPtr pUser = m_pDataManager->createObject<User>();
+        pUser->init(QString("User%1").arg(i), QString("user%1@example.com").arg(i));
+        pUser->update();
+
+        PostPtr pPost = m_pDataManager->createObject<Post>();
+        pPost->init(pUser, QString("Post %1").arg(i), QString("The body of post %1.").arg(i));
+        pPost->update();
+        pPost->add("tags", tags.at(i % tagCount));
+
+        CommentPtr pComment = m_pDataManager->createObject<Comment>();
+        pComment->init(pUser, pPost, QString("Comment %1").arg(i));
+        pComment->update();
+
+        // bounded transactions, and no identity map growing with the database
+        if ((i + 1) % batchSize == 0)
+        {
+            m_pDataManager->commitTransaction();
+            m_pDataManager->clearObjects();
+            m_pDataManager->beginTransaction();
+        }
+    }
+
+    m_pDataManager->commitTransaction();
+    m_pDataManager->clearObjects();
+}
+
+void DataBench::benchmarkCreate_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkCreate()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows, true));
+
+    QBENCHMARK
+    {
+        UserPtr pUser = m_pDataManager->createObject<User>();
+        pUser->init("Bench", "bench@example.com");
+        pUser->update();
+    }
+}
+
+void DataBench::benchmarkUpdate_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkUpdate()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows, true));
+
+    UserPtr pUser = m_pDataManager->object<User>(rows / 2);
+    QVERIFY(pUser != nullptr);
+
+    int i = 0;
+    QBENCHMARK
+    {
+        pUser->setName(QString("User%1").arg(i++));
+        pUser->update();
+    }
+}
+
+void DataBench::benchmarkReadCold_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkReadCold()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows));
+
+    QBENCHMARK
+    {
+        m_pDataManager->clearObjects();
+        UserPtr pUser = m_pDataManager->object<User>(rows / 2);
+    }
+}
+
+void DataBench::benchmarkReadCached_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkReadCached()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows));
+
+    UserPtr pHeld = m_pDataManager->object<User>(rows / 2);
+    QVERIFY(pHeld != nullptr);
+
+    QBENCHMARK
+    {
+        UserPtr pUser = m_pDataManager->object<User>(rows / 2);
+    }
+}
+
+void DataBench::benchmarkAll_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkAll()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows));
+
+    QBENCHMARK
+    {
+        Users users = m_pDataManager->all<User>();
+    }
+}
+
+void DataBench::benchmarkFind_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkFind()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows));
+
+    QVariantMap map;
+    map.insert("name", QString("User%1").arg(rows / 2));
+
+    QBENCHMARK
+    {
+        Users users = m_pDataManager->find<User>(map);
+    }
+}
+
+void DataBench::benchmarkManyOneToMany_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkManyOneToMany()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows));
+
+    UserPtr pUser = m_pDataManager->object<User>(rows / 2);
+    QVERIFY(pUser != nullptr);
+
+    QBENCHMARK
+    {
+        Posts posts = pUser->many<Post>("posts");
+    }
+}
+
+void DataBench::benchmarkManyManyToMany_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkManyManyToMany()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows));
+
+    PostPtr pPost = m_pDataManager->object<Post>(rows / 2);
+    QVERIFY(pPost != nullptr);
+
+    QBENCHMARK
+    {
+        Tags tags = pPost->many<Tag>("tags");
+    }
+}
+
+void DataBench::benchmarkCascadeDelete_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkCascadeDelete()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows, true));
+
+    // measured once per size: deleting 100 users, each with a post and a comment
+    const int count = qMin(100, rows);
+
+    Users users;
+    for (int i = 0; i < count; i++)
+        users.append(m_pDataManager->object<User>(rows - i));
+
+    QBENCHMARK_ONCE
+    {
+        for (auto & pUser : users)
+            pUser->del();
+    }
+}
+
+void DataBench::benchmarkTextSearch_data()
+{
+    addRows();
+}
+
+void DataBench::benchmarkTextSearch()
+{
+    QFETCH(int, rows);
+    QVERIFY(openDatabase(rows));
+
+    QString text = QString::number(rows / 2);
+
+    QBENCHMARK
+    {
+        Posts posts = m_pDataManager->textSearch<Post>(text);
+    }
+}
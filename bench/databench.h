@@ -0,0 +1,79 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_DATABENCH_H
+#define CGDATA_DATABENCH_H
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QTemporaryDir>
+
+namespace cg
+{
+    class DataManager;
+}
+
+// Each benchmark runs against databases of 1e3, 1e5 and 1e6 users, each user with one post
+// and one comment, and every post tagged with one of 100 tags. The databases are built once
+// in a temporary directory and reopened per benchmark. CGDATA_BENCH_ROWS overrides the sizes
+// with a comma separated list.
+class DataBench : public QObject
+{
+    Q_OBJECT
+
+public:
+    DataBench();
+    ~DataBench();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void cleanup();
+
+    void benchmarkCreate_data();
+    void benchmarkCreate();
+    void benchmarkUpdate_data();
+    void benchmarkUpdate();
+    void benchmarkReadCold_data();
+    void benchmarkReadCold();
+    void benchmarkReadCached_data();
+    void benchmarkReadCached();
+    void benchmarkAll_data();
+    void benchmarkAll();
+    void benchmarkFind_data();
+    void benchmarkFind();
+    void benchmarkManyOneToMany_data();
+    void benchmarkManyOneToMany();
+    void benchmarkManyManyToMany_data();
+    void benchmarkManyManyToMany();
+    void benchmarkCascadeDelete_data();
+    void benchmarkCascadeDelete();
+    void benchmarkTextSearch_data();
+    void benchmarkTextSearch();
+
+private:
+    void addRows();
+    bool openDatabase(int rows, bool scratch = false);
+    void populate(int rows);
+    QString databasePath(int rows, bool scratch = false) const;
+
+private:
+    QTemporaryDir m_directory;
+    QList<int> m_rowCounts;
+    cg::DataManager *m_pDataManager;
+};
+
+#endif // CGDATA_DATABENCH_H
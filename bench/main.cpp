@@ -0,0 +1,31 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <QtTest/QTest>
+#include "databench.h"
+
+// Without output options the results are printed as text and written to cgDataBench.csv,
+// so runs can be compared between releases. Any testlib options replace these defaults.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    DataBench bench;
+
+    QStringList arguments = app.arguments();
+    if (arguments.size() == 1)
+        arguments << "-o" << "-,txt" << "-o" << "cgDataBench.csv,csv";
+
+    return QTest::qExec(&bench, arguments);
+}
@@ -1,10 +1,12 @@
 set QTDIR=D:\Qt\Qt5.9.1\5.9.1\msvc2015_64
 set VSDIR=C:\Program Files (x86)\Microsoft Visual Studio 14.0
 set QMAKESPEC=win32-msvc
+rem the SQLite that Qt's QSQLITE plugin was built against (configure -system-sqlite)
+set SQLITE_DIR=D:\sqlite
 
 call "%VSDIR%\VC\vcvarsall.bat" x64
 
-%QTDIR%\bin\qmake.exe -tp vc -r ../../cgData.pro
+%QTDIR%\bin\qmake.exe -tp vc -r ../../cgData.pro SQLITE_DIR=%SQLITE_DIR%
 
 set PATH=%PATH%;%QTDIR%\bin;%~dp0\src\debug
 
@@ -3,5 +3,9 @@ CONFIG += ordered
 
 SUBDIRS += src
 SUBDIRS += test
+SUBDIRS += bench
+SUBDIRS += generator
 
-test.depends = src
\ No newline at end of file
+test.depends = src
+bench.depends = src
+generator.depends = src
\ No newline at end of file
@@ -0,0 +1,377 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "datagenerator.h"
+#include "datamanager.h"
+#include "user.h"
+#include "post.h"
+#include "comment.h"
+#include "tag.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QtMath>
+#include <algorithm>
+
+using namespace cg;
+
+namespace
+{
+    const char *CommonWords[] = {
+        "the", "of", "and", "to", "a", "in", "is", "it", "you", "that", "he", "was", "for", "on",
+        "are", "with", "as", "his", "they", "be", "at", "one", "have", "this", "from", "or", "had",
+        "by", "not", "word", "but", "what", "some", "we", "can", "out", "other", "were", "all",
+        "there", "when", "up", "use", "your", "how", "said", "an", "each", "she", "which"
+    };
+
+    const char *Syllables[] = {
+        "ba", "be", "bo", "ca", "co", "da", "de", "di", "do", "fa", "fe", "ga", "go", "ha", "he",
+        "ka", "ki", "la", "le", "li", "lo", "ma", "me", "mi", "mo", "na", "ne", "ni", "no", "pa",
+        "pe", "po", "ra", "re", "ri", "ro", "sa", "se", "si", "so", "ta", "te", "ti", "to", "va",
+        "ve", "vi", "za", "zo", "ar", "en", "in", "or", "us", "ex", "ion", "ter", "ment", "ly", "ing"
+    };
+
+    const char *FirstNames[] = {
+        "Alice", "Bob", "Carol", "David", "Emma", "Frank", "Grace", "Henry", "Isla", "Jack",
+        "Karen", "Liam", "Maria", "Noah", "Olivia", "Paul", "Quinn", "Ruth", "Sam", "Tara"
+    };
+
+    const char *LastNames[] = {
+        "Smith", "Jones", "Brown", "Taylor", "Wilson", "Evans", "Thomas", "Roberts", "Walker", "Wright",
+        "Green", "Hall", "Wood", "Clarke", "Hughes", "Lewis", "Turner", "Hill", "Moore", "King"
+    };
+
+    template <class T, int N>
+    int arraySize(T (&)[N]) { return N; }
+
+    quint64 splitMix64(quint64 &state)
+    {
+        quint64 z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    quint64 rotateLeft(quint64 value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    QString capitalized(QString text)
+    {
+        if (!text.isEmpty())
+            text[0] = text.at(0).toUpper();
+        return text;
+    }
+}
+
+RandomGenerator::RandomGenerator(quint64 seed)
+{
+    for (auto & state : m_state)
+        state = splitMix64(seed);
+}
+
+quint64 RandomGenerator::next()
+{
+    quint64 result = rotateLeft(m_state[1] * 5, 7) * 9;
+    quint64 t = m_state[1] << 17;
+
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = rotateLeft(m_state[3], 45);
+
+    return result;
+}
+
+double RandomGenerator::real()
+{
+    // the top 53 bits fill a double's mantissa
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int RandomGenerator::bounded(int bound)
+{
+    if (bound <= 0)
+        return 0;
+
+    return qMin(int(real() * bound), bound - 1);
+}
+
+ZipfDistribution::ZipfDistribution()
+{
+}
+
+ZipfDistribution::ZipfDistribution(int count, double exponent)
+{
+    if (count <= 0)
+        return;
+
+    m_cdf.resize(count);
+
+    double total = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        total += 1.0 / qPow(i + 1, exponent);
+        m_cdf[i] = total;
+    }
+
+    for (auto & value : m_cdf)
+        value /= total;
+}
+
+int ZipfDistribution::sample(RandomGenerator &random) const
+{
+    if (m_cdf.isEmpty())
+        return 0;
+
+    auto it = std::upper_bound(m_cdf.begin(), m_cdf.end(), random.real());
+    return qMin(int(it - m_cdf.begin()), m_cdf.size() - 1);
+}
+
+GeneratorOptions::GeneratorOptions()
+    : seed(1),
+    users(1000),
+    followsPerUser(10),
+    maxPostsPerUser(50),
+    postExponent(1.2),
+    maxCommentsPerPost(20),
+    commentExponent(1.3),
+    tags(200),
+    tagsPerTopic(10),
+    tagsPerPost(3),
+    vocabularySize(5000),
+    batchSize(10000)
+{
+}
+
+double GeneratorReport::rowsPerSecond() const
+{
+    if (elapsedMilliseconds <= 0)
+        return 0.0;
+
+    return rows() * 1000.0 / elapsedMilliseconds;
+}
+
+DataGenerator::DataGenerator(const GeneratorOptions &options)
+    : m_options(options),
+    m_random(options.seed)
+{
+    createVocabulary();
+
+    int tagsPerTopic = qMax(1, m_options.tagsPerTopic);
+    int topicCount = (m_options.tags + tagsPerTopic - 1) / tagsPerTopic;
+
+    m_words = ZipfDistribution(m_vocabulary.size(), 1.0);
+    m_posts = ZipfDistribution(m_options.maxPostsPerUser + 1, m_options.postExponent);
+    m_comments = ZipfDistribution(m_options.maxCommentsPerPost + 1, m_options.commentExponent);
+    m_topics = ZipfDistribution(topicCount, 1.0);
+    m_topicTags = ZipfDistribution(qMin(tagsPerTopic, m_options.tags), 1.0);
+    m_tags = ZipfDistribution(m_options.tags, 1.0);
+}
+
+void DataGenerator::createVocabulary()
+{
+    // common English words take the most frequent ranks, made up words the long tail
+    QSet<QString> used;
+    for (int i = 0; i < arraySize(CommonWords); i++)
+    {
+        m_vocabulary.append(CommonWords[i]);
+        used.insert(CommonWords[i]);
+    }
+
+    int syllableCount = arraySize(Syllables);
+    while (m_vocabulary.size() < m_options.vocabularySize)
+    {
+        QString text;
+        int count = 2 + m_random.bounded(3);
+        for (int i = 0; i < count; i++)
+            text += Syllables[m_random.bounded(syllableCount)];
+
+        if (!used.contains(text))
+        {
+            m_vocabulary.append(text);
+            used.insert(text);
+        }
+    }
+}
+
+QString DataGenerator::word()
+{
+    return m_vocabulary.at(m_words.sample(m_random));
+}
+
+QString DataGenerator::words(int minCount, int maxCount)
+{
+    QStringList list;
+    int count = minCount + m_random.bounded(maxCount - minCount + 1);
+    for (int i = 0; i < count; i++)
+        list.append(word());
+
+    return list.join(' ');
+}
+
+QString DataGenerator::personName()
+{
+    return QString("%1 %2")
+        .arg(FirstNames[m_random.bounded(arraySize(FirstNames))])
+        .arg(LastNames[m_random.bounded(arraySize(LastNames))]);
+}
+
+QList<int> DataGenerator::postTags()
+{
+    QList<int> list;
+    if (m_options.tags <= 0 || m_options.tagsPerPost <= 0)
+        return list;
+
+    int tagsPerTopic = qMax(1, m_options.tagsPerTopic);
+    int topic = m_topics.sample(m_random);
+    int count = 1 + m_random.bounded(2 * m_options.tagsPerPost - 1);
+
+    // most tags come from the post's topic, which is what makes tags co-occur
+    for (int attempt = 0; list.size() < count && attempt < 4 * count; attempt++)
+    {
+        int tag;
+        if (m_random.real() < 0.8)
+            tag = topic * tagsPerTopic + m_topicTags.sample(m_random);
+        else
+            tag = m_tags.sample(m_random);
+
+        if (tag < m_options.tags && !list.contains(tag))
+            list.append(tag);
+    }
+
+    return list;
+}
+
+qint64 DataGenerator::popularUser()
+{
+    return m_attachment.at(m_random.bounded(m_attachment.size()));
+}
+
+GeneratorReport DataGenerator::populate(DataManager *pDataManager)
+{
+    GeneratorReport report = GeneratorReport();
+    if (!pDataManager || !pDataManager->isOpen())
+    {
+        qDebug() << "Error: DataGenerator::populate, database is not open.";
+        return report;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // followed users are looked up again and again; most of them are the popular few
+    int userCacheLimit = pDataManager->cacheLimit(&User::staticMetaObject);
+    DataManager::CacheCost userCacheCost = pDataManager->cacheCost(&User::staticMetaObject);
+    pDataManager->setCacheLimit(&User::staticMetaObject, 10000);
+
+    // large transactions are the fastest way in: one journal sync per batch
+    int batchSize = qMax(1, m_options.batchSize);
+    pDataManager->beginTransaction();
+
+    Tags tags;
+    int commonWordCount = arraySize(CommonWords);
+    for (int i = 0; i < m_options.tags; i++)
+    {
+        TagPtr pTag = pDataManager->createObject<Tag>();
+        int index = commonWordCount + i;
+        QString name = m_vocabulary.at(index % m_vocabulary.size());
+        if (index >= m_vocabulary.size())
+            name += QString::number(index / m_vocabulary.size());
+        pTag->setName(name);
+        pTag->update();
+        tags.append(pTag);
+        report.tags++;
+    }
+
+    for (int i = 0; i < m_options.users; i++)
+    {
+        UserPtr pUser = pDataManager->createObject<User>();
+        QString name = personName();
+        pUser->init(name, QString("%1.%2@example.com").arg(name.toLower().replace(' ', '.')).arg(i));
+        pUser->update();
+        report.users++;
+
+        // preferential attachment gives the follower counts a power-law tail
+        int follows = qMin(m_random.bounded(2 * m_options.followsPerUser + 1), i);
+        QSet<qint64> followees;
+        for (int attempt = 0; followees.size() < follows && attempt < 4 * follows; attempt++)
+        {
+            qint64 followeeId = popularUser();
+            if (followees.contains(followeeId))
+                continue;
+
+            UserPtr pFollowee = pDataManager->object<User>(followeeId);
+            if (pFollowee)
+            {
+                pFollowee->add("followers", pUser);
+                followees.insert(followeeId);
+                m_attachment.append(followeeId);
+                report.follows++;
+            }
+        }
+        m_attachment.append(pUser->id());
+
+        int postCount = m_posts.sample(m_random);
+        for (int j = 0; j < postCount; j++)
+        {
+            QStringList sentences;
+            int sentenceCount = 2 + m_random.bounded(5);
+            for (int k = 0; k < sentenceCount; k++)
+                sentences.append(capitalized(words(6, 18)) + ".");
+
+            PostPtr pPost = pDataManager->createObject<Post>();
+            pPost->init(pUser, capitalized(words(3, 8)), sentences.join(' '));
+            pPost->update();
+            report.posts++;
+
+            for (auto tag : postTags())
+            {
+                pPost->add("tags", tags.at(tag));
+                report.tagLinks++;
+            }
+
+            int commentCount = m_comments.sample(m_random);
+            for (int k = 0; k < commentCount; k++)
+            {
+                CommentPtr pComment = pDataManager->createObject<Comment>();
+                pComment->setBody(capitalized(words(3, 30)) + ".");
+                // setOne() only copies the id, which saves loading the commenter
+                pComment->setProperty("user", popularUser());
+                pComment->setOne("post", pPost);
+                pComment->update();
+                report.comments++;
+            }
+        }
+
+        if ((i + 1) % batchSize == 0)
+        {
+            pDataManager->commitTransaction();
+            pDataManager->clearObjects();
+            pDataManager->beginTransaction();
+        }
+    }
+
+    pDataManager->commitTransaction();
+    pDataManager->clearObjects();
+    pDataManager->setCacheLimit(&User::staticMetaObject, userCacheLimit, userCacheCost);
+
+    report.elapsedMilliseconds = timer.elapsed();
+    return report;
+}
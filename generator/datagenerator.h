@@ -0,0 +1,130 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_DATAGENERATOR_H
+#define CGDATA_DATAGENERATOR_H
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace cg
+{
+    class DataManager;
+}
+
+// xoshiro256** seeded through splitmix64, so a seed gives the same sequence on every
+// platform and Qt version.
+class RandomGenerator
+{
+public:
+    explicit RandomGenerator(quint64 seed);
+
+    quint64 next();
+    // uniform in [0, 1)
+    double real();
+    // uniform in [0, bound)
+    int bounded(int bound);
+
+private:
+    quint64 m_state[4];
+};
+
+// Zipf distribution over the ranks 0..count-1, where rank k has weight 1/(k+1)^exponent.
+class ZipfDistribution
+{
+public:
+    ZipfDistribution();
+    ZipfDistribution(int count, double exponent);
+
+    int count() const { return m_cdf.size(); }
+    int sample(RandomGenerator &random) const;
+
+private:
+    QVector<double> m_cdf;
+};
+
+struct GeneratorOptions
+{
+    GeneratorOptions();
+
+    quint64 seed;
+    int users;
+    // mean number of users each new user follows, chosen by preferential attachment
+    int followsPerUser;
+    // posts per user and comments per post are Zipf distributed over 0..max
+    int maxPostsPerUser;
+    double postExponent;
+    int maxCommentsPerPost;
+    double commentExponent;
+    // tags are grouped into topics; a post draws most of its tags from one topic
+    int tags;
+    int tagsPerTopic;
+    int tagsPerPost;
+    int vocabularySize;
+    // users per transaction
+    int batchSize;
+};
+
+struct GeneratorReport
+{
+    qint64 users;
+    qint64 follows;
+    qint64 posts;
+    qint64 comments;
+    qint64 tags;
+    qint64 tagLinks;
+    qint64 elapsedMilliseconds;
+
+    qint64 rows() const { return users + follows + posts + comments + tags + tagLinks; }
+    double rowsPerSecond() const;
+};
+
+// Populates an open database of the test model with a social network: a power-law follower
+// graph on User.followers, Zipf distributed posts per user and comments per post, clustered
+// tag co-occurrence, and titles and bodies drawn from a Zipf distributed vocabulary for text
+// search. The same options and seed always produce the same data in an empty database.
+class DataGenerator
+{
+public:
+    explicit DataGenerator(const GeneratorOptions &options = GeneratorOptions());
+
+    GeneratorReport populate(cg::DataManager *pDataManager);
+
+private:
+    void createVocabulary();
+    QString word();
+    QString words(int minCount, int maxCount);
+    QString personName();
+    QList<int> postTags();
+    qint64 popularUser();
+
+private:
+    GeneratorOptions m_options;
+    RandomGenerator m_random;
+    QStringList m_vocabulary;
+    ZipfDistribution m_words;
+    ZipfDistribution m_posts;
+    ZipfDistribution m_comments;
+    ZipfDistribution m_topics;
+    ZipfDistribution m_topicTags;
+    ZipfDistribution m_tags;
+    // one entry per user and one per follower, so uniform picks are proportional to followers + 1
+    QVector<qint64> m_attachment;
+};
+
+#endif // CGDATA_DATAGENERATOR_H
@@ -0,0 +1,34 @@
+QT += core sql
+
+TARGET = cgDataGenerator
+CONFIG += console
+
+TEMPLATE = app
+
+# the generated data uses the functional test's data model
+HEADERS += datagenerator.h \
+	../test/comment.h \
+	../test/datatypes.h \
+	../test/post.h \
+	../test/tag.h \
+	../test/user.h \
+	../test/userprofile.h
+
+SOURCES += datagenerator.cpp \
+	main.cpp \
+	../test/comment.cpp \
+	../test/post.cpp \
+	../test/tag.cpp \
+	../test/user.cpp \
+	../test/userprofile.cpp
+
+INCLUDEPATH += ../src ../test
+
+CONFIG(debug, debug|release) {
+    LIBS += -L../src/debug -lcgData0
+    PRE_TARGETDEPS += ../src/debug/cgData0.dll
+}
+else {
+    LIBS += -L../src/release -lcgData0
+    PRE_TARGETDEPS += ../src/release/cgData0.dll
+}
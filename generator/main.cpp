@@ -0,0 +1,120 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+#include "datagenerator.h"
+#include "datamanager.h"
+#include "user.h"
+#include "post.h"
+#include "comment.h"
+#include "tag.h"
+#include "userprofile.h"
+
+using namespace cg;
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("cgDataGenerator");
+
+    GeneratorOptions options;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Populates a database of the cgData test model with a synthetic social network.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("database", "The database file to create.");
+
+    QCommandLineOption seedOption("seed", "Random seed.", "seed", QString::number(options.seed));
+    QCommandLineOption usersOption("users", "Number of users.", "count", QString::number(options.users));
+    QCommandLineOption followsOption("follows", "Mean users followed per user.", "count", QString::number(options.followsPerUser));
+    QCommandLineOption postsOption("max-posts", "Most posts by one user.", "count", QString::number(options.maxPostsPerUser));
+    QCommandLineOption commentsOption("max-comments", "Most comments on one post.", "count", QString::number(options.maxCommentsPerPost));
+    QCommandLineOption tagsOption("tags", "Number of tags.", "count", QString::number(options.tags));
+    QCommandLineOption tagsPerPostOption("tags-per-post", "Mean tags per post.", "count", QString::number(options.tagsPerPost));
+    QCommandLineOption vocabularyOption("vocabulary", "Number of distinct words.", "count", QString::number(options.vocabularySize));
+    QCommandLineOption batchOption("batch", "Users per transaction.", "count", QString::number(options.batchSize));
+    QCommandLineOption overwriteOption("overwrite", "Replace an existing database.");
+    parser.addOptions({ seedOption, usersOption, followsOption, postsOption, commentsOption, tagsOption,
+        tagsPerPostOption, vocabularyOption, batchOption, overwriteOption });
+
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QString path = parser.positionalArguments().at(0);
+    if (QFile::exists(path))
+    {
+        if (!parser.isSet(overwriteOption))
+        {
+            err << path << " already exists, use --overwrite to replace it." << endl;
+            return 1;
+        }
+
+        QFile::remove(path);
+    }
+
+    options.seed = parser.value(seedOption).toULongLong();
+    options.users = parser.value(usersOption).toInt();
+    options.followsPerUser = parser.value(followsOption).toInt();
+    options.maxPostsPerUser = parser.value(postsOption).toInt();
+    options.maxCommentsPerPost = parser.value(commentsOption).toInt();
+    options.tags = parser.value(tagsOption).toInt();
+    options.tagsPerPost = parser.value(tagsPerPostOption).toInt();
+    options.vocabularySize = parser.value(vocabularyOption).toInt();
+    options.batchSize = parser.value(batchOption).toInt();
+
+    QList<const QMetaObject*> metaObjects;
+    metaObjects << &User::staticMetaObject;
+    metaObjects << &Post::staticMetaObject;
+    metaObjects << &Comment::staticMetaObject;
+    metaObjects << &Tag::staticMetaObject;
+    metaObjects << &UserProfile::staticMetaObject;
+
+    DataManager dataManager(metaObjects);
+    dataManager.registerClass<User>();
+    dataManager.registerClass<Post>();
+    dataManager.registerClass<Comment>();
+    dataManager.registerClass<Tag>();
+    dataManager.registerClass<UserProfile>();
+
+    if (!dataManager.open(path))
+    {
+        err << "Could not open " << path << "." << endl;
+        return 1;
+    }
+
+    DataGenerator generator(options);
+    GeneratorReport report = generator.populate(&dataManager);
+    dataManager.close();
+
+    out << "users:     " << report.users << endl;
+    out << "follows:   " << report.follows << endl;
+    out << "posts:     " << report.posts << endl;
+    out << "comments:  " << report.comments << endl;
+    out << "tags:      " << report.tags << endl;
+    out << "tag links: " << report.tagLinks << endl;
+    out << "rows:      " << report.rows() << " in " << report.elapsedMilliseconds << " ms, "
+        << qRound64(report.rowsPerSecond()) << " rows/s" << endl;
+
+    return 0;
+}
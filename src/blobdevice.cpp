@@ -0,0 +1,101 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "blobdevice.h"
+#include "datamanager.h"
+
+#include <sqlite3.h>
+
+namespace cg
+{
+
+BlobDevice::BlobDevice(sqlite3_blob *pBlob, QIODevice::OpenMode mode, DataManager *pDataManager, QWeakPointer<DataObject> pObject, bool written)
+    : m_pBlob(pBlob), m_size(0), m_pDataManager(pDataManager), m_pObject(pObject), m_written(written)
+{
+    m_size = sqlite3_blob_bytes(m_pBlob);
+    QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+BlobDevice::~BlobDevice()
+{
+    close();
+}
+
+bool BlobDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 BlobDevice::size() const
+{
+    return m_size;
+}
+
+void BlobDevice::close()
+{
+    if (m_pBlob)
+    {
+        sqlite3_blob_close(m_pBlob);
+        m_pBlob = nullptr;
+
+        DataObjectPtr pObject = m_pObject.toStrongRef();
+        if (m_written && m_pDataManager && pObject)
+            m_pDataManager->reportBlobWrite(pObject);
+    }
+
+    QIODevice::close();
+}
+
+qint64 BlobDevice::readData(char *data, qint64 maxSize)
+{
+    if (!m_pBlob)
+        return -1;
+
+    qint64 count = qMin(maxSize, m_size - pos());
+    if (count <= 0)
+        return 0;
+
+    if (sqlite3_blob_read(m_pBlob, data, int(count), int(pos())) != SQLITE_OK)
+    {
+        setErrorString("Unable to read blob.");
+        return -1;
+    }
+
+    return count;
+}
+
+qint64 BlobDevice::writeData(const char *data, qint64 maxSize)
+{
+    if (!m_pBlob)
+        return -1;
+
+    qint64 count = qMin(maxSize, m_size - pos());
+    if (count <= 0)
+    {
+        setErrorString("Blob size is fixed while open.");
+        return -1;
+    }
+
+    if (sqlite3_blob_write(m_pBlob, data, int(count), int(pos())) != SQLITE_OK)
+    {
+        setErrorString("Unable to write blob.");
+        return -1;
+    }
+
+    m_written = true;
+    return count;
+}
+
+}
@@ -0,0 +1,64 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_BLOBDEVICE_H
+#define CGDATA_BLOBDEVICE_H
+#pragma once
+
+#include "cgdata.h"
+
+#include <QIODevice>
+#include <QPointer>
+#include <QWeakPointer>
+
+struct sqlite3_blob;
+
+namespace cg
+{
+    class DataManager;
+    class DataObject;
+
+    // Random access to a single BLOB value through SQLite incremental blob I/O.
+    // The size of the value is fixed while the device is open; writes cannot grow it.
+    // Closing a device that changed the value reports the object as updated.
+    class CGDATA_API BlobDevice : public QIODevice
+    {
+        Q_OBJECT
+    public:
+        ~BlobDevice();
+
+        bool isSequential() const override;
+        qint64 size() const override;
+        void close() override;
+
+    protected:
+        qint64 readData(char *data, qint64 maxSize) override;
+        qint64 writeData(const char *data, qint64 maxSize) override;
+
+    private:
+        friend class DataManager;
+        BlobDevice(sqlite3_blob *pBlob, QIODevice::OpenMode mode, DataManager *pDataManager, QWeakPointer<DataObject> pObject, bool written);
+
+    private:
+        sqlite3_blob *m_pBlob;
+        qint64 m_size;
+        QPointer<DataManager> m_pDataManager;
+        QWeakPointer<DataObject> m_pObject;
+        bool m_written;
+    };
+
+}
+
+#endif // CGDATA_BLOBDEVICE_H
@@ -0,0 +1,112 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "changeset.h"
+
+#include <algorithm>
+
+namespace cg
+{
+
+namespace
+{
+    QList<qint64> sortedIds(const QSet<qint64> &ids)
+    {
+        QList<qint64> list = ids.toList();
+        std::sort(list.begin(), list.end());
+        return list;
+    }
+}
+
+bool ChangeSet::isEmpty() const
+{
+    for (auto & changes : m_classChanges)
+    {
+        if (!changes.isEmpty())
+            return false;
+    }
+
+    return true;
+}
+
+QStringList ChangeSet::classNames() const
+{
+    QStringList names;
+    for (auto it = m_classChanges.constBegin(); it != m_classChanges.constEnd(); ++it)
+    {
+        if (!it.value().isEmpty())
+            names.append(it.key());
+    }
+
+    return names;
+}
+
+bool ChangeSet::contains(const QString &className) const
+{
+    auto it = m_classChanges.constFind(className);
+    return it != m_classChanges.constEnd() && !it.value().isEmpty();
+}
+
+QList<qint64> ChangeSet::created(const QString &className) const
+{
+    return sortedIds(m_classChanges.value(className).created);
+}
+
+QList<qint64> ChangeSet::updated(const QString &className) const
+{
+    return sortedIds(m_classChanges.value(className).updated);
+}
+
+QList<qint64> ChangeSet::deleted(const QString &className) const
+{
+    return sortedIds(m_classChanges.value(className).deleted);
+}
+
+void ChangeSet::addCreated(const QString &className, qint64 id)
+{
+    m_classChanges[className].created.insert(id);
+}
+
+void ChangeSet::addUpdated(const QString &className, qint64 id)
+{
+    ClassChanges &changes = m_classChanges[className];
+    if (!changes.created.contains(id))
+        changes.updated.insert(id);
+}
+
+void ChangeSet::addDeleted(const QString &className, qint64 id)
+{
+    ClassChanges &changes = m_classChanges[className];
+    if (changes.created.remove(id))
+        return;
+
+    changes.updated.remove(id);
+    changes.deleted.insert(id);
+}
+
+void ChangeSet::merge(const ChangeSet &other)
+{
+    for (auto it = other.m_classChanges.constBegin(); it != other.m_classChanges.constEnd(); ++it)
+    {
+        for (auto id : it.value().created)
+            addCreated(it.key(), id);
+        for (auto id : it.value().updated)
+            addUpdated(it.key(), id);
+        for (auto id : it.value().deleted)
+            addDeleted(it.key(), id);
+    }
+}
+
+}
@@ -0,0 +1,67 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_CHANGESET_H
+#define CGDATA_CHANGESET_H
+#pragma once
+
+#include "cgdata.h"
+
+#include <QMap>
+#include <QMetaType>
+#include <QSet>
+#include <QStringList>
+
+namespace cg
+{
+
+    // Ids created, updated and deleted per class since the last notification. An object
+    // created and changed in the same set is only listed as created, and one created and
+    // deleted again is not listed at all.
+    class CGDATA_API ChangeSet
+    {
+    public:
+        bool isEmpty() const;
+        QStringList classNames() const;
+        bool contains(const QString &className) const;
+        bool contains(const QMetaObject *pMetaObject) const { return contains(pMetaObject->className()); }
+
+        QList<qint64> created(const QString &className) const;
+        QList<qint64> updated(const QString &className) const;
+        QList<qint64> deleted(const QString &className) const;
+
+        void addCreated(const QString &className, qint64 id);
+        void addUpdated(const QString &className, qint64 id);
+        void addDeleted(const QString &className, qint64 id);
+        // adds the changes of a later set, as if they were made after these
+        void merge(const ChangeSet &other);
+        void clear() { m_classChanges.clear(); }
+
+    private:
+        struct ClassChanges
+        {
+            QSet<qint64> created, updated, deleted;
+
+            bool isEmpty() const { return created.isEmpty() && updated.isEmpty() && deleted.isEmpty(); }
+        };
+
+        QMap<QString, ClassChanges> m_classChanges;
+    };
+
+}
+
+Q_DECLARE_METATYPE(cg::ChangeSet)
+
+#endif // CGDATA_CHANGESET_H
@@ -0,0 +1,127 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "columnkernels.h"
+
+namespace cg
+{
+
+namespace
+{
+    const int LaneCount = 4;
+
+    template <class T>
+    T sumValues(const T *pValues, int count)
+    {
+        T lanes[LaneCount] = { 0, 0, 0, 0 };
+
+        int i = 0;
+        for (; i + LaneCount <= count; i += LaneCount)
+        {
+            lanes[0] += pValues[i];
+            lanes[1] += pValues[i + 1];
+            lanes[2] += pValues[i + 2];
+            lanes[3] += pValues[i + 3];
+        }
+
+        T sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; i < count; i++)
+            sum += pValues[i];
+
+        return sum;
+    }
+
+    template <class T>
+    bool minMaxValues(const T *pValues, int count, T &minValue, T &maxValue)
+    {
+        if (count <= 0)
+            return false;
+
+        T minLanes[LaneCount], maxLanes[LaneCount];
+        for (int lane = 0; lane < LaneCount; lane++)
+            minLanes[lane] = maxLanes[lane] = pValues[0];
+
+        int i = 0;
+        for (; i + LaneCount <= count; i += LaneCount)
+        {
+            for (int lane = 0; lane < LaneCount; lane++)
+            {
+                T value = pValues[i + lane];
+                minLanes[lane] = value < minLanes[lane] ? value : minLanes[lane];
+                maxLanes[lane] = value > maxLanes[lane] ? value : maxLanes[lane];
+            }
+        }
+
+        minValue = minLanes[0];
+        maxValue = maxLanes[0];
+        for (int lane = 1; lane < LaneCount; lane++)
+        {
+            minValue = minLanes[lane] < minValue ? minLanes[lane] : minValue;
+            maxValue = maxLanes[lane] > maxValue ? maxLanes[lane] : maxValue;
+        }
+
+        for (; i < count; i++)
+        {
+            minValue = pValues[i] < minValue ? pValues[i] : minValue;
+            maxValue = pValues[i] > maxValue ? pValues[i] : maxValue;
+        }
+
+        return true;
+    }
+}
+
+double columnSum(const double *pValues, int count)
+{
+    return sumValues(pValues, count);
+}
+
+qint64 columnSum(const qint64 *pValues, int count)
+{
+    return sumValues(pValues, count);
+}
+
+bool columnMinMax(const double *pValues, int count, double &minValue, double &maxValue)
+{
+    return minMaxValues(pValues, count, minValue, maxValue);
+}
+
+bool columnMinMax(const qint64 *pValues, int count, qint64 &minValue, qint64 &maxValue)
+{
+    return minMaxValues(pValues, count, minValue, maxValue);
+}
+
+QVector<qint64> columnHistogram(const double *pValues, int count, double minValue, double maxValue, int binCount)
+{
+    QVector<qint64> bins(qMax(binCount, 0), 0);
+    if (binCount <= 0 || !(maxValue > minValue))
+        return bins;
+
+    const double scale = binCount / (maxValue - minValue);
+    qint64 *pBins = bins.data();
+
+    for (int i = 0; i < count; i++)
+    {
+        double value = pValues[i];
+        if (!(value >= minValue && value <= maxValue))
+            continue;
+
+        int bin = int((value - minValue) * scale);
+        pBins[bin < binCount ? bin : binCount - 1]++;
+    }
+
+    return bins;
+}
+
+}
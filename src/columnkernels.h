@@ -0,0 +1,58 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_COLUMNKERNELS_H
+#define CGDATA_COLUMNKERNELS_H
+#pragma once
+
+#include "cgdata.h"
+
+#include <QVector>
+
+namespace cg
+{
+
+    // Reductions over contiguous columns returned by DataManager::column(). The loops keep
+    // independent accumulators over plain arrays so the compiler can vectorize them.
+
+    CGDATA_API double columnSum(const double *pValues, int count);
+    CGDATA_API qint64 columnSum(const qint64 *pValues, int count);
+
+    CGDATA_API bool columnMinMax(const double *pValues, int count, double &minValue, double &maxValue);
+    CGDATA_API bool columnMinMax(const qint64 *pValues, int count, qint64 &minValue, qint64 &maxValue);
+
+    // counts of values in binCount equal-width bins over [minValue, maxValue], values outside are ignored
+    CGDATA_API QVector<qint64> columnHistogram(const double *pValues, int count, double minValue, double maxValue, int binCount);
+
+    template <class T>
+    T columnSum(const QVector<T> &values)
+    {
+        return columnSum(values.constData(), values.size());
+    }
+
+    template <class T>
+    bool columnMinMax(const QVector<T> &values, T &minValue, T &maxValue)
+    {
+        return columnMinMax(values.constData(), values.size(), minValue, maxValue);
+    }
+
+    inline QVector<qint64> columnHistogram(const QVector<double> &values, double minValue, double maxValue, int binCount)
+    {
+        return columnHistogram(values.constData(), values.size(), minValue, maxValue, binCount);
+    }
+
+}
+
+#endif // CGDATA_COLUMNKERNELS_H
@@ -0,0 +1,142 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "databasebackup.h"
+
+#include <QFile>
+
+#include <sqlite3.h>
+
+namespace cg
+{
+
+    DatabaseBackup::DatabaseBackup(sqlite3 *pSource, const QString &path)
+        : m_path(path),
+        m_pDestination(nullptr),
+        m_pBackup(nullptr),
+        m_complete(false)
+    {
+        if (!pSource)
+        {
+            m_errorString = "no source connection";
+            return;
+        }
+
+        if (sqlite3_open(path.toUtf8().constData(), &m_pDestination) != SQLITE_OK)
+        {
+            m_errorString = sqlite3_errmsg(m_pDestination);
+            sqlite3_close(m_pDestination);
+            m_pDestination = nullptr;
+            return;
+        }
+
+        m_pBackup = sqlite3_backup_init(m_pDestination, "main", pSource, "main");
+        if (!m_pBackup)
+        {
+            m_errorString = sqlite3_errmsg(m_pDestination);
+            sqlite3_close(m_pDestination);
+            m_pDestination = nullptr;
+        }
+    }
+
+    DatabaseBackup::~DatabaseBackup()
+    {
+        if (m_pBackup && !m_complete)
+            cancel();
+        else
+            finish();
+    }
+
+    bool DatabaseBackup::step(int pages)
+    {
+        if (!m_pBackup || m_complete)
+            return false;
+
+        int result = sqlite3_backup_step(m_pBackup, pages);
+        if (result == SQLITE_DONE)
+        {
+            m_complete = true;
+            finish();
+            return false;
+        }
+
+        // busy and locked only mean the source was in use; the next step tries again
+        if (result != SQLITE_OK && result != SQLITE_BUSY && result != SQLITE_LOCKED)
+        {
+            m_errorString = sqlite3_errstr(result);
+            cancel();
+            return false;
+        }
+
+        return true;
+    }
+
+    int DatabaseBackup::remainingPages() const
+    {
+        return m_pBackup ? sqlite3_backup_remaining(m_pBackup) : 0;
+    }
+
+    int DatabaseBackup::pageCount() const
+    {
+        return m_pBackup ? sqlite3_backup_pagecount(m_pBackup) : 0;
+    }
+
+    void DatabaseBackup::cancel()
+    {
+        bool started = m_pDestination != nullptr;
+        finish();
+        m_complete = false;
+
+        if (started)
+            QFile::remove(m_path);
+    }
+
+    bool DatabaseBackup::copy(sqlite3 *pSource, sqlite3 *pDestination, QString &errorString)
+    {
+        sqlite3_backup *pBackup = sqlite3_backup_init(pDestination, "main", pSource, "main");
+        if (!pBackup)
+        {
+            errorString = sqlite3_errmsg(pDestination);
+            return false;
+        }
+
+        int result = sqlite3_backup_step(pBackup, -1);
+        sqlite3_backup_finish(pBackup);
+
+        if (result != SQLITE_DONE)
+        {
+            errorString = sqlite3_errstr(result);
+            return false;
+        }
+
+        return true;
+    }
+
+    void DatabaseBackup::finish()
+    {
+        if (m_pBackup)
+        {
+            sqlite3_backup_finish(m_pBackup);
+            m_pBackup = nullptr;
+        }
+
+        if (m_pDestination)
+        {
+            sqlite3_close(m_pDestination);
+            m_pDestination = nullptr;
+        }
+    }
+
+}
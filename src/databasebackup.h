@@ -0,0 +1,69 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_DATABASEBACKUP_H
+#define CGDATA_DATABASEBACKUP_H
+#pragma once
+
+#include <QString>
+
+struct sqlite3;
+struct sqlite3_backup;
+
+namespace cg
+{
+
+    // An SQLite online backup of a connection's main database into a new file, copied a
+    // number of pages per step. Source locks are only held during a step. Changes made
+    // through the source connection between steps are carried into the copy; changes made
+    // through any other connection restart it.
+    class DatabaseBackup
+    {
+    public:
+        DatabaseBackup(sqlite3 *pSource, const QString &path);
+        ~DatabaseBackup();
+
+        bool isValid() const { return m_pBackup != nullptr; }
+        QString path() const { return m_path; }
+        QString errorString() const { return m_errorString; }
+
+        // copies up to pages pages (all remaining pages when negative), false once finished
+        bool step(int pages);
+        bool isComplete() const { return m_complete; }
+        bool isFailed() const { return !m_errorString.isEmpty(); }
+
+        int remainingPages() const;
+        int pageCount() const;
+
+        // stops the backup and removes the partial copy
+        void cancel();
+
+        // copies all of pSource's main database over pDestination's in one step
+        static bool copy(sqlite3 *pSource, sqlite3 *pDestination, QString &errorString);
+
+    private:
+        void finish();
+
+    private:
+        QString m_path;
+        sqlite3 *m_pDestination;
+        sqlite3_backup *m_pBackup;
+        bool m_complete;
+        QString m_errorString;
+    };
+
+}
+
+#endif // CGDATA_DATABASEBACKUP_H
@@ -15,19 +15,167 @@
 */
 #include "datamanager.h"
 #include "dataobject.h"
+#include "typeconverter.h"
+#include "blobdevice.h"
+#include "objectpool.h"
+#include "objectcache.h"
+#include "writebehindqueue.h"
+#include "tracerecorder.h"
+#include "databasebackup.h"
 
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QFileInfo>
+#include <QFile>
 #include <QDataStream>
 #include <QMetaProperty>
-#include <QDateTime>
-#include <QColor>
+#include <QSqlDriver>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QDebug>
 
+#include <sqlite3.h>
+
+#include <algorithm>
+
 namespace cg
 {
 
+static void bindSQLiteValue(sqlite3_stmt *pStatement, int index, const QVariant &value)
+{
+    if (value.isNull())
+    {
+        sqlite3_bind_null(pStatement, index);
+        return;
+    }
+
+    switch (value.type())
+    {
+    case QVariant::Bool:
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        sqlite3_bind_int64(pStatement, index, value.toLongLong());
+        break;
+    case QVariant::Double:
+        sqlite3_bind_double(pStatement, index, value.toDouble());
+        break;
+    case QVariant::ByteArray:
+    {
+        QByteArray bytes = value.toByteArray();
+        sqlite3_bind_blob(pStatement, index, bytes.constData(), bytes.size(), SQLITE_TRANSIENT);
+        break;
+    }
+    default:
+    {
+        QByteArray text = value.toString().toUtf8();
+        sqlite3_bind_text(pStatement, index, text.constData(), text.size(), SQLITE_TRANSIENT);
+    }
+    }
+}
+
+// Target ids of a to-many relationship, keyed by the id of the owning object. Each id also
+// records the keys of the cached lists holding it, so moving or deleting a member touches only
+// those lists instead of scanning every one.
+class IdListCache
+{
+public:
+    ~IdListCache() { clear(); }
+
+    void setMaxCost(int maxCost) { m_lists.setMaxCost(maxCost); }
+    void clear() { m_lists.clear(); }
+
+    const QList<qint64> * object(qint64 key)
+    {
+        IdList *pList = m_lists.object(key);
+        return pList ? &pList->ids : nullptr;
+    }
+
+    bool contains(qint64 key, qint64 id) const { return m_keys.contains(id, key); }
+
+    void insert(qint64 key, const QList<qint64> &ids)
+    {
+        // the replaced list takes its ids out of the index first
+        m_lists.remove(key);
+
+        IdList *pList = new IdList(this, key);
+        pList->ids = ids;
+        for (auto id : ids)
+            m_keys.insert(id, key);
+        m_lists.insert(key, pList, ids.size() + 1);
+    }
+
+    void remove(qint64 key) { m_lists.remove(key); }
+
+    // kept in id order, which is the rowid order queries return lists in
+    void insertSorted(qint64 key, qint64 id)
+    {
+        IdList *pList = m_lists.take(key);
+        if (!pList)
+            return;
+
+        if (pList->ids.isEmpty() || pList->ids.last() < id)
+            pList->ids.append(id);
+        else
+            pList->ids.insert(std::lower_bound(pList->ids.begin(), pList->ids.end(), id), id);
+        m_keys.insert(id, key);
+
+        // reinserted so the cost follows the list size
+        m_lists.insert(key, pList, pList->ids.size() + 1);
+    }
+
+    void append(qint64 key, qint64 id)
+    {
+        IdList *pList = m_lists.take(key);
+        if (!pList)
+            return;
+
+        pList->ids.append(id);
+        m_keys.insert(id, key);
+        m_lists.insert(key, pList, pList->ids.size() + 1);
+    }
+
+    void remove(qint64 key, qint64 id)
+    {
+        IdList *pList = m_lists.object(key);
+        if (pList && pList->ids.removeOne(id) && !pList->ids.contains(id))
+            m_keys.remove(id, key);
+    }
+
+    void removeFromAll(qint64 id)
+    {
+        for (auto key : m_keys.values(id))
+        {
+            IdList *pList = m_lists.object(key);
+            if (pList)
+                pList->ids.removeAll(id);
+        }
+        m_keys.remove(id);
+    }
+
+private:
+    // evicted lists take their ids out of the index
+    struct IdList
+    {
+        IdList(IdListCache *pOwner, qint64 key) : pOwner(pOwner), key(key) {}
+        ~IdList()
+        {
+            for (auto id : ids)
+                pOwner->m_keys.remove(id, key);
+        }
+
+        IdListCache *pOwner;
+        qint64 key;
+        QList<qint64> ids;
+    };
+
+    QMultiHash<qint64, qint64> m_keys;
+    QCache<qint64, IdList> m_lists;
+};
+
 class Relationship
 {
 public:
@@ -42,41 +190,398 @@ public:
 
 public:
     Relationship(Type type, const QMetaObject *pMetaObject, const QString &name)
-        : m_type(type), m_pMetaObject(pMetaObject), m_name(name), m_pInverseRelationship(nullptr)
+        : m_type(type), m_pMetaObject(pMetaObject), m_name(name), m_pInverseRelationship(nullptr), m_pCache(nullptr)
     {
         m_className = pMetaObject->className();
     }
 
     Type type() { return m_type; }
     QString name() { return m_name; }
+    QString className() const { return m_className; }
     const QMetaObject * metaObject() { return m_pMetaObject; }
 
     void setInverseRelationship(Relationship *pInverse) { m_pInverseRelationship = pInverse; }
     Relationship * inverseRelationship() const { return m_pInverseRelationship; }
 
+    IdListCache * cache() const { return m_pCache; }
+    void setCache(IdListCache *pCache) { m_pCache = pCache; }
+
 private:
     Type m_type;
     const QMetaObject *m_pMetaObject;
     QString m_name, m_className;
     Relationship *m_pInverseRelationship;
+    IdListCache *m_pCache;
+};
+
+namespace
+{
+    // statements kept prepared per connection, keyed by their SQL
+    const int MaxCachedStatements = 64;
+
+    // Times the enclosing scope as one operation. stop() ends the statistics measurement early,
+    // the trace span always covers the whole scope. Does nothing while both are disabled.
+    class OperationTimer
+    {
+    public:
+        OperationTimer(DataStatistics *pStatistics, TraceRecorder *pTrace, DataStatistics::Operation operation)
+            : m_pStatistics(pStatistics), m_pTrace(pTrace), m_operation(operation), m_traceStart(0)
+        {
+            if (m_pStatistics)
+                m_timer.start();
+            if (m_pTrace)
+                m_traceStart = m_pTrace->now();
+        }
+
+        ~OperationTimer()
+        {
+            stop();
+
+            if (m_pTrace)
+                m_pTrace->addEvent(DataStatistics::operationName(m_operation), "operation", m_traceStart, m_pTrace->now());
+        }
+
+        void stop()
+        {
+            if (m_pStatistics)
+                m_pStatistics->record(m_operation, m_timer.nsecsElapsed());
+            m_pStatistics = nullptr;
+        }
+
+    private:
+        DataStatistics *m_pStatistics;
+        TraceRecorder *m_pTrace;
+        DataStatistics::Operation m_operation;
+        QElapsedTimer m_timer;
+        qint64 m_traceStart;
+    };
+
+    // trace span for one statement or row, from construction until end()
+    class TraceSpan
+    {
+    public:
+        TraceSpan(TraceRecorder *pTrace, const char *name, const QString &sql = QString())
+            : m_pTrace(pTrace), m_name(name), m_sql(sql), m_start(pTrace ? pTrace->now() : 0)
+        {
+        }
+
+        ~TraceSpan()
+        {
+            end();
+        }
+
+        void end()
+        {
+            if (m_pTrace)
+                m_pTrace->addEvent(m_name, "sql", m_start, m_pTrace->now(), m_sql.isEmpty() ? nullptr : "sql", m_sql);
+            m_pTrace = nullptr;
+        }
+
+    private:
+        TraceRecorder *m_pTrace;
+        const char *m_name;
+        QString m_sql;
+        qint64 m_start;
+    };
+
+    void setCachedIds(IdListCache *pCache, qint64 key, const QList<qint64> &ids)
+    {
+        pCache->insert(key, ids);
+    }
+
+    void appendCachedId(IdListCache *pCache, qint64 key, qint64 id)
+    {
+        if (pCache)
+            pCache->append(key, id);
+    }
+
+    void removeCachedId(IdListCache *pCache, qint64 key, qint64 id)
+    {
+        if (pCache)
+            pCache->remove(key, id);
+    }
+
+    void removeCachedIdFromAll(IdListCache *pCache, qint64 id)
+    {
+        pCache->removeFromAll(id);
+    }
+
+    bool isMemoryPath(const QString &path)
+    {
+        return path == ":memory:" || path.startsWith("file::memory:") ||
+            (path.startsWith("file:") && path.contains("mode=memory"));
+    }
+
+    // upsert keys as read from objects and from rows, which may differ in type but not in text
+    QString upsertKeyString(const QVariant &key)
+    {
+        if (key.type() == QVariant::ByteArray)
+            return QString::fromLatin1(key.toByteArray().toHex());
+
+        return key.toString();
+    }
+
+    // Import and export move stored values, so text and JSON only need to represent the
+    // SQLite storage classes: integers, reals and text as themselves, blobs as base64. In CSV
+    // an empty field is NULL and "" an empty string.
+    QString csvField(const QVariant &value)
+    {
+        if (value.isNull())
+            return QString();
+
+        QString text;
+        if (value.type() == QVariant::ByteArray)
+            text = QString::fromLatin1(value.toByteArray().toBase64());
+        else if (value.type() == QVariant::Double)
+            text = QString::number(value.toDouble(), 'g', 17);
+        else
+            text = value.toString();
+
+        if (text.isEmpty() || text.contains(',') || text.contains('"') || text.contains('\n') || text.contains('\r'))
+        {
+            text.replace("\"", "\"\"");
+            text = "\"" + text + "\"";
+        }
+
+        return text;
+    }
+
+    QJsonValue jsonField(const QVariant &value)
+    {
+        if (value.isNull())
+            return QJsonValue();
+
+        switch (value.type())
+        {
+        case QVariant::ByteArray:
+            return QString::fromLatin1(value.toByteArray().toBase64());
+        case QVariant::Int:
+        case QVariant::LongLong:
+        {
+            // JSON numbers are doubles, which only hold integers up to 2^53 exactly
+            qint64 number = value.toLongLong();
+            if (qAbs(number) > (Q_INT64_C(1) << 53))
+                return QString::number(number);
+            return QJsonValue(number);
+        }
+        case QVariant::Double:
+            return value.toDouble();
+        default:
+            return value.toString();
+        }
+    }
+
+    // Reads one CSV record, which may span lines inside quoted fields. False at the end. Empty
+    // fields are null strings unless they were quoted.
+    bool readCsvRecord(QIODevice *pDevice, QStringList &fields)
+    {
+        fields.clear();
+        if (pDevice->atEnd())
+            return false;
+
+        QString line = QString::fromUtf8(pDevice->readLine());
+        QString field;
+        bool quoted = false;
+        int i = 0;
+
+        forever
+        {
+            if (i >= line.size())
+            {
+                if (!quoted || pDevice->atEnd())
+                    break;
+
+                line = QString::fromUtf8(pDevice->readLine());
+                i = 0;
+                continue;
+            }
+
+            QChar c = line.at(i++);
+            if (quoted)
+            {
+                if (c != '"')
+                    field += c;
+                else if (i < line.size() && line.at(i) == '"')
+                    field += line.at(i++);
+                else
+                    quoted = false;
+            }
+            else if (c == '"')
+            {
+                quoted = true;
+                if (field.isNull())
+                    field = QLatin1String("");
+            }
+            else if (c == ',')
+            {
+                fields.append(field);
+                field.clear();
+            }
+            else if (c != '\n' && c != '\r')
+            {
+                field += c;
+            }
+        }
+
+        fields.append(field);
+        return true;
+    }
+
+    // the version of the SQLite library the driver runs, as 3027000 for 3.27.0
+    int sqliteVersion(const QSqlDatabase &database)
+    {
+        QSqlQuery query(database);
+        if (!query.exec("SELECT sqlite_version()") || !query.next())
+            return 0;
+
+        QStringList parts = query.value(0).toString().split('.');
+        int version = 0;
+        for (int i = 0; i < 3; i++)
+            version = version * 1000 + (i < parts.size() ? parts.at(i).toInt() : 0);
+
+        return version;
+    }
+}
+
+class Column
+{
+public:
+    Column(const QMetaProperty &property, bool deferred = false)
+        : m_property(property), m_name(property.name()), m_type(property.userType()), m_deferred(deferred)
+    {
+        m_converter = TypeConverter::converter(m_type);
+    }
+
+    QString name() const { return m_name; }
+    int type() const { return m_type; }
+    QMetaProperty property() const { return m_property; }
+    bool hasConverter() const { return m_converter.isValid(); }
+    // deferred columns are left out of the default SELECT and loaded on demand
+    bool isDeferred() const { return m_deferred; }
+
+    QString sqliteType() const
+    {
+        if (m_converter.isValid())
+            return m_converter.sqliteType();
+
+        return "BLOB";
+    }
+
+    QVariant toSQLite(const QVariant &value) const
+    {
+        if (m_converter.isValid())
+            return m_converter.toSQLite(value);
+
+        return value.toByteArray();
+    }
+
+    QVariant fromSQLite(const QVariant &value) const
+    {
+        if (m_converter.isValid())
+            return m_converter.fromSQLite(value);
+
+        QVariant returnValue = value;
+        returnValue.convert(m_type);
+        return returnValue;
+    }
+
+    QVariant read(const QObject *pObject) const
+    {
+        return toSQLite(m_property.read(pObject));
+    }
+
+    void write(QObject *pObject, const QVariant &value) const
+    {
+        QVariant propertyValue = fromSQLite(value);
+        if (propertyValue.isValid())
+            m_property.write(pObject, propertyValue);
+    }
+
+private:
+    QMetaProperty m_property;
+    QString m_name;
+    int m_type;
+    bool m_deferred;
+    TypeConverter m_converter;
 };
 
 class Table
 {
 public:
     Table(const QMetaObject *pMetaObject) 
-        : m_pMetaObject(pMetaObject), m_pRelationship1(nullptr), m_pRelationship2(nullptr)
+        : m_pMetaObject(pMetaObject), m_hasFactory(false), m_pCache(nullptr), m_lastId(-1), m_sequenced(false), m_idBlockSize(0), m_nextBlockId(0), m_blockEnd(0),
+        m_pRelationship1(nullptr), m_pRelationship2(nullptr)
     {
         m_name = pMetaObject->className();
         //m_name += "_table";
+
+        for (int i = 0; i < pMetaObject->classInfoCount(); i++)
+        {
+            QMetaClassInfo classInfo = pMetaObject->classInfo(i);
+            if (qstrcmp(classInfo.value(), "deferred") == 0)
+                m_deferredNames.insert(classInfo.name());
+            else if (qstrcmp(classInfo.value(), "unique") == 0)
+                m_uniqueNames.append(classInfo.name());
+        }
+
+        // id is always the first selected column, followed by the non-deferred data columns
+        QStringList selectNames("id"), dataNames, placeholders, assignments;
+        int count = pMetaObject->propertyCount();
+
+        for (int i = 0; i < count; ++i)
+        {
+            QMetaProperty property = pMetaObject->property(i);
+            Column column(property, m_deferredNames.contains(property.name()));
+            m_columns.append(column);
+
+            if (column.name() == "id")
+                continue;
+
+            m_dataColumns.append(column);
+            dataNames.append(column.name());
+            placeholders.append("?");
+            assignments.append(column.name() + " = ?");
+
+            if (!column.isDeferred())
+            {
+                m_selectColumns.append(column);
+                selectNames.append(column.name());
+            }
+        }
+
+        m_selectString = selectNames.join(", ");
+        m_insertString = QString("INSERT INTO %1 (%2) VALUES (%3)").arg(m_name).arg(dataNames.join(", ")).arg(placeholders.join(", "));
+        m_insertWithIdString = QString("INSERT INTO %1 (id, %2) VALUES (?, %3)").arg(m_name).arg(dataNames.join(", ")).arg(placeholders.join(", "));
+        m_updateString = QString("UPDATE %1 SET %2 WHERE id = ?").arg(m_name).arg(assignments.join(", "));
     }
 
     Table(Relationship *pRelationship1, Relationship *pRelationship2, const QString &name)
-        : m_pMetaObject(nullptr), m_pRelationship1(pRelationship1), m_pRelationship2(pRelationship2), m_name(name)
+        : m_pMetaObject(nullptr), m_hasFactory(false), m_pCache(nullptr), m_lastId(-1), m_sequenced(false), m_idBlockSize(0), m_nextBlockId(0), m_blockEnd(0),
+        m_pRelationship1(pRelationship1), m_pRelationship2(pRelationship2), m_name(name)
     {
     }
 
     const QMetaObject * metaObject() const { return m_pMetaObject; }
+    const ClassFactory * factory() const { return m_hasFactory ? &m_factory : nullptr; }
+    void setFactory(const ClassFactory &factory) { m_factory = factory; m_hasFactory = true; }
+    QSharedPointer<ObjectPool> pool() const { return m_pPool; }
+    void setPool(QSharedPointer<ObjectPool> pPool) { m_pPool = pPool; }
+    ObjectCache * cache() const { return m_pCache; }
+    void setCache(ObjectCache *pCache) { m_pCache = pCache; }
+    // last id handed out while inserts are queued, -1 until read from the database
+    qint64 lastId() const { return m_lastId; }
+    void setLastId(qint64 id) { m_lastId = id; }
+    // the class has a row in the sequence table, so ids must stay above its next_id
+    bool isSequenced() const { return m_sequenced; }
+    void setSequenced(bool sequenced) { m_sequenced = sequenced; }
+    // ids reserved from the sequence table, handed out from nextBlockId up to blockEnd
+    int idBlockSize() const { return m_idBlockSize; }
+    void setIdBlockSize(int size) { m_idBlockSize = size; }
+    qint64 nextBlockId() const { return m_nextBlockId; }
+    qint64 blockEnd() const { return m_blockEnd; }
+    void setIdBlock(qint64 nextId, qint64 end) { m_nextBlockId = nextId; m_blockEnd = end; }
+    QVector<int> foreignKeyIndexes() const { return m_foreignKeyIndexes; }
+    void setForeignKeyIndexes(const QVector<int> &indexes) { m_foreignKeyIndexes = indexes; }
     Relationship * relationship1() const { return m_pRelationship1; }
     Relationship * relationship2() const { return m_pRelationship2; }
     QString name() const { return m_name; }
@@ -89,53 +594,206 @@ public:
 
     QList<Relationship*> relationships() const { return m_relationshipMap.values(); }
 
+    void clearRelationships()
+    {
+        m_relationshipMap.clear();
+        m_dependentPairs.clear();
+    }
+
+    // all property columns in declaration order, including id
+    const QList<Column> & columns() const { return m_columns; }
+    // columns other than id, in the order used by the INSERT and UPDATE strings
+    const QList<Column> & dataColumns() const { return m_dataColumns; }
+    // columns following id in the SELECT string
+    const QList<Column> & selectColumns() const { return m_selectColumns; }
+    QSet<QByteArray> deferredNames() const { return m_deferredNames; }
+    // properties declared with QD_UNIQUE
+    QStringList uniqueNames() const { return m_uniqueNames; }
+
+    const Column * column(const QString &name) const
+    {
+        for (auto & column : m_columns)
+        {
+            if (column.name() == name)
+                return &column;
+        }
+
+        return nullptr;
+    }
+
+    // the CREATE TABLE column list
+    QString columnDefinitions() const
+    {
+        QStringList definitions;
+        for (auto & column : m_columns)
+        {
+            QString definition = column.name() + " " + column.sqliteType();
+            if (column.name() == "id")
+                definition += " primary key";
+            definitions.append(definition);
+        }
+
+        return definitions.join(", ");
+    }
+
+    QString selectString() const { return m_selectString; }
+    QString insertString() const { return m_insertString; }
+    QString insertWithIdString() const { return m_insertWithIdString; }
+    QString updateString() const { return m_updateString; }
+
 private:
     const QMetaObject *m_pMetaObject;
+    ClassFactory m_factory;
+    bool m_hasFactory;
+    QSharedPointer<ObjectPool> m_pPool;
+    ObjectCache *m_pCache;
+    qint64 m_lastId;
+    bool m_sequenced;
+    int m_idBlockSize;
+    qint64 m_nextBlockId, m_blockEnd;
+    QVector<int> m_foreignKeyIndexes;
     Relationship *m_pRelationship1, *m_pRelationship2;
     QString m_name;
+    QList<Column> m_columns, m_dataColumns, m_selectColumns;
+    QSet<QByteArray> m_deferredNames;
+    QStringList m_uniqueNames;
+    QString m_selectString, m_insertString, m_insertWithIdString, m_updateString;
     QMap<QString, Relationship*> m_relationshipMap;
     QList<QPair<QString, QString>> m_dependentPairs;
 };
 
 
 
+DataManager::DataManager()
+    : m_relationshipsDirty(false), m_pCache(new ObjectCache()), m_changesScheduled(false), m_transactionDepth(0), m_pWriteBehind(nullptr), m_pStatistics(nullptr),
+    m_slowQueryThreshold(-1), m_slowQueryCapacity(0), m_redactSlowQueries(false), m_pTrace(nullptr), m_tracing(false),
+    m_pBackup(nullptr), m_backupPagesPerStep(0),
+    m_inMemory(false), m_pSnapshotTimer(nullptr),
+    m_connectionName(QSqlDatabase::defaultConnection), m_idBase(0),
+    m_archiveAttached(false), m_sharedSQLite(false),
+    m_changeDetection(false), m_changeRetention(0), m_pChangeTimer(nullptr), m_dataVersion(0), m_lastChangeSequence(0)
+{
+    qRegisterMetaType<ChangeSet>("cg::ChangeSet");
+    qRegisterMetaType<SlowQuery>("cg::SlowQuery");
+}
+
 DataManager::DataManager(QList<const QMetaObject*> &metaObjectList)
+    : m_relationshipsDirty(false), m_pCache(new ObjectCache()), m_changesScheduled(false), m_transactionDepth(0), m_pWriteBehind(nullptr), m_pStatistics(nullptr),
+    m_slowQueryThreshold(-1), m_slowQueryCapacity(0), m_redactSlowQueries(false), m_pTrace(nullptr), m_tracing(false),
+    m_pBackup(nullptr), m_backupPagesPerStep(0),
+    m_inMemory(false), m_pSnapshotTimer(nullptr),
+    m_connectionName(QSqlDatabase::defaultConnection), m_idBase(0),
+    m_archiveAttached(false), m_sharedSQLite(false),
+    m_changeDetection(false), m_changeRetention(0), m_pChangeTimer(nullptr), m_dataVersion(0), m_lastChangeSequence(0)
 {
+    qRegisterMetaType<ChangeSet>("cg::ChangeSet");
+    qRegisterMetaType<SlowQuery>("cg::SlowQuery");
+
     for (auto & pMetaObject : metaObjectList)
-    {
-        m_classObjectMap.insert(pMetaObject->className(), ObjectMap());
+        addClass(pMetaObject);
 
-        Table *pClassTable = new Table(pMetaObject);
-        m_tableMap.insert(pMetaObject->className(), pClassTable);
-    }
+    createRelationships();
+}
+
+void DataManager::addClass(const QMetaObject *pMetaObject)
+{
+    m_metaObjects.append(pMetaObject);
+    m_classObjectMap.insert(pMetaObject->className(), ObjectMap());
 
-    for (auto & pMetaObject1 : metaObjectList)
+    Table *pClassTable = new Table(pMetaObject);
+    m_tableMap.insert(pMetaObject->className(), pClassTable);
+
+    updateTableCaches();
+}
+
+void DataManager::registerClass(const QMetaObject *pMetaObject, const ClassFactory &factory)
+{
+    if (!m_tableMap.contains(pMetaObject->className()))
     {
-        int count = pMetaObject1->classInfoCount();
-        for (int i = 0; i < count; i++)
-        {
-            QMetaClassInfo classInfo = pMetaObject1->classInfo(i);
-            QString name1 = classInfo.name();
+        addClass(pMetaObject);
+        m_relationshipsDirty = true;
+    }
 
-            Table *pTable1 = m_tableMap.value(pMetaObject1->className());
-            Relationship *pRelationship1 = pTable1->relationship(name1);
+    m_tableMap.value(pMetaObject->className())->setFactory(factory);
+}
 
-            if (!pRelationship1)
-            {
-                QStringList list = QString(classInfo.value()).split(":");
-                if (list.size() == 2)
-                {
-                    QString typeStr = list.at(0);
-                    QString className = list.at(1);
+bool DataManager::setPoolingEnabled(const QMetaObject *pMetaObject, bool enabled, int objectsPerSlab)
+{
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable)
+        return false;
 
-                    Table *pTable2 = m_tableMap.value(className);
+    if (!enabled)
+    {
+        // pooled objects still alive keep their pool until they are released
+        pTable->setPool(QSharedPointer<ObjectPool>());
+        return true;
+    }
 
-                    if (typeStr == "-1")
-                    {
-                        pRelationship1 = new Relationship(Relationship::ToOneType, pMetaObject1, name1);
-                        pTable2->addDependentPair(pMetaObject1->className(), name1);
-                        pTable1->addRelationship(pRelationship1->name(), pRelationship1);
-                        m_relationships.append(pRelationship1);
+    const ClassFactory *pFactory = pTable->factory();
+    if (!pFactory || !ObjectPool::supportsAlignment(pFactory->alignment))
+    {
+        qDebug() << "Error: setPoolingEnabled, " << pMetaObject->className() << " must be registered with registerClass<T>()";
+        return false;
+    }
+
+    pTable->setPool(QSharedPointer<ObjectPool>::create(pFactory->size, pFactory->alignment, objectsPerSlab));
+    return true;
+}
+
+void DataManager::clearRelationships()
+{
+    for (auto & key : m_tableMap.keys())
+    {
+        Table *pTable = m_tableMap.value(key);
+        if (pTable->metaObject())
+        {
+            pTable->clearRelationships();
+        }
+        else
+        {
+            m_tableMap.remove(key);
+            delete pTable;
+        }
+    }
+
+    for (auto & pRelationship : m_relationships)
+        delete pRelationship;
+    m_relationships.clear();
+}
+
+void DataManager::createRelationships()
+{
+    clearRelationships();
+    m_relationshipsDirty = false;
+
+    for (auto & pMetaObject1 : m_metaObjects)
+    {
+        int count = pMetaObject1->classInfoCount();
+        for (int i = 0; i < count; i++)
+        {
+            QMetaClassInfo classInfo = pMetaObject1->classInfo(i);
+            QString name1 = classInfo.name();
+
+            Table *pTable1 = m_tableMap.value(pMetaObject1->className());
+            Relationship *pRelationship1 = pTable1->relationship(name1);
+
+            if (!pRelationship1)
+            {
+                QStringList list = QString(classInfo.value()).split(":");
+                if (list.size() == 2)
+                {
+                    QString typeStr = list.at(0);
+                    QString className = list.at(1);
+
+                    Table *pTable2 = m_tableMap.value(className);
+
+                    if (typeStr == "-1")
+                    {
+                        pRelationship1 = new Relationship(Relationship::ToOneType, pMetaObject1, name1);
+                        pTable2->addDependentPair(pMetaObject1->className(), name1);
+                        pTable1->addRelationship(pRelationship1->name(), pRelationship1);
+                        m_relationships.append(pRelationship1);
                     }
                 }
                 else if (list.size() == 3)
@@ -206,6 +864,29 @@ DataManager::DataManager(QList<const QMetaObject*> &metaObjectList)
             }
         }
     }
+
+    // foreign keys are zero initialized for every constructed object
+    for (auto & pTable : m_tableMap.values())
+    {
+        const QMetaObject *pMetaObject = pTable->metaObject();
+        if (!pMetaObject)
+            continue;
+
+        QVector<int> indexes;
+        for (auto & pRelationship : pTable->relationships())
+        {
+            if (pRelationship->type() == Relationship::ToOneType ||
+                pRelationship->type() == Relationship::OneToOneType ||
+                pRelationship->type() == Relationship::ManyToOneType)
+            {
+                indexes.append(pMetaObject->indexOfProperty(pRelationship->name().toUtf8()));
+            }
+        }
+
+        pTable->setForeignKeyIndexes(indexes);
+    }
+
+    updateRelationshipCaches();
 }
 
 DataManager::~DataManager()
@@ -217,255 +898,2976 @@ DataManager::~DataManager()
 
     for (auto & pRelationship : m_relationships)
         delete pRelationship;
+
+    qDeleteAll(m_classCaches);
+    qDeleteAll(m_relationshipCaches);
+    delete m_pCache;
+    delete m_pStatistics;
+    delete m_pTrace;
 }
 
-void DataManager::close()
+void DataManager::setStatisticsEnabled(bool enabled)
 {
-    clearObjects();
+    if (enabled && !m_pStatistics)
+    {
+        m_pStatistics = new DataStatistics();
+    }
+    else if (!enabled)
+    {
+        delete m_pStatistics;
+        m_pStatistics = nullptr;
+    }
+}
 
-    if (m_database.isOpen())
-        m_database.close();
+bool DataManager::isStatisticsEnabled() const
+{
+    return m_pStatistics != nullptr;
+}
 
-    emit databaseClosed();
+DataStatistics DataManager::statistics() const
+{
+    return m_pStatistics ? *m_pStatistics : DataStatistics();
 }
 
-void DataManager::clearObjects()
+void DataManager::resetStatistics()
 {
-    for (auto &className : m_classObjectMap.keys())
+    if (m_pStatistics)
+        m_pStatistics->reset();
+}
+
+void DataManager::startTrace(int maxEvents)
+{
+    delete m_pTrace;
+    m_pTrace = new TraceRecorder(maxEvents);
+    m_tracing = true;
+}
+
+void DataManager::stopTrace()
+{
+    m_tracing = false;
+}
+
+bool DataManager::isTracing() const
+{
+    return m_tracing;
+}
+
+QByteArray DataManager::traceJson() const
+{
+    return m_pTrace ? m_pTrace->toJson() : QByteArray();
+}
+
+bool DataManager::saveTrace(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
     {
-        auto & objectMap = m_classObjectMap[className];
-        objectMap.clear();
+        qDebug() << "Error: saveTrace, unable to open " << path;
+        return false;
     }
+
+    return file.write(traceJson()) >= 0;
 }
 
-bool DataManager::isOpen() const
+TraceRecorder * DataManager::activeTrace() const
 {
-    return m_database.isOpen();
+    return m_tracing ? m_pTrace : nullptr;
 }
 
-bool DataManager::open(const QString &path)
+void DataManager::setSlowQueryThreshold(qint64 microseconds, int capacity)
 {
-    if (m_database.isOpen())
-        return false;
+    m_slowQueryThreshold = microseconds;
+    m_slowQueryCapacity = capacity;
 
-    clearObjects();
+    while (m_slowQueries.size() > qMax(0, capacity))
+        m_slowQueries.removeFirst();
+}
 
-    QFileInfo fi(path);
-    bool dbExists = fi.exists();
+void DataManager::setSlowQueryRedaction(bool redact)
+{
+    m_redactSlowQueries = redact;
+}
 
-    m_database = QSqlDatabase::addDatabase("QSQLITE");
-    m_database.setDatabaseName(path);
+QList<SlowQuery> DataManager::slowQueries() const
+{
+    return m_slowQueries;
+}
 
-    if (!m_database.open())
+void DataManager::clearSlowQueries()
+{
+    m_slowQueries.clear();
+}
+
+void DataManager::startQueryTimer(QElapsedTimer &timer) const
+{
+    if (m_slowQueryThreshold >= 0)
+        timer.start();
+}
+
+void DataManager::logSlowQuery(DataStatistics::Operation operation, const QString &sql, const QVariantList &values, const QElapsedTimer &timer) const
+{
+    if (m_slowQueryThreshold < 0 || !timer.isValid())
+        return;
+
+    qint64 elapsed = timer.nsecsElapsed() / 1000;
+    if (elapsed < m_slowQueryThreshold)
+        return;
+
+    SlowQuery slowQuery;
+    slowQuery.operation = DataStatistics::operationName(operation);
+    slowQuery.sql = sql;
+    slowQuery.elapsedMicroseconds = elapsed;
+    slowQuery.timestamp = QDateTime::currentDateTime();
+
+    if (m_redactSlowQueries)
     {
-        qDebug() << "Error: unable to open database.";
+        for (int i = 0; i < values.size(); i++)
+            slowQuery.values.append(QString("<redacted>"));
     }
-    else if (!dbExists)
+    else
     {
-        for (auto & className : m_tableMap.keys())
-        {
-            Table *pTable = m_tableMap.value(className);
-            const QMetaObject *pMetaObject = pTable->metaObject();
+        slowQuery.values = values;
+    }
 
-            if (pMetaObject)
-            {
-                QString columnsString;
-                QStringList textColumnsList;
-                int count = pMetaObject->propertyCount();
+    // the detail column describes each step, e.g. "SCAN TABLE Post" or "SEARCH TABLE Post USING INDEX"
+    QSqlQuery planQuery(m_database);
+    planQuery.prepare("EXPLAIN QUERY PLAN " + sql);
+    for (auto & value : values)
+        planQuery.addBindValue(value);
 
-                for (int i = 0; i < count; ++i)
-                {
-                    QMetaProperty property = pMetaObject->property(i);
-                    QString name = property.name();
-                    QString type = toSQLiteTypeString(property.type());
-
-                    columnsString += name + " " + type;
-                    if (name == "id")
-                        columnsString += " primary key";
-                    if (i != count - 1)
-                        columnsString += ", ";
-
-                    if (property.type() == QVariant::String)
-                        textColumnsList.append(name);
-                }
+    if (planQuery.exec())
+    {
+        while (planQuery.next())
+            slowQuery.queryPlan.append(planQuery.value(3).toString());
+    }
 
-                QSqlQuery query;
-                query.prepare(QString("CREATE TABLE %1 (%2)").arg(pTable->name()).arg(columnsString));
-                if (query.exec())
-                {
-                    //qDebug() << "Table created: " << query.executedQuery();
-                }
-                else
-                {
-                    qDebug() << "Error: Unable to create table for " << pTable->name();
-                }
+    if (m_slowQueryCapacity > 0)
+    {
+        m_slowQueries.append(slowQuery);
+        while (m_slowQueries.size() > m_slowQueryCapacity)
+            m_slowQueries.removeFirst();
+    }
 
-                createVirtualTable(pTable->name(), textColumnsList);
-            }
-            else if (pTable->relationship1() && pTable->relationship2())
-            {
-                Relationship *pRelationship1 = pTable->relationship1();
-                Relationship *pRelationship2 = pTable->relationship2();
-
-                QSqlQuery query;
-                query.prepare(QString("CREATE TABLE %1 (%2 INTEGER, %3 INTEGER)")
-                    .arg(pTable->name())
-                    .arg(pRelationship1->name())
-                    .arg(pRelationship2->name()));
-                if (query.exec())
-                {
-                    //qDebug() << "Table created for " << pTable->name();
-                }
-                else
-                {
-                    qDebug() << "Error: Unable to create table for " << pTable->name();
-                }
-            }
+    emit const_cast<DataManager*>(this)->slowQueryRecorded(slowQuery);
+}
+
+QSqlQuery DataManager::preparedQuery(const QString &sql) const
+{
+    // a cached statement is only handed out again once its previous use has finished
+    auto it = m_statements.find(sql);
+    if (it != m_statements.end() && !it.value().isActive())
+    {
+        if (m_pStatistics)
+            m_pStatistics->addStatementReused();
+        return it.value();
+    }
+
+    TraceSpan span(activeTrace(), "prepare", sql);
+
+    QSqlQuery query(m_database);
+    query.prepare(sql);
+    if (m_pStatistics)
+        m_pStatistics->addStatementPrepared();
+
+    if (it == m_statements.end() && m_statements.size() < MaxCachedStatements)
+        m_statements.insert(sql, query);
+
+    return query;
+}
+
+void DataManager::setCacheLimit(int maxCost, CacheCost cost)
+{
+    m_pCache->setMaxCost(maxCost);
+    m_pCache->setCostMode(cost);
+    updateTableCaches();
+}
+
+void DataManager::setCacheLimit(const QMetaObject *pMetaObject, int maxCost, CacheCost cost)
+{
+    QString className = pMetaObject->className();
+    ObjectCache *pCache = m_classCaches.value(className);
+
+    if (maxCost > 0)
+    {
+        if (!pCache)
+        {
+            pCache = new ObjectCache();
+            m_classCaches.insert(className, pCache);
         }
+
+        pCache->setMaxCost(maxCost);
+        pCache->setCostMode(cost);
+    }
+    else if (pCache)
+    {
+        m_classCaches.remove(className);
+        delete pCache;
     }
 
-    emit databaseOpened();
+    updateTableCaches();
+}
 
-    return true;
+void DataManager::updateTableCaches()
+{
+    for (auto & pTable : m_tableMap.values())
+    {
+        if (!pTable->metaObject())
+            continue;
+
+        ObjectCache *pCache = m_classCaches.value(pTable->name());
+        if (!pCache && m_pCache->maxCost() > 0)
+            pCache = m_pCache;
+
+        pTable->setCache(pCache);
+    }
 }
 
-void DataManager::createVirtualTable(const QString &tableName, const QStringList &textColumnList)
+int DataManager::cacheLimit(const QMetaObject *pMetaObject) const
 {
-    if (textColumnList.size() == 0)
-        return;
+    ObjectCache *pCache = m_classCaches.value(pMetaObject->className());
+    return pCache ? pCache->maxCost() : 0;
+}
 
-    QString columnNames = textColumnList.join(", ");
-    QString queryString = QString("%1, content=%2, content_rowid=id").arg(columnNames).arg(tableName);
+DataManager::CacheCost DataManager::cacheCost(const QMetaObject *pMetaObject) const
+{
+    ObjectCache *pCache = m_classCaches.value(pMetaObject->className());
+    return pCache ? CacheCost(pCache->costMode()) : ObjectCountCost;
+}
 
-    QSqlQuery query;
-    query.prepare(QString("CREATE VIRTUAL TABLE %1_fts USING fts5(%2)").arg(tableName).arg(queryString));
-    if (query.exec())
+CacheStatistics DataManager::cacheStatistics(const QMetaObject *pMetaObject) const
+{
+    QList<ObjectCache*> caches;
+
+    if (pMetaObject)
     {
-        //qDebug() << "Virtual table created for " << tableName;
+        Table *pTable = m_tableMap.value(pMetaObject->className());
+        if (pTable && pTable->cache())
+            caches.append(pTable->cache());
     }
     else
     {
-        qDebug() << "Error: Unable to create virtual table for " << tableName;
+        caches.append(m_pCache);
+        caches.append(m_classCaches.values());
     }
 
-    QString insertText = "rowid, " + columnNames;
+    CacheStatistics statistics = { 0, 0, 0, 0, 0 };
+    for (auto & pCache : caches)
+    {
+        statistics.hits += pCache->hits();
+        statistics.misses += pCache->misses();
+        statistics.evictions += pCache->evictions();
+        statistics.objectCount += pCache->count();
+        statistics.totalCost += pCache->totalCost();
+    }
 
-    QStringList newList;
-    newList << "new.id";
-    for (auto & name : textColumnList)
-        newList << "new." + name;
-    QString newText = newList.join(", ");
+    return statistics;
+}
 
-    QSqlQuery trigger1Query;
-    trigger1Query.prepare(QString("CREATE TRIGGER %1_ai AFTER INSERT ON %1 BEGIN "
-        "INSERT INTO %1_fts(%2) VALUES(%3); END;").arg(tableName).arg(insertText).arg(newText));
-    if (trigger1Query.exec())
+void DataManager::resetCacheStatistics()
+{
+    m_pCache->resetStatistics();
+    for (auto & pCache : m_classCaches)
+        pCache->resetStatistics();
+}
+
+void DataManager::clearCache()
+{
+    m_pCache->clear();
+    for (auto & pCache : m_classCaches)
+        pCache->clear();
+    for (auto & pCache : m_relationshipCaches)
+        pCache->clear();
+}
+
+void DataManager::setRelationshipCacheLimit(const QMetaObject *pMetaObject, const QString &relationshipName, int maxIds)
+{
+    QString key = QString("%1.%2").arg(pMetaObject->className()).arg(relationshipName);
+    IdListCache *pCache = m_relationshipCaches.value(key);
+
+    if (maxIds > 0)
     {
-        //qDebug() << "Success: " << trigger1Query.executedQuery();
+        if (!pCache)
+        {
+            pCache = new IdListCache();
+            m_relationshipCaches.insert(key, pCache);
+        }
+
+        pCache->setMaxCost(maxIds);
     }
-    else
+    else if (pCache)
     {
-        qDebug() << "Error: " << trigger1Query.lastQuery();
+        m_relationshipCaches.remove(key);
+        delete pCache;
     }
 
-    QStringList oldList;
-    oldList << "'delete'";
-    oldList << "old.id";
-    for (auto & name : textColumnList)
-        oldList << "old." + name;
-    QString oldText = oldList.join(", ");
+    updateRelationshipCaches();
+}
 
-    QSqlQuery trigger2Query;
-    trigger2Query.prepare(QString("CREATE TRIGGER %1_ad AFTER DELETE ON %1 BEGIN "
-        "INSERT INTO %1_fts(%1_fts, %2) VALUES(%3); END;")
-        .arg(tableName).arg(insertText).arg(oldText));
-    if (trigger2Query.exec())
+void DataManager::updateRelationshipCaches()
+{
+    for (auto & pRelationship : m_relationships)
     {
-        //qDebug() << "Success: " << trigger2Query.executedQuery();
+        IdListCache *pCache = nullptr;
+        if (pRelationship->type() == Relationship::OneToManyType || pRelationship->type() == Relationship::ManyToManyType)
+            pCache = m_relationshipCaches.value(QString("%1.%2").arg(pRelationship->className()).arg(pRelationship->name()));
+
+        pRelationship->setCache(pCache);
     }
-    else
+}
+
+void DataManager::updateCachedLists(Table *pTable, DataObjectPtr pObject)
+{
+    qint64 id = pObject->id();
+
+    // moves the object between the cached lists of its old and new parent
+    for (auto & pRelationship : pTable->relationships())
     {
-        qDebug() << "Error: " << trigger2Query.lastQuery();
+        Relationship *pInverseRelationship = pRelationship->inverseRelationship();
+        if (pRelationship->type() != Relationship::ManyToOneType || !pInverseRelationship || !pInverseRelationship->cache())
+            continue;
+
+        IdListCache *pCache = pInverseRelationship->cache();
+        qint64 parentId = pObject->property(pRelationship->name().toLocal8Bit()).toLongLong();
+
+        // already listed under its parent, so no other list can hold it
+        if (pCache->contains(parentId, id))
+            continue;
+
+        removeCachedIdFromAll(pCache, id);
+        pCache->insertSorted(parentId, id);
     }
+}
 
-    QSqlQuery trigger3Query;
-    trigger3Query.prepare(QString("CREATE TRIGGER %1_au AFTER UPDATE ON %1 BEGIN "
-        "INSERT INTO %1_fts(%1_fts, %2) VALUES(%3);"
-        "INSERT INTO %1_fts(%2) VALUES(%4); END;")
-        .arg(tableName).arg(insertText).arg(oldText).arg(newText));
-    if (trigger3Query.exec())
+void DataManager::uncacheRelationships(Table *pTable, qint64 id)
+{
+    for (auto & pRelationship : pTable->relationships())
+    {
+        // lists owned by the object
+        if (pRelationship->cache())
+            pRelationship->cache()->remove(id);
+
+        // lists the object is a member of
+        Relationship *pInverseRelationship = pRelationship->inverseRelationship();
+        if (pInverseRelationship && pInverseRelationship->cache())
+            removeCachedIdFromAll(pInverseRelationship->cache(), id);
+    }
+}
+
+namespace
+{
+    int estimatedBytes(const QVariant &value)
+    {
+        switch (value.type())
+        {
+        case QVariant::String:
+            return value.toString().size() * int(sizeof(QChar));
+        case QVariant::ByteArray:
+            return value.toByteArray().size();
+        case QVariant::StringList:
+        {
+            int bytes = 0;
+            for (auto & str : value.toStringList())
+                bytes += int(sizeof(QString)) + str.size() * int(sizeof(QChar));
+            return bytes;
+        }
+        default:
+            return int(sizeof(QVariant));
+        }
+    }
+}
+
+void DataManager::cacheObject(Table *pTable, DataObjectPtr pObject) const
+{
+    ObjectCache *pCache = pTable->cache();
+    if (!pCache)
+        return;
+
+    int cost = 1;
+    if (pCache->costMode() == EstimatedBytesCost)
+    {
+        cost = pTable->factory() ? int(pTable->factory()->size) : int(sizeof(DataObject));
+        for (auto & column : pTable->columns())
+        {
+            // reading an unloaded lazy property would load it
+            if (column.isDeferred() && pObject->m_unloadedProperties.contains(column.name().toUtf8()))
+                continue;
+
+            cost += estimatedBytes(column.property().read(pObject.data()));
+        }
+    }
+
+    pCache->insert(pTable, pObject, cost);
+}
+
+QList<qint64> DataManager::uncacheObjects(Table *pTable, const QString &columnName, qint64 id)
+{
+    QList<qint64> ids;
+    auto & objectMap = m_classObjectMap[pTable->name()];
+
+    bool hasRelationshipCaches = false;
+    for (auto & pRelationship : pTable->relationships())
+    {
+        Relationship *pInverseRelationship = pRelationship->inverseRelationship();
+        if (pRelationship->cache() || (pInverseRelationship && pInverseRelationship->cache()))
+            hasRelationshipCaches = true;
+    }
+
+    // the ids are only needed when something in memory refers to them or someone listens for them
+    bool hasListeners = isSignalConnected(QMetaMethod::fromSignal(&DataManager::changesCommitted));
+    if (objectMap.isEmpty() && !hasRelationshipCaches && !hasListeners)
+        return ids;
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    // the cascade deletes archived dependents as well
+    query.prepare(QString("SELECT id FROM %1 WHERE %2 = :%2").arg(sourceName(pTable, true)).arg(columnName));
+    query.bindValue(":" + columnName, id);
+
+    if (query.exec())
+    {
+        while (query.next())
+        {
+            qint64 objectId = query.value(0).toLongLong();
+            objectMap.remove(objectId);
+            if (pTable->cache())
+                pTable->cache()->remove(pTable, objectId);
+            uncacheRelationships(pTable, objectId);
+            ids.append(objectId);
+        }
+    }
+
+    return ids;
+}
+
+void DataManager::close()
+{
+    while (m_transactionDepth > 0)
+        rollbackTransaction();
+
+    // objects still pending are written like queued ones, and forgotten if that fails
+    if (!persistPending())
+        discardPending();
+    flushChanges();
+    cancelBackup();
+
+    // queued writes go out before the connection closes
+    delete m_pWriteBehind;
+    m_pWriteBehind = nullptr;
+
+    clearObjects();
+
+    // open blob handles would keep the connection from closing
+    for (auto & pDevice : m_blobDevices)
+    {
+        if (pDevice)
+            pDevice->close();
+    }
+    m_blobDevices.clear();
+
+    if (m_pSnapshotTimer)
+        m_pSnapshotTimer->stop();
+    if (m_pChangeTimer)
+        m_pChangeTimer->stop();
+
+    // a memory database is saved one last time on the way out
+    if (isInMemory() && !m_snapshotPath.isEmpty())
+        saveSnapshot();
+    m_snapshotPath.clear();
+
+    m_statements.clear();
+    m_archiveAttached = false;
+
+    if (m_database.isOpen())
+        m_database.close();
+
+    emit databaseClosed();
+}
+
+void DataManager::clearObjects()
+{
+    clearCache();
+
+    for (auto &className : m_classObjectMap.keys())
+    {
+        auto & objectMap = m_classObjectMap[className];
+        objectMap.clear();
+    }
+}
+
+bool DataManager::isOpen() const
+{
+    return m_database.isOpen();
+}
+
+void DataManager::setConnectionName(const QString &name)
+{
+    if (m_database.isOpen())
+    {
+        qDebug() << "Error: setConnectionName, the database is open.";
+        return;
+    }
+
+    m_connectionName = name;
+}
+
+QString DataManager::connectionName() const
+{
+    return m_connectionName;
+}
+
+void DataManager::setIdBase(qint64 base)
+{
+    m_idBase = qMax(Q_INT64_C(0), base);
+
+    for (auto & pTable : m_tableMap.values())
+        pTable->setLastId(-1);
+}
+
+qint64 DataManager::idBase() const
+{
+    return m_idBase;
+}
+
+void DataManager::setIdBlockSize(const QMetaObject *pMetaObject, int blockSize)
+{
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable)
+        return;
+
+    pTable->setIdBlockSize(qMax(0, blockSize));
+    pTable->setIdBlock(0, 0);
+}
+
+bool DataManager::beginTransaction()
+{
+    if (m_transactionDepth > 0)
+    {
+        if (!m_pWriteBehind)
+        {
+            QSqlQuery query(m_database);
+            if (!query.exec(QString("SAVEPOINT cg_%1").arg(m_transactionDepth)))
+            {
+                qDebug() << "Error: beginTransaction, " << query.lastError();
+                return false;
+            }
+        }
+
+        // the changes of the savepoint are collected on their own until it is released
+        m_savepointChanges.append(m_pendingChanges);
+        m_pendingChanges.clear();
+        m_transactionDepth++;
+        return true;
+    }
+
+    // changes made before the transaction are reported on their own
+    flushChanges();
+
+    // with write-behind the transaction only groups notifications, the writer owns the writes
+    if (!m_pWriteBehind && !m_database.transaction())
+    {
+        qDebug() << "Error: beginTransaction, " << m_database.lastError();
+        return false;
+    }
+
+    m_transactionDepth = 1;
+    return true;
+}
+
+bool DataManager::commitTransaction()
+{
+    if (m_transactionDepth == 0)
+        return false;
+
+    if (m_transactionDepth > 1)
+    {
+        if (!m_pWriteBehind)
+        {
+            QSqlQuery query(m_database);
+            if (!query.exec(QString("RELEASE SAVEPOINT cg_%1").arg(m_transactionDepth - 1)))
+            {
+                qDebug() << "Error: commitTransaction, " << query.lastError();
+                rollbackTransaction();
+                return false;
+            }
+        }
+
+        ChangeSet changes = m_savepointChanges.takeLast();
+        changes.merge(m_pendingChanges);
+        m_pendingChanges = changes;
+
+        // blocks reserved in the savepoint now belong to the enclosing one
+        for (auto & block : m_reservedBlocks)
+        {
+            if (block.depth == m_transactionDepth)
+                block.depth--;
+        }
+
+        m_transactionDepth--;
+        return true;
+    }
+
+    m_transactionDepth = 0;
+    if (!m_pWriteBehind && !m_database.commit())
+    {
+        qDebug() << "Error: commitTransaction, " << m_database.lastError();
+        m_transactionDepth = 1;
+        rollbackTransaction();
+        return false;
+    }
+
+    m_reservedBlocks.clear();
+    flushChanges();
+    return true;
+}
+
+bool DataManager::rollbackTransaction()
+{
+    if (m_transactionDepth == 0)
+        return false;
+
+    if (m_pWriteBehind)
+    {
+        qDebug() << "Error: rollbackTransaction, queued writes cannot be rolled back.";
+        if (m_transactionDepth > 1)
+        {
+            ChangeSet changes = m_savepointChanges.takeLast();
+            changes.merge(m_pendingChanges);
+            m_pendingChanges = changes;
+            m_transactionDepth--;
+            return false;
+        }
+
+        m_transactionDepth = 0;
+        flushChanges();
+        return false;
+    }
+
+    int depth = m_transactionDepth;
+    bool success = true;
+    if (m_transactionDepth > 1)
+    {
+        // rolling back to a savepoint keeps it open, so it is released as well
+        QSqlQuery query(m_database);
+        QString name = QString("cg_%1").arg(m_transactionDepth - 1);
+        success = query.exec(QString("ROLLBACK TO SAVEPOINT %1").arg(name)) && query.exec(QString("RELEASE SAVEPOINT %1").arg(name));
+        if (!success)
+            qDebug() << "Error: rollbackTransaction, " << query.lastError();
+
+        m_transactionDepth--;
+    }
+    else
+    {
+        m_transactionDepth = 0;
+        success = m_database.rollback();
+        if (!success)
+            qDebug() << "Error: rollbackTransaction, " << m_database.lastError();
+    }
+
+    revertChanges(m_pendingChanges);
+    m_pendingChanges = m_transactionDepth > 0 ? m_savepointChanges.takeLast() : ChangeSet();
+
+    // objects persisted in the transaction were dropped from the identity map with their rows
+    for (int i = m_persistedObjects.size() - 1; i >= 0; i--)
+    {
+        DataObjectPtr pObject = m_persistedObjects.at(i);
+        if (m_classObjectMap.value(pObject->metaObject()->className()).value(pObject->id()).lock() != pObject)
+            m_persistedObjects.removeAt(i);
+    }
+
+    // blocks reserved in the transaction went back to the sequence table, so their ids will be
+    // handed out again and pending objects holding them can no longer be persisted
+    for (int i = m_reservedBlocks.size() - 1; i >= 0; i--)
+    {
+        const ReservedBlock block = m_reservedBlocks.at(i);
+        if (block.depth < depth)
+            continue;
+
+        for (auto & pObject : DataObjects(m_pendingObjects))
+        {
+            if (m_tableMap.value(pObject->metaObject()->className()) == block.pTable && pObject->id() >= block.start && pObject->id() < block.end)
+                removePendingObject(pObject);
+        }
+
+        block.pTable->setIdBlock(0, 0);
+        m_reservedBlocks.removeAt(i);
+    }
+
+    return success;
+}
+
+bool DataManager::setWriteBehindEnabled(bool enabled, int batchSize, int flushInterval)
+{
+    if (!enabled)
+    {
+        // ids come from the database again once nothing is queued
+        delete m_pWriteBehind;
+        m_pWriteBehind = nullptr;
+        return true;
+    }
+
+    if (!m_database.isOpen() || m_inMemory || m_transactionDepth > 0 || m_archiveAttached)
+    {
+        qDebug() << "Error: setWriteBehindEnabled, write-behind needs an open database file, no open transaction and no archive.";
+        return false;
+    }
+
+    delete m_pWriteBehind;
+    m_pWriteBehind = new WriteBehindQueue(m_database.databaseName(), batchSize, flushInterval);
+    m_pWriteBehind->setPaused(m_pBackup != nullptr);
+
+    for (auto & pTable : m_tableMap.values())
+        pTable->setLastId(-1);
+
+    // reads wait for the writer's commits instead of failing
+    QSqlQuery query(m_database);
+    if (!query.exec("PRAGMA busy_timeout = 5000"))
+        qDebug() << "Error: setWriteBehindEnabled, " << query.lastError();
+
+    return true;
+}
+
+bool DataManager::isWriteBehindEnabled() const
+{
+    return m_pWriteBehind != nullptr;
+}
+
+void DataManager::flush()
+{
+    if (m_pWriteBehind)
+        m_pWriteBehind->flush();
+}
+
+bool DataManager::waitForDurable(int timeout)
+{
+    if (!m_pWriteBehind)
+        return true;
+
+    // queued writes are held back while a backup runs, so it is completed first
+    if (m_pBackup)
+    {
+        m_backupPagesPerStep = -1;
+        stepBackup();
+    }
+
+    return m_pWriteBehind->waitForDurable(timeout);
+}
+
+bool DataManager::backupTo(const QString &path, int pagesPerStep, BackupProgressFunction progress)
+{
+    if (!m_database.isOpen() || m_pBackup)
+    {
+        qDebug() << "Error: backupTo, needs an open database and no other backup running.";
+        return false;
+    }
+
+    if (QFile::exists(path))
+    {
+        qDebug() << "Error: backupTo, " << path << " already exists.";
+        return false;
+    }
+
+    // the copy starts from everything written so far
+    waitForDurable();
+
+    m_pBackup = new DatabaseBackup(sqliteHandle(), path);
+    if (!m_pBackup->isValid())
+    {
+        qDebug() << "Error: backupTo, " << m_pBackup->errorString();
+        delete m_pBackup;
+        m_pBackup = nullptr;
+        return false;
+    }
+
+    // a write-behind commit comes from another connection and would restart the copy
+    if (m_pWriteBehind)
+        m_pWriteBehind->setPaused(true);
+
+    m_backupPagesPerStep = pagesPerStep > 0 ? pagesPerStep : -1;
+    m_backupProgress = progress;
+    QTimer::singleShot(0, this, &DataManager::stepBackup);
+
+    return true;
+}
+
+bool DataManager::isBackupRunning() const
+{
+    return m_pBackup != nullptr;
+}
+
+void DataManager::cancelBackup()
+{
+    if (!m_pBackup)
+        return;
+
+    QString path = m_pBackup->path();
+    m_pBackup->cancel();
+    delete m_pBackup;
+    m_pBackup = nullptr;
+    m_backupProgress = BackupProgressFunction();
+
+    if (m_pWriteBehind)
+        m_pWriteBehind->setPaused(false);
+
+    emit backupFinished(path, false);
+}
+
+void DataManager::stepBackup()
+{
+    if (!m_pBackup)
+        return;
+
+    bool more = m_pBackup->step(m_backupPagesPerStep);
+
+    if (m_backupProgress && !m_backupProgress(m_pBackup->remainingPages(), m_pBackup->pageCount()) && more)
+    {
+        cancelBackup();
+        return;
+    }
+
+    if (more)
+    {
+        // one step per pass through the event loop, so other work runs in between
+        QTimer::singleShot(0, this, &DataManager::stepBackup);
+        return;
+    }
+
+    QString path = m_pBackup->path();
+    bool success = m_pBackup->isComplete();
+    if (!success)
+        qDebug() << "Error: backupTo, " << m_pBackup->errorString();
+
+    delete m_pBackup;
+    m_pBackup = nullptr;
+    m_backupProgress = BackupProgressFunction();
+
+    if (m_pWriteBehind)
+        m_pWriteBehind->setPaused(false);
+
+    emit backupFinished(path, success);
+}
+
+bool DataManager::snapshotTo(const QString &path)
+{
+    if (!m_database.isOpen() || m_transactionDepth > 0)
+    {
+        qDebug() << "Error: snapshotTo, needs an open database and no open transaction.";
+        return false;
+    }
+
+    waitForDurable();
+
+    // VACUUM INTO needs SQLite 3.27; older libraries get an uncompacted copy from the backup API
+    if (sqliteVersion(m_database) < 3027000)
+    {
+        if (QFile::exists(path))
+        {
+            qDebug() << "Error: snapshotTo, " << path << " already exists.";
+            return false;
+        }
+
+        TraceSpan span(activeTrace(), "step", "backup");
+        DatabaseBackup backup(sqliteHandle(), path);
+        backup.step(-1);
+        if (!backup.isComplete())
+        {
+            qDebug() << "Error: snapshotTo, " << backup.errorString();
+            return false;
+        }
+
+        return true;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("VACUUM INTO ?");
+    query.addBindValue(path);
+
+    TraceSpan span(activeTrace(), "step", "VACUUM INTO");
+    if (!query.exec())
+    {
+        qDebug() << "Error: snapshotTo, " << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+namespace
+{
+    // a value read from CSV or JSON, normalized through the column's converter like a property
+    // value on its way into the database; link table columns (no Column) hold ids
+    QVariant storedValue(const QVariant &value, const Column *pColumn)
+    {
+        QString sqliteType = pColumn ? pColumn->sqliteType() : QString("INTEGER");
+
+        if (value.isNull() || (value.type() == QVariant::String && value.toString().isEmpty() && sqliteType != "TEXT"))
+            return QVariant();
+
+        if (!pColumn)
+            return value.toLongLong();
+
+        QVariant stored = value;
+        if (sqliteType == "BLOB" && value.type() == QVariant::String)
+            stored = QByteArray::fromBase64(value.toString().toLatin1());
+
+        if (!pColumn->hasConverter())
+            return stored;
+
+        return pColumn->toSQLite(pColumn->fromSQLite(stored));
+    }
+}
+
+qint64 DataManager::importFrom(const QMetaObject *pMetaObject, QIODevice *pDevice, DataFormat format, int chunkSize, bool *ok)
+{
+    return importFrom(pMetaObject, QString(), pDevice, format, chunkSize, ok);
+}
+
+qint64 DataManager::importFrom(const QMetaObject *pMetaObject, const QString &relationshipName, QIODevice *pDevice, DataFormat format, int chunkSize, bool *ok)
+{
+    if (ok)
+        *ok = false;
+
+    QString name;
+    QStringList names;
+    QList<const Column*> columns;
+    if (!transferColumns(pMetaObject, relationshipName, name, names, columns))
+    {
+        qDebug() << "Error: importFrom, unknown class or many-to-many relationship " << relationshipName;
+        return -1;
+    }
+
+    if (!m_database.isOpen() || m_transactionDepth > 0 || !pDevice || !pDevice->isReadable())
+    {
+        qDebug() << "Error: importFrom, needs an open database, no open transaction and a readable device.";
+        return -1;
+    }
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::CreateOperation);
+
+    // rows go straight to the database, after anything still queued
+    waitForDurable();
+
+    Table *pTable = m_tableMap.value(name);
+    bool reportCreated = relationshipName.isEmpty() && isSignalConnected(QMetaMethod::fromSignal(&DataManager::changesCommitted));
+    chunkSize = qMax(1, chunkSize);
+
+    // CSV columns are fixed by the header row, JSON keys may differ from line to line
+    QVector<int> csvColumns;
+    QString csvSql;
+    QStringList fields;
+    if (format == CsvFormat)
+    {
+        if (!readCsvRecord(pDevice, fields))
+        {
+            if (ok)
+                *ok = true;
+            return 0;
+        }
+
+        QStringList placeholders;
+        for (auto & field : fields)
+        {
+            int index = names.indexOf(field.trimmed());
+            if (index < 0)
+                qDebug() << "Warning: importFrom, ignoring unknown column " << field;
+            else
+                placeholders.append("?");
+            csvColumns.append(index);
+        }
+
+        QStringList columnNames;
+        for (auto index : csvColumns)
+        {
+            if (index >= 0)
+                columnNames.append(names.at(index));
+        }
+
+        if (columnNames.isEmpty())
+        {
+            qDebug() << "Error: importFrom, no known columns in the header.";
+            return -1;
+        }
+
+        csvSql = QString("INSERT INTO %1 (%2) VALUES (%3)").arg(name).arg(columnNames.join(", ")).arg(placeholders.join(", "));
+    }
+
+    // rows of the open chunk are only counted and reported once it is committed
+    qint64 count = 0;
+    qint64 chunkCount = 0;
+    ChangeSet chunkChanges;
+    bool success = true;
+    if (!m_database.transaction())
+    {
+        qDebug() << "Error: importFrom, " << m_database.lastError();
+        return -1;
+    }
+
+    forever
+    {
+        QString sql;
+        QVariantList values;
+        qint64 id = 0;
+
+        if (format == CsvFormat)
+        {
+            if (!readCsvRecord(pDevice, fields))
+                break;
+            if (fields.size() == 1 && fields.at(0).isEmpty())
+                continue;
+
+            sql = csvSql;
+            for (int i = 0; i < csvColumns.size(); i++)
+            {
+                int index = csvColumns.at(i);
+                if (index < 0)
+                    continue;
+
+                QString field = fields.value(i);
+                values.append(storedValue(field.isNull() ? QVariant() : QVariant(field), columns.at(index)));
+                if (index == 0 && pTable)
+                    id = values.last().toLongLong();
+            }
+        }
+        else
+        {
+            if (pDevice->atEnd())
+                break;
+
+            QByteArray line = pDevice->readLine().trimmed();
+            if (line.isEmpty())
+                continue;
+
+            QJsonParseError error;
+            QJsonDocument document = QJsonDocument::fromJson(line, &error);
+            if (!document.isObject())
+            {
+                qDebug() << "Error: importFrom, line " << count + chunkCount + 1 << ": " << error.errorString();
+                success = false;
+                break;
+            }
+
+            QJsonObject object = document.object();
+            QStringList columnNames, placeholders;
+            for (auto it = object.constBegin(); it != object.constEnd(); ++it)
+            {
+                int index = names.indexOf(it.key());
+                if (index < 0)
+                    continue;
+
+                columnNames.append(names.at(index));
+                placeholders.append("?");
+                values.append(storedValue(it.value().toVariant(), columns.at(index)));
+                if (index == 0 && pTable)
+                    id = values.last().toLongLong();
+            }
+
+            if (columnNames.isEmpty())
+                continue;
+
+            sql = QString("INSERT INTO %1 (%2) VALUES (%3)").arg(name).arg(columnNames.join(", ")).arg(placeholders.join(", "));
+        }
+
+        QSqlQuery query = preparedQuery(sql);
+        for (auto & value : values)
+            query.addBindValue(value);
+
+        if (!query.exec())
+        {
+            qDebug() << "Error: importFrom, " << query.lastError();
+            success = false;
+            break;
+        }
+
+        if (reportCreated)
+            chunkChanges.addCreated(name, id > 0 ? id : query.lastInsertId().toLongLong());
+
+        query.finish();
+
+        if (++chunkCount == chunkSize)
+        {
+            if (!m_database.commit())
+            {
+                qDebug() << "Error: importFrom, " << m_database.lastError();
+                success = false;
+                break;
+            }
+
+            count += chunkCount;
+            m_pendingChanges.merge(chunkChanges);
+            chunkChanges.clear();
+            chunkCount = 0;
+
+            if (!m_database.transaction())
+            {
+                qDebug() << "Error: importFrom, " << m_database.lastError();
+                success = false;
+                break;
+            }
+        }
+    }
+
+    if (success && !m_database.commit())
+    {
+        qDebug() << "Error: importFrom, " << m_database.lastError();
+        success = false;
+    }
+
+    if (success)
+    {
+        count += chunkCount;
+        m_pendingChanges.merge(chunkChanges);
+    }
+    else
+    {
+        // earlier chunks stay committed
+        m_database.rollback();
+    }
+
+    if (ok)
+        *ok = success;
+
+    // ids handed out for write-behind, cached objects and relationship lists may all be stale
+    if (pTable)
+        pTable->setLastId(-1);
+    clearCache();
+
+    if (reportCreated)
+        scheduleChanges();
+    else if (count > 0)
+        emit databaseChanged();
+
+    return count;
+}
+
+qint64 DataManager::exportTo(const QMetaObject *pMetaObject, QIODevice *pDevice, DataFormat format) const
+{
+    return exportTo(pMetaObject, QString(), pDevice, format);
+}
+
+qint64 DataManager::exportTo(const QMetaObject *pMetaObject, const QString &relationshipName, QIODevice *pDevice, DataFormat format) const
+{
+    QString name;
+    QStringList names;
+    QList<const Column*> columns;
+    if (!transferColumns(pMetaObject, relationshipName, name, names, columns))
+    {
+        qDebug() << "Error: exportTo, unknown class or many-to-many relationship " << relationshipName;
+        return -1;
+    }
+
+    if (!m_database.isOpen() || !pDevice || !pDevice->isWritable())
+    {
+        qDebug() << "Error: exportTo, needs an open database and a writable device.";
+        return -1;
+    }
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::ReadOperation);
+
+    // stored values are written as they are, row by row, without hydrating objects
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT %1 FROM %2 ORDER BY rowid").arg(names.join(", ")).arg(name));
+
+    TraceSpan span(activeTrace(), "step", query.lastQuery());
+    if (!query.exec())
+    {
+        qDebug() << "Error: exportTo, " << query.lastError();
+        return -1;
+    }
+
+    if (format == CsvFormat)
+        pDevice->write(names.join(',').toUtf8() + "\r\n");
+
+    qint64 count = 0;
+    while (query.next())
+    {
+        if (format == CsvFormat)
+        {
+            QStringList fields;
+            for (int i = 0; i < names.size(); i++)
+                fields.append(csvField(query.value(i)));
+            pDevice->write(fields.join(',').toUtf8() + "\r\n");
+        }
+        else
+        {
+            QJsonObject object;
+            for (int i = 0; i < names.size(); i++)
+                object.insert(names.at(i), jsonField(query.value(i)));
+            pDevice->write(QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n");
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+bool DataManager::transferColumns(const QMetaObject *pMetaObject, const QString &relationshipName, QString &name, QStringList &names, QList<const Column*> &columns) const
+{
+    Table *pTable = pMetaObject ? m_tableMap.value(pMetaObject->className()) : nullptr;
+    if (!pTable)
+        return false;
+
+    // a class table's columns start with id
+    if (relationshipName.isEmpty())
+    {
+        name = pTable->name();
+        for (auto & column : pTable->columns())
+        {
+            if (column.name() == "id")
+            {
+                names.prepend(column.name());
+                columns.prepend(&column);
+            }
+            else
+            {
+                names.append(column.name());
+                columns.append(&column);
+            }
+        }
+
+        return true;
+    }
+
+    Relationship *pRelationship = pTable->relationship(relationshipName);
+    if (!pRelationship || pRelationship->type() != Relationship::ManyToManyType || !pRelationship->inverseRelationship())
+        return false;
+
+    Relationship *pInverseRelationship = pRelationship->inverseRelationship();
+    Table *pLinkTable = m_tableMap.value(tableName(pMetaObject, relationshipName, pInverseRelationship->metaObject(), pInverseRelationship->name()));
+    if (!pLinkTable || !pLinkTable->relationship1() || !pLinkTable->relationship2())
+        return false;
+
+    name = pLinkTable->name();
+    names << pLinkTable->relationship1()->name() << pLinkTable->relationship2()->name();
+    columns << nullptr << nullptr;
+
+    return true;
+}
+
+bool DataManager::attachArchive(const QString &path)
+{
+    if (!m_database.isOpen() || m_archiveAttached || m_pWriteBehind || m_transactionDepth > 0)
+    {
+        qDebug() << "Error: attachArchive, needs an open database without an archive, write-behind or open transaction.";
+        return false;
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare("ATTACH DATABASE ? AS archive");
+    query.addBindValue(path);
+    if (!query.exec())
+    {
+        qDebug() << "Error: attachArchive, " << query.lastError();
+        return false;
+    }
+
+    // the archive has the class tables without their full-text indexes; a temporary view
+    // per class covers the hot and archived rows together
+    for (auto & pTable : m_tableMap.values())
+    {
+        if (!pTable->metaObject())
+            continue;
+
+        QSqlQuery createQuery(m_database);
+        if (!createQuery.exec(QString("CREATE TABLE IF NOT EXISTS archive.%1 (%2)").arg(pTable->name()).arg(pTable->columnDefinitions())) ||
+            !createQuery.exec(QString("CREATE TEMP VIEW IF NOT EXISTS %1_all AS SELECT * FROM main.%1 UNION ALL SELECT * FROM archive.%1").arg(pTable->name())))
+        {
+            qDebug() << "Error: attachArchive, " << createQuery.lastError();
+            createQuery.finish();
+            m_archiveAttached = true;
+            detachArchive();
+            return false;
+        }
+    }
+
+    // statements prepared before now read the hot tables only, and ids are handed out
+    // above the archived ones
+    m_statements.clear();
+    m_archiveAttached = true;
+
+    if (isChangeLogged() && !createArchiveLog())
+    {
+        detachArchive();
+        return false;
+    }
+
+    for (auto & pTable : m_tableMap.values())
+        pTable->setLastId(-1);
+
+    return true;
+}
+
+void DataManager::detachArchive()
+{
+    if (!m_archiveAttached)
+        return;
+
+    m_statements.clear();
+    m_archiveAttached = false;
+
+    QSqlQuery query(m_database);
+    for (auto & pTable : m_tableMap.values())
+    {
+        if (!pTable->metaObject())
+            continue;
+
+        query.exec(QString("DROP VIEW IF EXISTS temp.%1_all").arg(pTable->name()));
+        query.exec(QString("DROP TRIGGER IF EXISTS temp.%1_archive_log_au").arg(pTable->name()));
+        query.exec(QString("DROP TRIGGER IF EXISTS temp.%1_archive_log_ad").arg(pTable->name()));
+    }
+
+    if (!query.exec("DETACH DATABASE archive"))
+        qDebug() << "Error: detachArchive, " << query.lastError();
+}
+
+bool DataManager::isArchiveAttached() const
+{
+    return m_archiveAttached;
+}
+
+void DataManager::setArchivePolicy(const QMetaObject *pMetaObject, const QString &condition)
+{
+    if (condition.isEmpty())
+        m_archivePolicies.remove(pMetaObject->className());
+    else
+        m_archivePolicies.insert(pMetaObject->className(), condition);
+}
+
+bool DataManager::raiseSequence(Table *pTable)
+{
+    // the sequence keeps new ids above the archived ones, also while the archive is detached
+    if (!createSequence(pTable))
+        return false;
+
+    QSqlQuery query(m_database);
+    query.prepare(QString("UPDATE cgdata_sequence SET next_id = MAX(next_id, (SELECT IFNULL(MAX(id), 0) + 1 FROM archive.%1)) WHERE class = ?").arg(pTable->name()));
+    query.addBindValue(pTable->name());
+    if (!query.exec())
+    {
+        qDebug() << "Error: archive, " << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+qint64 DataManager::archive(int batchSize)
+{
+    if (!m_archiveAttached || m_transactionDepth > 0)
+    {
+        qDebug() << "Error: archive, needs an attached archive and no open transaction.";
+        return -1;
+    }
+
+    batchSize = qMax(1, batchSize);
+    qint64 count = 0;
+    bool logged = isChangeLogged();
+
+    for (auto it = m_archivePolicies.constBegin(); it != m_archivePolicies.constEnd(); ++it)
+    {
+        Table *pTable = m_tableMap.value(it.key());
+        if (!pTable)
+            continue;
+
+        forever
+        {
+            QSqlQuery query(m_database);
+            if (!query.exec(QString("SELECT id FROM main.%1 WHERE %2 LIMIT %3").arg(pTable->name()).arg(it.value()).arg(batchSize)))
+            {
+                qDebug() << "Error: archive, " << query.lastError();
+                return -1;
+            }
+
+            QStringList ids;
+            while (query.next())
+                ids.append(query.value(0).toString());
+            query.finish();
+
+            if (ids.isEmpty())
+                break;
+
+            // each batch moves in its own transaction, so the write lock is held briefly;
+            // the hot table's delete trigger takes the rows out of the full-text index
+            QString idList = ids.join(", ");
+            if (!m_database.transaction())
+            {
+                qDebug() << "Error: archive, " << m_database.lastError();
+                m_database.rollback();
+                return -1;
+            }
+            qint64 sequence = logged ? lastChangeSequence() : 0;
+
+            // the hot table's delete trigger logs the move as a delete, which it is not
+            QString logSql = QString("UPDATE cgdata_changes SET operation = %1 WHERE seq > %2 AND class = '%3' AND operation = %4 AND object_id IN (%5)")
+                .arg(ChangeRecord::Archived).arg(sequence).arg(pTable->name()).arg(ChangeRecord::Deleted).arg(idList);
+
+            if (!query.exec(QString("INSERT INTO archive.%1 SELECT * FROM main.%1 WHERE id IN (%2)").arg(pTable->name()).arg(idList)) ||
+                !query.exec(QString("DELETE FROM main.%1 WHERE id IN (%2)").arg(pTable->name()).arg(idList)) ||
+                (logged && !query.exec(logSql)) ||
+                !raiseSequence(pTable))
+            {
+                qDebug() << "Error: archive, " << query.lastError();
+                m_database.rollback();
+                return -1;
+            }
+
+            if (!m_database.commit())
+            {
+                qDebug() << "Error: archive, " << m_database.lastError();
+                m_database.rollback();
+                return -1;
+            }
+
+            count += ids.size();
+            if (ids.size() < batchSize)
+                break;
+        }
+    }
+
+    return count;
+}
+
+QString DataManager::sourceName(Table *pTable, bool includeArchive) const
+{
+    if (includeArchive && m_archiveAttached && pTable->metaObject())
+        return pTable->name() + "_all";
+
+    return pTable->name();
+}
+
+bool DataManager::deleteArchived(Table *pTable, const QString &columnName, qint64 id)
+{
+    QString sql = QString("DELETE FROM archive.%1 WHERE %2 = ?").arg(pTable->name()).arg(columnName);
+    QSqlQuery query = preparedQuery(sql);
+    query.addBindValue(id);
+
+    TraceSpan span(activeTrace(), "step", sql);
+    bool success = query.exec();
+    if (!success)
+        qDebug() << "Error: deleteArchived, " << query.lastError();
+
+    query.finish();
+    return success;
+}
+
+namespace
+{
+    const int MaxRefreshIds = 500;
+}
+
+bool DataManager::setChangeDetectionEnabled(bool enabled, int pollInterval, int retention)
+{
+    m_changeDetection = enabled;
+    m_changeRetention = qMax(0, retention);
+
+    if (!enabled)
+    {
+        if (m_pChangeTimer)
+            m_pChangeTimer->stop();
+
+        // nothing trims the log any more, so the triggers go unless a consumer still reads it
+        if (m_database.isOpen() && !isChangeCaptureEnabled())
+            return dropChangeLog();
+        return true;
+    }
+
+    if (!m_pChangeTimer)
+    {
+        m_pChangeTimer = new QTimer(this);
+        connect(m_pChangeTimer, &QTimer::timeout, this, &DataManager::checkForChanges);
+    }
+    m_pChangeTimer->setInterval(qMax(1, pollInterval));
+
+    if (m_database.isOpen() && !startChangeDetection())
+    {
+        m_changeDetection = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool DataManager::isChangeDetectionEnabled() const
+{
+    return m_changeDetection;
+}
+
+bool DataManager::createChangeLog()
+{
+    QSqlQuery query(m_database);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS cgdata_changes (seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "class TEXT NOT NULL, object_id INTEGER NOT NULL, operation INTEGER NOT NULL)"))
+    {
+        qDebug() << "Error: createChangeLog, " << query.lastError();
+        return false;
+    }
+
+    // the triggers are stored in the file, so writes are logged from every connection,
+    // including those that do not watch for changes themselves
+    for (auto & pTable : m_tableMap.values())
+    {
+        // many-to-many rows have no id; their entries only say which table changed
+        QString newId = pTable->metaObject() ? "new.id" : "new.rowid";
+        QString oldId = pTable->metaObject() ? "old.id" : "old.rowid";
+        QString logString = QString("INSERT INTO cgdata_changes(class, object_id, operation) VALUES('%1', %2, %3);");
+
+        QStringList triggers;
+        triggers << QString("CREATE TRIGGER IF NOT EXISTS %1_log_ai AFTER INSERT ON %1 BEGIN %2 END;")
+            .arg(pTable->name()).arg(logString.arg(pTable->name()).arg(newId).arg(ChangeRecord::Inserted));
+        triggers << QString("CREATE TRIGGER IF NOT EXISTS %1_log_au AFTER UPDATE ON %1 BEGIN %2 END;")
+            .arg(pTable->name()).arg(logString.arg(pTable->name()).arg(newId).arg(ChangeRecord::Updated));
+        triggers << QString("CREATE TRIGGER IF NOT EXISTS %1_log_ad AFTER DELETE ON %1 BEGIN %2 END;")
+            .arg(pTable->name()).arg(logString.arg(pTable->name()).arg(oldId).arg(ChangeRecord::Deleted));
+
+        for (auto & sql : triggers)
+        {
+            if (!query.exec(sql))
+            {
+                qDebug() << "Error: createChangeLog, " << query.lastError();
+                return false;
+            }
+        }
+    }
+
+    return !m_archiveAttached || createArchiveLog();
+}
+
+bool DataManager::isChangeLogged() const
+{
+    // the log table outlives its triggers, which are what detection and capture depend on
+    QSqlQuery query(m_database);
+    return query.exec("SELECT 1 FROM main.sqlite_master WHERE type = 'trigger' AND name LIKE '%\\_log\\_ad' ESCAPE '\\'") && query.next();
+}
+
+bool DataManager::createArchiveLog()
+{
+    // only temporary triggers may write across databases, so archived rows are logged for the
+    // connections that attach the archive
+    QSqlQuery query(m_database);
+    for (auto & pTable : m_tableMap.values())
+    {
+        if (!pTable->metaObject())
+            continue;
+
+        QString logString = QString("INSERT INTO main.cgdata_changes(class, object_id, operation) VALUES('%1', %2, %3);");
+
+        QStringList triggers;
+        triggers << QString("CREATE TEMP TRIGGER IF NOT EXISTS %1_archive_log_au AFTER UPDATE ON archive.%1 BEGIN %2 END;")
+            .arg(pTable->name()).arg(logString.arg(pTable->name()).arg("new.id").arg(ChangeRecord::Updated));
+        triggers << QString("CREATE TEMP TRIGGER IF NOT EXISTS %1_archive_log_ad AFTER DELETE ON archive.%1 BEGIN %2 END;")
+            .arg(pTable->name()).arg(logString.arg(pTable->name()).arg("old.id").arg(ChangeRecord::Deleted));
+
+        for (auto & sql : triggers)
+        {
+            if (!query.exec(sql))
+            {
+                qDebug() << "Error: createArchiveLog, " << query.lastError();
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool DataManager::dropChangeLog()
+{
+    // the log table stays, so sqlite_sequence keeps counting where it left off
+    QSqlQuery query(m_database);
+    for (auto & pTable : m_tableMap.values())
+    {
+        for (auto & suffix : QStringList() << "log_ai" << "log_au" << "log_ad" << "archive_log_au" << "archive_log_ad")
+        {
+            if (!query.exec(QString("DROP TRIGGER IF EXISTS %1_%2").arg(pTable->name()).arg(suffix)))
+            {
+                qDebug() << "Error: dropChangeLog, " << query.lastError();
+                return false;
+            }
+        }
+    }
+
+    if (m_database.tables().contains("cgdata_changes") && !query.exec("DELETE FROM cgdata_changes"))
+    {
+        qDebug() << "Error: dropChangeLog, " << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+bool DataManager::startChangeDetection()
+{
+    if (!createChangeLog())
+        return false;
+
+    // changes from before now are already reflected in what gets read from here on
+    QSqlQuery query(m_database);
+    if (!query.exec("PRAGMA data_version") || !query.next())
+    {
+        qDebug() << "Error: startChangeDetection, " << query.lastError();
+        return false;
+    }
+    m_dataVersion = query.value(0).toLongLong();
+    query.finish();
+
+    m_lastChangeSequence = lastChangeSequence();
+    m_pChangeTimer->start();
+
+    return true;
+}
+
+bool DataManager::setChangeCaptureEnabled(bool enabled)
+{
+    if (!m_database.isOpen())
+    {
+        qDebug() << "Error: setChangeCaptureEnabled, the database is not open.";
+        return false;
+    }
+
+    // the marker is kept in the file so that no connection trims the log behind the consumers' backs
+    QSqlQuery query(m_database);
+    if ((enabled && (!createChangeLog() || !query.exec("CREATE TABLE IF NOT EXISTS cgdata_capture (id INTEGER PRIMARY KEY)"))) ||
+        (!enabled && !query.exec("DROP TABLE IF EXISTS cgdata_capture")))
+    {
+        qDebug() << "Error: setChangeCaptureEnabled, " << query.lastError();
+        return false;
+    }
+
+    // without detection nothing reads or trims the log any more
+    if (!enabled && !m_changeDetection)
+        return dropChangeLog();
+
+    return true;
+}
+
+bool DataManager::isChangeCaptureEnabled() const
+{
+    if (!m_database.isOpen())
+        return false;
+
+    QSqlQuery query(m_database);
+    return query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'cgdata_capture'") && query.next();
+}
+
+qint64 DataManager::lastChangeSequence() const
+{
+    // sqlite_sequence remembers the last entry even after the log is truncated to nothing
+    QSqlQuery query(m_database);
+    if (query.exec("SELECT seq FROM sqlite_sequence WHERE name = 'cgdata_changes'") && query.next())
+        return query.value(0).toLongLong();
+
+    return 0;
+}
+
+QList<ChangeRecord> DataManager::changesSince(qint64 sequence, int limit) const
+{
+    QList<ChangeRecord> records;
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT seq, class, object_id, operation FROM cgdata_changes WHERE seq > ? ORDER BY seq LIMIT ?");
+    query.addBindValue(sequence);
+    query.addBindValue(limit > 0 ? limit : -1);
+
+    if (!query.exec())
+    {
+        qDebug() << "Error: changesSince, " << query.lastError();
+        return records;
+    }
+
+    while (query.next())
+    {
+        ChangeRecord record;
+        record.sequence = query.value(0).toLongLong();
+        record.className = query.value(1).toString();
+        record.id = query.value(2).toLongLong();
+        record.type = ChangeRecord::Type(query.value(3).toInt());
+        records.append(record);
+    }
+
+    return records;
+}
+
+bool DataManager::truncateChanges(qint64 sequence)
+{
+    QSqlQuery query(m_database);
+    query.prepare("DELETE FROM cgdata_changes WHERE seq <= ?");
+    query.addBindValue(sequence);
+
+    if (!query.exec())
+    {
+        qDebug() << "Error: truncateChanges, " << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+void DataManager::checkForChanges()
+{
+    // an open transaction of our own would be read back as a change
+    if (!m_changeDetection || !m_database.isOpen() || m_transactionDepth > 0)
+        return;
+
+    // the log and data_version are read from one snapshot; a commit landing between two
+    // separate reads would be counted as seen without being read
+    if (!m_database.transaction())
+    {
+        qDebug() << "Error: checkForChanges, " << m_database.lastError();
+        return;
+    }
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT (SELECT MIN(seq) FROM cgdata_changes), "
+        "(SELECT seq FROM sqlite_sequence WHERE name = 'cgdata_changes')") || !query.next())
+    {
+        qDebug() << "Error: checkForChanges, " << query.lastError();
+        query.finish();
+        m_database.rollback();
+        return;
+    }
+    bool logEmpty = query.value(0).isNull();
+    qint64 minSequence = query.value(0).toLongLong();
+    qint64 maxSequence = query.value(1).toLongLong();
+
+    if (!query.exec("PRAGMA data_version") || !query.next())
+    {
+        qDebug() << "Error: checkForChanges, " << query.lastError();
+        query.finish();
+        m_database.rollback();
+        return;
+    }
+    qint64 dataVersion = query.value(0).toLongLong();
+    query.finish();
+    m_database.commit();
+
+    // data_version only moves when another connection commits, so until it does everything
+    // logged was written through this connection and is already in memory
+    if (dataVersion == m_dataVersion)
+    {
+        m_lastChangeSequence = maxSequence;
+        pruneChangeLog(logEmpty ? maxSequence : minSequence, maxSequence);
+        return;
+    }
+    m_dataVersion = dataVersion;
+
+    QMap<QString, QList<qint64>> changedIds;
+
+    if (maxSequence > m_lastChangeSequence && (logEmpty || minSequence > m_lastChangeSequence + 1))
+    {
+        // entries were trimmed before they were read here, so every object is suspect
+        for (auto it = m_classObjectMap.constBegin(); it != m_classObjectMap.constEnd(); ++it)
+            changedIds.insert(it.key(), it.value().keys());
+        for (auto & pTable : m_tableMap.values())
+        {
+            if (!pTable->metaObject())
+                changedIds.insert(pTable->name(), QList<qint64>());
+        }
+    }
+    else if (maxSequence > m_lastChangeSequence)
+    {
+        query.prepare("SELECT class, object_id FROM cgdata_changes WHERE seq > ? AND seq <= ? ORDER BY seq");
+        query.addBindValue(m_lastChangeSequence);
+        query.addBindValue(maxSequence);
+        if (!query.exec())
+        {
+            qDebug() << "Error: checkForChanges, " << query.lastError();
+            return;
+        }
+
+        while (query.next())
+            changedIds[query.value(0).toString()].append(query.value(1).toLongLong());
+        query.finish();
+    }
+    m_lastChangeSequence = maxSequence;
+
+    for (auto it = changedIds.constBegin(); it != changedIds.constEnd(); ++it)
+    {
+        Table *pTable = m_tableMap.value(it.key());
+        if (!pTable)
+            continue;
+
+        // cached id lists may be missing inserted rows or still hold deleted ones
+        QList<Relationship*> relationships = pTable->relationships();
+        if (!pTable->metaObject())
+            relationships << pTable->relationship1() << pTable->relationship2();
+
+        for (auto & pRelationship : relationships)
+        {
+            if (pRelationship->cache())
+                pRelationship->cache()->clear();
+
+            Relationship *pInverseRelationship = pRelationship->inverseRelationship();
+            if (pInverseRelationship && pInverseRelationship->cache())
+                pInverseRelationship->cache()->clear();
+        }
+
+        if (pTable->metaObject())
+            refreshObjects(pTable, it.value());
+    }
+
+    pruneChangeLog(logEmpty ? maxSequence : minSequence, maxSequence);
+    scheduleChanges();
+}
+
+void DataManager::refreshObjects(Table *pTable, const QList<qint64> &ids)
+{
+    auto & objectMap = m_classObjectMap[pTable->name()];
+
+    // objects no longer in memory are read fresh the next time they are found
+    QMap<qint64, DataObjectPtr> objects;
+    for (auto id : ids)
+    {
+        DataObjectPtr pObject = objectMap.value(id).lock();
+        if (pObject)
+            objects.insert(id, pObject);
+    }
+
+    QList<qint64> objectIds = objects.keys();
+    for (int start = 0; start < objectIds.size(); start += MaxRefreshIds)
+    {
+        QStringList idList;
+        for (auto id : objectIds.mid(start, MaxRefreshIds))
+            idList.append(QString::number(id));
+
+        QString sql = QString("SELECT %1 FROM %2 WHERE id IN (%3)").arg(pTable->selectString()).arg(sourceName(pTable, true)).arg(idList.join(", "));
+        TraceSpan span(activeTrace(), "step", sql);
+
+        QSqlQuery query(m_database);
+        query.setForwardOnly(true);
+        if (!query.exec(sql))
+        {
+            qDebug() << "Error: refreshObjects, " << query.lastError();
+            return;
+        }
+
+        while (query.next())
+        {
+            DataObjectPtr pObject = objects.take(query.value(0).toLongLong());
+            if (!pObject)
+                continue;
+
+            // compared as stored values, which every property type converts to, so writes
+            // made through this connection are not reported a second time
+            bool changed = false;
+            auto & columns = pTable->selectColumns();
+            for (int i = 0; i < columns.size() && !changed; i++)
+            {
+                const Column &column = columns.at(i);
+                changed = column.read(pObject.data()) != column.toSQLite(column.fromSQLite(query.value(i + 1)));
+            }
+
+            // deferred columns are unloaded either way and read again when next used
+            readColumns(pTable, query, pObject);
+            if (!changed)
+                continue;
+
+            if (pTable->cache() && pTable->cache()->costMode() == EstimatedBytesCost)
+                cacheObject(pTable, pObject);
+
+            m_pendingChanges.addUpdated(pTable->name(), pObject->id());
+            emit objectUpdated(pObject);
+        }
+    }
+
+    // the rest have lost their rows
+    for (auto it = objects.constBegin(); it != objects.constEnd(); ++it)
+    {
+        objectMap.remove(it.key());
+        if (pTable->cache())
+            pTable->cache()->remove(pTable, it.key());
+        uncacheRelationships(pTable, it.key());
+
+        m_pendingChanges.addDeleted(pTable->name(), it.key());
+        emit objectDeleted(it.value());
+    }
+}
+
+void DataManager::revertChanges(const ChangeSet &changes)
+{
+    // objects created in the transaction no longer exist, and those changed in it are read
+    // again, as are cached copies
+    for (auto & className : changes.classNames())
+    {
+        auto & objectMap = m_classObjectMap[className];
+        for (auto id : changes.created(className))
+            objectMap.remove(id);
+
+        for (auto id : changes.updated(className))
+        {
+            DataObjectPtr pObject = objectMap.value(id).lock();
+            if (pObject)
+                readObject(pObject);
+        }
+    }
+
+    clearCache();
+}
+
+void DataManager::pruneChangeLog(qint64 minSequence, qint64 maxSequence)
+{
+    // trimmed in steps of a quarter of the retention rather than on every poll
+    if (m_changeRetention <= 0 || maxSequence - minSequence < m_changeRetention + m_changeRetention / 4)
+        return;
+
+    // while change capture is on only consumers truncate the log
+    QSqlQuery query(m_database);
+    query.prepare("DELETE FROM cgdata_changes WHERE seq <= ? AND "
+        "NOT EXISTS (SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'cgdata_capture')");
+    query.addBindValue(maxSequence - m_changeRetention);
+
+    // while another connection holds the write lock the log is trimmed on a later poll
+    if (!query.exec())
+        qDebug() << "Error: pruneChangeLog, " << query.lastError();
+}
+
+qint64 DataManager::allocateId(Table *pTable)
+{
+    if (pTable->idBlockSize() > 0)
+        return reserveId(pTable);
+
+    // queued inserts are not in the database yet and SQLite knows nothing of id bases or
+    // archived rows, so ids are handed out from memory
+    if (pTable->lastId() < 0)
+    {
+        qint64 lastId = 0;
+
+        QSqlQuery query(m_database);
+        query.prepare(QString("SELECT MAX(id) FROM %1").arg(sourceName(pTable, true)));
+        if (query.exec() && query.next())
+            lastId = query.value(0).toLongLong();
+
+        // rows moved to an archive that is not attached are remembered in the sequence table
+        if (pTable->isSequenced())
+        {
+            query.prepare("SELECT next_id - 1 FROM cgdata_sequence WHERE class = ?");
+            query.addBindValue(pTable->name());
+            if (query.exec() && query.next())
+                lastId = qMax(lastId, query.value(0).toLongLong());
+        }
+
+        pTable->setLastId(qMax(lastId, m_idBase));
+    }
+
+    pTable->setLastId(pTable->lastId() + 1);
+    return pTable->lastId();
+}
+
+bool DataManager::createSequence(Table *pTable)
+{
+    QSqlQuery query(m_database);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS cgdata_sequence (class TEXT PRIMARY KEY, next_id INTEGER NOT NULL)"))
+    {
+        qDebug() << "Error: createSequence, " << query.lastError();
+        return false;
+    }
+
+    query.prepare("INSERT OR IGNORE INTO cgdata_sequence (class, next_id) VALUES (?, 1)");
+    query.addBindValue(pTable->name());
+    if (!query.exec())
+    {
+        qDebug() << "Error: createSequence, " << query.lastError();
+        return false;
+    }
+
+    pTable->setSequenced(true);
+    return true;
+}
+
+bool DataManager::allocatesIds(Table *pTable) const
+{
+    // SQLite would reuse the ids of rows moved to the archive
+    return m_idBase > 0 || pTable->idBlockSize() > 0 || m_archiveAttached || pTable->isSequenced();
+}
+
+qint64 DataManager::reserveId(Table *pTable)
+{
+    if (pTable->nextBlockId() >= pTable->blockEnd())
+    {
+        if (!createSequence(pTable))
+            return 0;
+
+        // the update and the read share a savepoint, so connections never share ids; rows
+        // inserted without the sequence, by imports for example, are skipped over
+        QSqlQuery query(m_database);
+        if (!query.exec("SAVEPOINT cgdata_reserve"))
+        {
+            qDebug() << "Error: reserveId, " << query.lastError();
+            return 0;
+        }
+
+        auto rollback = [&query]() {
+            query.exec("ROLLBACK TO SAVEPOINT cgdata_reserve");
+            query.exec("RELEASE SAVEPOINT cgdata_reserve");
+        };
+
+        int size = pTable->idBlockSize();
+        query.prepare(QString("UPDATE cgdata_sequence SET next_id = MAX(next_id, (SELECT IFNULL(MAX(id), 0) + 1 FROM %1), ?) + ? "
+            "WHERE class = ?").arg(pTable->name()));
+        query.addBindValue(m_idBase + 1);
+        query.addBindValue(size);
+        query.addBindValue(pTable->name());
+        bool success = query.exec();
+
+        if (success)
+        {
+            query.prepare("SELECT next_id FROM cgdata_sequence WHERE class = ?");
+            query.addBindValue(pTable->name());
+            success = query.exec() && query.next();
+        }
+
+        if (!success)
+        {
+            qDebug() << "Error: reserveId, " << query.lastError();
+            rollback();
+            return 0;
+        }
+
+        qint64 end = query.value(0).toLongLong();
+        query.finish();
+        if (!query.exec("RELEASE SAVEPOINT cgdata_reserve"))
+        {
+            qDebug() << "Error: reserveId, " << query.lastError();
+            rollback();
+            return 0;
+        }
+
+        pTable->setIdBlock(end - size, end);
+
+        // with write-behind the transaction holds no database transaction, so nothing goes back
+        if (m_transactionDepth > 0 && !m_pWriteBehind)
+            m_reservedBlocks.append({pTable, end - size, end, m_transactionDepth});
+    }
+
+    qint64 id = pTable->nextBlockId();
+    pTable->setIdBlock(id + 1, pTable->blockEnd());
+    return id;
+}
+
+void DataManager::scheduleChanges()
+{
+    // only changesCommitted() is coalesced, databaseChanged() follows every write
+    emit databaseChanged();
+
+    if (m_changesScheduled || m_transactionDepth > 0)
+        return;
+
+    m_changesScheduled = true;
+    QTimer::singleShot(0, this, &DataManager::flushChanges);
+}
+
+void DataManager::flushChanges()
+{
+    m_changesScheduled = false;
+
+    if (m_transactionDepth > 0)
+        return;
+
+    // persisted objects are announced once no transaction can take them back
+    DataObjects objects = m_persistedObjects;
+    m_persistedObjects.clear();
+    for (auto & pObject : objects)
+        emit objectCreated(pObject);
+
+    if (m_pendingChanges.isEmpty())
+        return;
+
+    ChangeSet changes = m_pendingChanges;
+    m_pendingChanges.clear();
+
+    emit changesCommitted(changes);
+}
+
+bool DataManager::open(const QString &path)
+{
+    if (m_database.isOpen())
+        return false;
+
+    if (m_relationshipsDirty)
+        createRelationships();
+
+    clearObjects();
+
+    for (auto & pTable : m_tableMap.values())
+    {
+        pTable->setLastId(-1);
+        pTable->setSequenced(false);
+        pTable->setIdBlock(0, 0);
+    }
+
+    m_database = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    m_database.setDatabaseName(path);
+    // shared-cache memory databases are named with URIs such as file:name?mode=memory&cache=shared
+    if (path.startsWith("file:"))
+        m_database.setConnectOptions("QSQLITE_OPEN_URI");
+    m_inMemory = isMemoryPath(path);
+
+    if (!m_database.open())
+    {
+        qDebug() << "Error: unable to open database.";
+    }
+    else
+    {
+        // The C API is called on the driver's handle, which is only defined when the driver
+        // was built against the SQLite linked here (Qt configured with -system-sqlite). A driver
+        // with its own copy leaves blob streaming, column reads, backups and snapshots unavailable.
+        // Matching source ids are only a heuristic: a bundled copy of the same release passes
+        // the check while keeping separate global state, so Qt must still be built accordingly.
+        QSqlQuery sourceQuery(m_database);
+        m_sharedSQLite = sourceQuery.exec("SELECT sqlite_source_id()") && sourceQuery.next() &&
+            sourceQuery.value(0).toString() == QString::fromLatin1(sqlite3_sourceid());
+        sourceQuery.finish();
+        if (!m_sharedSQLite)
+            qDebug() << "Warning: open, the QSQLITE driver does not use the SQLite library linked by cgData.";
+
+        // a save interrupted while swapping files leaves the previous snapshot as .bak
+        if (m_inMemory && !m_snapshotPath.isEmpty())
+        {
+            QString backupPath = m_snapshotPath + ".bak";
+            if (!(QFile::exists(m_snapshotPath) && loadSnapshot(m_snapshotPath)) && QFile::exists(backupPath))
+                loadSnapshot(backupPath);
+        }
+
+        // an empty database gets the schema, whether it is a new file or lives in memory
+        if (m_database.tables().isEmpty())
+            createSchema();
+        // also added to files created before a property was declared unique
+        createUniqueIndexes();
+
+        // classes with archived rows or id blocks keep allocating above their sequence
+        QSqlQuery sequenceQuery(m_database);
+        if (m_database.tables().contains("cgdata_sequence") && sequenceQuery.exec("SELECT class FROM cgdata_sequence"))
+        {
+            while (sequenceQuery.next())
+            {
+                Table *pTable = m_tableMap.value(sequenceQuery.value(0).toString());
+                if (pTable)
+                    pTable->setSequenced(true);
+            }
+        }
+
+        if (m_changeDetection)
+            startChangeDetection();
+    }
+
+    emit databaseOpened();
+
+    return true;
+}
+
+bool DataManager::openInMemory(const QString &snapshotPath, int snapshotInterval)
+{
+    if (m_database.isOpen())
+        return false;
+
+    m_snapshotPath = snapshotPath;
+    open(":memory:");
+    if (!m_database.isOpen())
+    {
+        m_snapshotPath.clear();
+        return false;
+    }
+
+    if (!m_snapshotPath.isEmpty() && snapshotInterval > 0)
+    {
+        if (!m_pSnapshotTimer)
+        {
+            m_pSnapshotTimer = new QTimer(this);
+            connect(m_pSnapshotTimer, &QTimer::timeout, this, [this]() {
+                // the memory database cannot be copied while this connection writes to it
+                if (m_transactionDepth == 0)
+                    saveSnapshot();
+            });
+        }
+
+        m_pSnapshotTimer->start(snapshotInterval);
+    }
+
+    return true;
+}
+
+bool DataManager::isInMemory() const
+{
+    return m_database.isOpen() && m_inMemory;
+}
+
+bool DataManager::saveSnapshot()
+{
+    if (!isInMemory() || m_snapshotPath.isEmpty() || m_transactionDepth > 0)
+    {
+        qDebug() << "Error: saveSnapshot, needs a memory database with a snapshot path and no open transaction.";
+        return false;
+    }
+
+    // written beside the old snapshot and swapped in, so a crash never leaves a partial one
+    QString tempPath = m_snapshotPath + ".tmp";
+    QFile::remove(tempPath);
+
+    TraceSpan span(activeTrace(), "snapshot", m_snapshotPath);
+
+    DatabaseBackup backup(sqliteHandle(), tempPath);
+    backup.step(-1);
+    if (!backup.isComplete())
+    {
+        qDebug() << "Error: saveSnapshot, " << backup.errorString();
+        return false;
+    }
+
+    // the old snapshot is kept as .bak until the new one is in place
+    QString backupPath = m_snapshotPath + ".bak";
+    if (QFile::exists(m_snapshotPath))
+    {
+        QFile::remove(backupPath);
+        if (!QFile::rename(m_snapshotPath, backupPath))
+        {
+            qDebug() << "Error: saveSnapshot, unable to replace " << m_snapshotPath;
+            return false;
+        }
+    }
+
+    if (!QFile::rename(tempPath, m_snapshotPath))
+    {
+        qDebug() << "Error: saveSnapshot, unable to replace " << m_snapshotPath;
+        QFile::rename(backupPath, m_snapshotPath);
+        return false;
+    }
+
+    QFile::remove(backupPath);
+    return true;
+}
+
+bool DataManager::loadSnapshot(const QString &path)
+{
+    if (!sqliteHandle())
+    {
+        qDebug() << "Error: loadSnapshot, the SQLite C API is not available.";
+        return false;
+    }
+
+    sqlite3 *pFile = nullptr;
+    if (sqlite3_open_v2(path.toUtf8().constData(), &pFile, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+    {
+        qDebug() << "Error: loadSnapshot, " << sqlite3_errmsg(pFile);
+        sqlite3_close(pFile);
+        return false;
+    }
+
+    QString errorString;
+    bool loaded = DatabaseBackup::copy(pFile, sqliteHandle(), errorString);
+    sqlite3_close(pFile);
+
+    if (!loaded)
+        qDebug() << "Error: loadSnapshot, " << errorString;
+
+    return loaded;
+}
+
+void DataManager::createSchema()
+{
+    for (auto & className : m_tableMap.keys())
+    {
+        Table *pTable = m_tableMap.value(className);
+        const QMetaObject *pMetaObject = pTable->metaObject();
+
+        if (pMetaObject)
+        {
+            QStringList textColumnsList;
+
+            for (auto & column : pTable->columns())
+            {
+                if (column.type() == QMetaType::QString)
+                    textColumnsList.append(column.name());
+            }
+
+            QSqlQuery query(m_database);
+            query.prepare(QString("CREATE TABLE %1 (%2)").arg(pTable->name()).arg(pTable->columnDefinitions()));
+            if (query.exec())
+            {
+                //qDebug() << "Table created: " << query.executedQuery();
+            }
+            else
+            {
+                qDebug() << "Error: Unable to create table for " << pTable->name();
+            }
+
+            createVirtualTable(pTable->name(), textColumnsList);
+        }
+        else if (pTable->relationship1() && pTable->relationship2())
+        {
+            Relationship *pRelationship1 = pTable->relationship1();
+            Relationship *pRelationship2 = pTable->relationship2();
+
+            QSqlQuery query(m_database);
+            query.prepare(QString("CREATE TABLE %1 (%2 INTEGER, %3 INTEGER)")
+                .arg(pTable->name())
+                .arg(pRelationship1->name())
+                .arg(pRelationship2->name()));
+            if (query.exec())
+            {
+                //qDebug() << "Table created for " << pTable->name();
+            }
+            else
+            {
+                qDebug() << "Error: Unable to create table for " << pTable->name();
+            }
+        }
+    }
+}
+
+void DataManager::createUniqueIndexes()
+{
+    for (auto & pTable : m_tableMap.values())
+    {
+        for (auto & name : pTable->uniqueNames())
+        {
+            QSqlQuery query(m_database);
+            if (!query.exec(QString("CREATE UNIQUE INDEX IF NOT EXISTS %1_%2_unique ON %1 (%2)").arg(pTable->name()).arg(name)))
+                qDebug() << "Error: createUniqueIndexes, " << query.lastError();
+        }
+    }
+}
+
+void DataManager::createVirtualTable(const QString &tableName, const QStringList &textColumnList)
+{
+    if (textColumnList.size() == 0)
+        return;
+
+    QString columnNames = textColumnList.join(", ");
+    QString queryString = QString("%1, content=%2, content_rowid=id").arg(columnNames).arg(tableName);
+
+    QSqlQuery query(m_database);
+    query.prepare(QString("CREATE VIRTUAL TABLE %1_fts USING fts5(%2)").arg(tableName).arg(queryString));
+    if (query.exec())
+    {
+        //qDebug() << "Virtual table created for " << tableName;
+    }
+    else
+    {
+        qDebug() << "Error: Unable to create virtual table for " << tableName;
+    }
+
+    QString insertText = "rowid, " + columnNames;
+
+    QStringList newList;
+    newList << "new.id";
+    for (auto & name : textColumnList)
+        newList << "new." + name;
+    QString newText = newList.join(", ");
+
+    QSqlQuery trigger1Query(m_database);
+    trigger1Query.prepare(QString("CREATE TRIGGER %1_ai AFTER INSERT ON %1 BEGIN "
+        "INSERT INTO %1_fts(%2) VALUES(%3); END;").arg(tableName).arg(insertText).arg(newText));
+    if (trigger1Query.exec())
+    {
+        //qDebug() << "Success: " << trigger1Query.executedQuery();
+    }
+    else
+    {
+        qDebug() << "Error: " << trigger1Query.lastQuery();
+    }
+
+    QStringList oldList;
+    oldList << "'delete'";
+    oldList << "old.id";
+    for (auto & name : textColumnList)
+        oldList << "old." + name;
+    QString oldText = oldList.join(", ");
+
+    QSqlQuery trigger2Query(m_database);
+    trigger2Query.prepare(QString("CREATE TRIGGER %1_ad AFTER DELETE ON %1 BEGIN "
+        "INSERT INTO %1_fts(%1_fts, %2) VALUES(%3); END;")
+        .arg(tableName).arg(insertText).arg(oldText));
+    if (trigger2Query.exec())
+    {
+        //qDebug() << "Success: " << trigger2Query.executedQuery();
+    }
+    else
+    {
+        qDebug() << "Error: " << trigger2Query.lastQuery();
+    }
+
+    QSqlQuery trigger3Query(m_database);
+    trigger3Query.prepare(QString("CREATE TRIGGER %1_au AFTER UPDATE ON %1 BEGIN "
+        "INSERT INTO %1_fts(%1_fts, %2) VALUES(%3);"
+        "INSERT INTO %1_fts(%2) VALUES(%4); END;")
+        .arg(tableName).arg(insertText).arg(oldText).arg(newText));
+    if (trigger3Query.exec())
+    {
+        //qDebug() << "Success: " << trigger3Query.executedQuery();
+    }
+    else
+    {
+        qDebug() << "Error: " << trigger3Query.lastQuery();
+    }
+}
+
+DataObjects DataManager::textSearch(const QMetaObject * pMetaObject, const QString & text) const
+{
+    if (!pMetaObject)
+        return DataObjects();
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::TextSearchOperation);
+
+    DataObjects objects;
+
+    QElapsedTimer queryTimer;
+    startQueryTimer(queryTimer);
+
+    QString sql = QString("SELECT rowid FROM %1_fts WHERE %1_fts MATCH '%2' ORDER BY rank").arg(pMetaObject->className()).arg(text);
+    TraceSpan span(activeTrace(), "step", sql);
+
+    QSqlQuery searchQuery(m_database);
+    searchQuery.prepare(sql);
+
+    if (searchQuery.exec())
+    {
+        while (searchQuery.next())
+        {
+            qint64 id = searchQuery.value(0).toLongLong();
+            DataObjectPtr pObject = findObject(pMetaObject, id);
+            if (pObject)
+                objects.append(pObject);
+        }
+    }
+
+    searchQuery.finish();
+    span.end();
+    logSlowQuery(DataStatistics::TextSearchOperation, sql, QVariantList(), queryTimer);
+
+    return objects;
+}
+
+DataObjectPtr DataManager::newObject(const QMetaObject *pMetaObject)
+{
+    if (!pMetaObject)
+        return nullptr;
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::CreateOperation);
+
+    DataObjectPtr pDataObject = constructObject(pMetaObject);
+    if (!pDataObject)
+        return nullptr;
+
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+
+    QVariantList values;
+    for (auto & column : pTable->dataColumns())
+        values.append(column.read(pDataObject.data()));
+
+    qint64 id = 0;
+    if (m_pWriteBehind)
+    {
+        id = allocateId(pTable);
+        if (id > 0)
+            m_pWriteBehind->enqueueInsert(pTable->name(), id, pTable->insertWithIdString(), values);
+    }
+    else
+    {
+        qint64 newId = allocatesIds(pTable) ? allocateId(pTable) : 0;
+        QString sql = newId > 0 ? pTable->insertWithIdString() : pTable->insertString();
+        QSqlQuery query = preparedQuery(sql);
+
+        if (newId > 0)
+            query.addBindValue(newId);
+        for (auto & value : values)
+            query.addBindValue(value);
+
+        TraceSpan span(activeTrace(), "step", sql);
+        if (query.exec())
+        {
+            //qDebug() << "Success: " << query.executedQuery();
+            id = newId > 0 ? newId : query.lastInsertId().toLongLong();
+        }
+        else
+        {
+            qDebug() << "Error: newObject, " << query.lastError();
+            qDebug() << "Query = " << query.executedQuery();
+        }
+
+        query.finish();
+    }
+
+    if (id > 0)
+    {
+        pDataObject->setProperty("id", id);
+        mapObject(pMetaObject, pDataObject);
+        cacheObject(pTable, pDataObject);
+        updateCachedLists(pTable, pDataObject);
+
+        m_pendingChanges.addCreated(pTable->name(), id);
+        scheduleChanges();
+
+        emit objectCreated(pDataObject);
+    }
+
+    return pDataObject;
+}
+
+DataObjectPtr DataManager::newPendingObject(const QMetaObject *pMetaObject)
+{
+    if (!pMetaObject)
+        return nullptr;
+
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable || pTable->idBlockSize() <= 0)
+    {
+        qDebug() << "Error: newPendingObject, " << pMetaObject->className() << " has no id block size.";
+        return nullptr;
+    }
+
+    DataObjectPtr pObject = constructObject(pTable);
+    if (!pObject)
+        return nullptr;
+
+    qint64 id = reserveId(pTable);
+    if (id <= 0)
+        return nullptr;
+
+    // mapped right away, so one() and object() find it before it is written
+    pObject->m_id = id;
+    mapObject(pMetaObject, pObject);
+
+    m_pendingObjects.append(pObject);
+    m_pendingSet.insert(pObject.data());
+
+    return pObject;
+}
+
+bool DataManager::persistPending()
+{
+    if (m_pendingObjects.isEmpty() && m_pendingLinks.isEmpty())
+        return true;
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::CreateOperation);
+
+    if (!beginTransaction())
+        return false;
+
+    for (auto & pObject : m_pendingObjects)
+    {
+        Table *pTable = m_tableMap.value(pObject->metaObject()->className());
+
+        QVariantList values;
+        for (auto & column : pTable->dataColumns())
+            values.append(column.read(pObject.data()));
+
+        if (m_pWriteBehind)
+        {
+            m_pWriteBehind->enqueueInsert(pTable->name(), pObject->id(), pTable->insertWithIdString(), values);
+            continue;
+        }
+
+        QString sql = pTable->insertWithIdString();
+        QSqlQuery query = preparedQuery(sql);
+        query.addBindValue(pObject->id());
+        for (auto & value : values)
+            query.addBindValue(value);
+
+        TraceSpan span(activeTrace(), "step", sql);
+        bool success = query.exec();
+        if (!success)
+            qDebug() << "Error: persistPending, " << query.lastError();
+        query.finish();
+
+        if (!success)
+        {
+            rollbackTransaction();
+            return false;
+        }
+    }
+
+    for (auto & link : m_pendingLinks)
+    {
+        QVariantList values;
+        values << link.pTargetObject->id() << link.pObject->id();
+
+        if (m_pWriteBehind)
+        {
+            m_pWriteBehind->enqueueStatement(link.sql, values);
+            continue;
+        }
+
+        QSqlQuery query = preparedQuery(link.sql);
+        for (auto & value : values)
+            query.addBindValue(value);
+
+        TraceSpan span(activeTrace(), "step", link.sql);
+        bool success = query.exec();
+        if (!success)
+            qDebug() << "Error: persistPending, " << query.lastError();
+        query.finish();
+
+        if (!success)
+        {
+            rollbackTransaction();
+            return false;
+        }
+    }
+
+    // the objects become ordinary ones once their rows are committed
+    DataObjects objects = m_pendingObjects;
+    QList<PendingLink> links = m_pendingLinks;
+    m_pendingObjects.clear();
+    m_pendingSet.clear();
+    m_pendingLinks.clear();
+
+    for (auto & pObject : objects)
+    {
+        Table *pTable = m_tableMap.value(pObject->metaObject()->className());
+        cacheObject(pTable, pObject);
+        updateCachedLists(pTable, pObject);
+        m_pendingChanges.addCreated(pTable->name(), pObject->id());
+    }
+
+    for (auto & link : links)
+    {
+        appendCachedId(link.pRelationship->cache(), link.pObject->id(), link.pTargetObject->id());
+        appendCachedId(link.pRelationship->inverseRelationship()->cache(), link.pTargetObject->id(), link.pObject->id());
+    }
+    scheduleChanges();
+
+    // announced by the commit, or by the commit of the caller's transaction around this one
+    m_persistedObjects.append(objects);
+
+    bool committed = commitTransaction();
+    if (!committed)
+    {
+        // the rollback has dropped the objects from the identity map, so they are still new
+        m_pendingObjects = objects;
+        for (auto & pObject : objects)
+        {
+            mapObject(pObject->metaObject(), pObject);
+            m_pendingSet.insert(pObject.data());
+        }
+        m_pendingLinks = links;
+        return false;
+    }
+
+    return true;
+}
+
+void DataManager::discardPending()
+{
+    for (auto & pObject : m_pendingObjects)
+        m_classObjectMap[pObject->metaObject()->className()].remove(pObject->id());
+
+    m_pendingObjects.clear();
+    m_pendingSet.clear();
+    m_pendingLinks.clear();
+}
+
+int DataManager::pendingCount() const
+{
+    return m_pendingObjects.size();
+}
+
+void DataManager::removePendingObject(DataObjectPtr pObject)
+{
+    m_pendingObjects.removeOne(pObject);
+    m_pendingSet.remove(pObject.data());
+    m_classObjectMap[pObject->metaObject()->className()].remove(pObject->id());
+
+    for (int i = m_pendingLinks.size() - 1; i >= 0; i--)
+    {
+        if (m_pendingLinks.at(i).pObject == pObject || m_pendingLinks.at(i).pTargetObject == pObject)
+            m_pendingLinks.removeAt(i);
+    }
+}
+
+DataObjectPtr DataManager::upsertObject(DataObjectPtr pObject, const QString &keyName)
+{
+    Table *pTable = upsertTable(pObject, keyName);
+    if (!pTable)
+        return nullptr;
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::UpsertOperation);
+
+    // the lookup and the write share a savepoint, inside or outside a transaction, so the
+    // row found is the row written
+    QSqlQuery savepointQuery(m_database);
+    if (!savepointQuery.exec("SAVEPOINT cgdata_upsert"))
+    {
+        qDebug() << "Error: upsertObject, " << savepointQuery.lastError();
+        return nullptr;
+    }
+
+    // a block reserved in the savepoint goes back to the sequence table with it
+    qint64 blockEnd = pTable->blockEnd();
+    auto rollback = [&savepointQuery, pTable, blockEnd]() {
+        savepointQuery.exec("ROLLBACK TO SAVEPOINT cgdata_upsert");
+        savepointQuery.exec("RELEASE SAVEPOINT cgdata_upsert");
+        if (pTable->blockEnd() != blockEnd)
+            pTable->setIdBlock(0, 0);
+    };
+
+    UpsertedRow row = { pTable, pObject, 0, false, QList<const Column*>() };
+
+    QSqlQuery query = preparedQuery(QString("SELECT id FROM %1 WHERE %2 = ?").arg(pTable->name()).arg(keyName));
+    query.addBindValue(upsertKey(pTable, pObject, keyName));
+    if (!query.exec())
+    {
+        qDebug() << "Error: upsertObject, " << query.lastError();
+        query.finish();
+        rollback();
+        return nullptr;
+    }
+    if (query.next())
+        row.id = query.value(0).toLongLong();
+    query.finish();
+
+    if (!writeUpsert(keyName, row))
+    {
+        rollback();
+        return nullptr;
+    }
+
+    if (!savepointQuery.exec("RELEASE SAVEPOINT cgdata_upsert"))
+    {
+        qDebug() << "Error: upsertObject, " << savepointQuery.lastError();
+        rollback();
+        return nullptr;
+    }
+
+    return mapUpsert(row);
+}
+
+DataObjects DataManager::upsertObjects(const DataObjects &objects, const QString &keyName)
+{
+    QList<UpsertedRow> rows;
+    QMap<Table*, QVariantList> keys;
+    for (auto & pObject : objects)
+    {
+        Table *pTable = upsertTable(pObject, keyName);
+        if (!pTable)
+            return DataObjects();
+
+        UpsertedRow row = { pTable, pObject, 0, false, QList<const Column*>() };
+        rows.append(row);
+        keys[pTable].append(upsertKey(pTable, pObject, keyName));
+    }
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::UpsertOperation);
+
+    // the transaction makes the rows found the rows written, without a savepoint per object
+    if (!beginTransaction())
+        return DataObjects();
+
+    QMap<Table*, QHash<QString, qint64>> ids;
+    for (auto it = keys.constBegin(); it != keys.constEnd(); ++it)
+    {
+        if (!findUpsertIds(it.key(), keyName, it.value(), ids[it.key()]))
+        {
+            rollbackTransaction();
+            return DataObjects();
+        }
+    }
+
+    for (auto & row : rows)
+    {
+        QHash<QString, qint64> &tableIds = ids[row.pTable];
+        QString key = upsertKeyString(upsertKey(row.pTable, row.pObject, keyName));
+
+        row.id = tableIds.value(key);
+        if (!writeUpsert(keyName, row))
+        {
+            rollbackTransaction();
+            return DataObjects();
+        }
+
+        // a later object with the same key updates this row
+        tableIds.insert(key, row.id);
+    }
+
+    if (!commitTransaction())
+        return DataObjects();
+
+    // nothing is mapped or announced before every row is written
+    DataObjects upserted;
+    for (auto & row : rows)
+        upserted.append(mapUpsert(row));
+
+    return upserted;
+}
+
+Table * DataManager::upsertTable(DataObjectPtr pObject, const QString &keyName) const
+{
+    if (!pObject)
+        return nullptr;
+
+    QString className = pObject->metaObject()->className();
+    Table *pTable = m_tableMap.value(className);
+
+    if (!pTable || !m_classObjectMap.contains(className))
+        return nullptr;
+
+    bool byId = keyName == "id";
+    if (m_pWriteBehind || (byId && pObject->id() <= 0) || (!byId && !pTable->uniqueNames().contains(keyName)))
+    {
+        qDebug() << "Error: upsertObject, needs an id or a unique key, and no write-behind.";
+        return nullptr;
+    }
+
+    return pTable;
+}
+
+QVariant DataManager::upsertKey(Table *pTable, DataObjectPtr pObject, const QString &keyName) const
+{
+    return keyName == "id" ? QVariant(pObject->id()) : pTable->column(keyName)->read(pObject.data());
+}
+
+bool DataManager::findUpsertIds(Table *pTable, const QString &keyName, const QVariantList &keys, QHash<QString, qint64> &ids)
+{
+    // SQLite limits the number of bound values in a statement
+    const int chunkSize = 500;
+
+    for (int start = 0; start < keys.size(); start += chunkSize)
+    {
+        QVariantList chunk = keys.mid(start, chunkSize);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); i++)
+            placeholders.append("?");
+
+        QString sql = QString("SELECT id, %1 FROM %2 WHERE %1 IN (%3)").arg(keyName).arg(pTable->name()).arg(placeholders.join(", "));
+        TraceSpan span(activeTrace(), "step", sql);
+
+        QSqlQuery query(m_database);
+        query.setForwardOnly(true);
+        query.prepare(sql);
+        for (auto & key : chunk)
+            query.addBindValue(key);
+
+        if (!query.exec())
+        {
+            qDebug() << "Error: upsertObjects, " << query.lastError();
+            return false;
+        }
+
+        while (query.next())
+            ids.insert(upsertKeyString(query.value(1)), query.value(0).toLongLong());
+    }
+
+    return true;
+}
+
+bool DataManager::writeUpsert(const QString &keyName, UpsertedRow &row)
+{
+    Table *pTable = row.pTable;
+    DataObjectPtr pObject = row.pObject;
+    QString className = pObject->metaObject()->className();
+
+    bool byId = keyName == "id";
+    qint64 id = row.id;
+    row.created = id == 0;
+    if (byId)
+        id = pObject->id();
+
+    // an object that already has a row may not take over another one
+    auto & objectMap = m_classObjectMap[className];
+    if (!byId && pObject->id() > 0 && objectMap.value(pObject->id()).lock() == pObject && id != pObject->id())
+    {
+        qDebug() << "Error: upsertObject, object " << pObject->id() << " matches another row by " << keyName;
+        return false;
+    }
+
+    // new rows get their ids like created objects do
+    if (!byId && row.created && allocatesIds(pTable))
+        id = allocateId(pTable);
+
+    // deferred columns that were never loaded keep their stored values
+    QStringList names, placeholders, assignments;
+    QVariantList values;
+    row.columns.clear();
+
+    if (byId || (row.created && id > 0))
     {
-        //qDebug() << "Success: " << trigger3Query.executedQuery();
+        names.append("id");
+        placeholders.append("?");
+        values.append(id);
     }
-    else
+
+    for (auto & column : pTable->dataColumns())
     {
-        qDebug() << "Error: " << trigger3Query.lastQuery();
+        if (column.isDeferred() && pObject->m_unloadedProperties.contains(column.name().toUtf8()))
+            continue;
+
+        row.columns.append(&column);
+        names.append(column.name());
+        placeholders.append("?");
+        values.append(column.read(pObject.data()));
+        if (column.name() != keyName)
+            assignments.append(QString("%1 = excluded.%1").arg(column.name()));
     }
-}
-
-DataObjects DataManager::textSearch(const QMetaObject * pMetaObject, const QString & text) const
-{
-    if (!pMetaObject)
-        return DataObjects();
 
-    DataObjects objects;
+    QString sql = QString("INSERT INTO %1 (%2) VALUES (%3) ON CONFLICT(%4) DO ")
+        .arg(pTable->name()).arg(names.join(", ")).arg(placeholders.join(", ")).arg(keyName);
+    sql += assignments.isEmpty() ? QString("NOTHING") : QString("UPDATE SET %1").arg(assignments.join(", "));
 
-    QSqlQuery searchQuery;
-    searchQuery.prepare(QString("SELECT rowid FROM %1_fts WHERE %1_fts MATCH '%2' ORDER BY rank")
-        .arg(pMetaObject->className()).arg(text));
+    QSqlQuery query = preparedQuery(sql);
+    for (auto & value : values)
+        query.addBindValue(value);
 
-    if (searchQuery.exec())
+    TraceSpan span(activeTrace(), "step", sql);
+    if (!query.exec())
     {
-        while (searchQuery.next())
-        {
-            qint64 id = searchQuery.value(0).toLongLong();
-            DataObjectPtr pObject = findObject(pMetaObject, id);
-            if (pObject)
-                objects.append(pObject);
-        }
+        qDebug() << "Error: upsertObject, " << query.lastError();
+        query.finish();
+        return false;
     }
 
-    return objects;
+    if (id == 0)
+        id = query.lastInsertId().toLongLong();
+    query.finish();
+
+    row.id = id;
+    return true;
 }
 
-DataObjectPtr DataManager::newObject(const QMetaObject *pMetaObject)
+DataObjectPtr DataManager::mapUpsert(const UpsertedRow &row)
 {
-    if (!pMetaObject)
-        return nullptr;
-
-    DataObjectPtr pDataObject = constructObject(pMetaObject);
-    if (!pDataObject)
-        return nullptr;
-
-    QString columnsStr, valuesStr;
-    QVariantMap map = insertData(pDataObject, columnsStr, valuesStr);
-
-    Table *pTable = m_tableMap.value(pMetaObject->className());
+    Table *pTable = row.pTable;
+    DataObjectPtr pObject = row.pObject;
+    QString className = pObject->metaObject()->className();
+    qint64 id = row.id;
 
-    QSqlQuery query;
-    query.prepare(QString("INSERT INTO %1 (%2) VALUES (%3)").arg(pTable->name()).arg(columnsStr).arg(valuesStr));
+    // ids handed out from memory must stay above ids chosen by the caller
+    if (pTable->lastId() >= 0 && id > pTable->lastId())
+        pTable->setLastId(id);
 
-    for (auto &key : map.keys())
-        query.bindValue(":" + key, map.value(key));
+    auto & objectMap = m_classObjectMap[className];
+    DataObjectPtr pMappedObject = objectMap.value(id).lock();
 
-    if (query.exec())
+    if (pMappedObject && pMappedObject != pObject)
     {
-        //qDebug() << "Success: " << query.executedQuery();
+        // one object per row: the one already in memory takes the new values
+        for (auto & pColumn : row.columns)
+            pColumn->property().write(pMappedObject.data(), pColumn->property().read(pObject.data()));
+        pObject = pMappedObject;
+    }
+    else
+    {
+        pObject->m_pDataManager = this;
+        pObject->m_id = id;
+        objectMap.insert(id, pObject);
+    }
 
-        qint64 id = query.lastInsertId().toLongLong();
-        pDataObject->setProperty("id", id);
-        mapObject(pMetaObject, pDataObject);
+    cacheObject(pTable, pObject);
+    updateCachedLists(pTable, pObject);
 
-        emit objectCreated(pDataObject);
-        emit databaseChanged();
+    if (row.created)
+    {
+        m_pendingChanges.addCreated(className, id);
+        scheduleChanges();
+        emit objectCreated(pObject);
     }
     else
     {
-        qDebug() << "Error: newObject, " << query.lastError();
-        qDebug() << "Query = " << query.executedQuery();
+        m_pendingChanges.addUpdated(className, id);
+        scheduleChanges();
+        emit objectUpdated(pObject);
     }
 
-    return pDataObject;
+    return pObject;
 }
 
 void DataManager::readObject(DataObjectPtr pDataObject)
@@ -473,33 +3875,26 @@ void DataManager::readObject(DataObjectPtr pDataObject)
     if (!pDataObject)
         return;
 
-    QString selectStr;
-    QMap<QString, QVariant::Type> typeMap;
-    QStringList list = selectData(pDataObject->metaObject(), selectStr, typeMap);
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::ReadOperation);
 
     Table *pTable = m_tableMap.value(pDataObject->metaObject()->className());
 
-    QSqlQuery query;
-    query.prepare(QString("SELECT %1 FROM %2 WHERE id = :id").arg(selectStr).arg(pTable->name()));
+    QString sql = QString("SELECT %1 FROM %2 WHERE id = :id").arg(pTable->selectString()).arg(sourceName(pTable, true));
+    QSqlQuery query = preparedQuery(sql);
     query.bindValue(":id", pDataObject->id());
+
+    TraceSpan span(activeTrace(), "step", sql);
     if (query.exec())
     {
         if (query.next())
-        {
-            for (int i = 0; i < list.size(); i++)
-            {
-                QString name = list[i];
-                QVariant::Type type = typeMap.value(name);
-                QVariant value = fromSQLiteVariant(type, query.value(i));
-                if (value.isValid())
-                    pDataObject->setProperty(name.toUtf8(), value);
-            }
-        }
+            readColumns(pTable, query, pDataObject);
     }
     else
     {
         qDebug() << "Error: readObject, " << query.lastError();
     }
+
+    query.finish();
 }
 
 DataObjectPtr DataManager::constructObject(const QMetaObject *pMetaObject) const
@@ -507,32 +3902,81 @@ DataObjectPtr DataManager::constructObject(const QMetaObject *pMetaObject) const
     if (!pMetaObject)
         return nullptr;
 
-    QObject *pObject = pMetaObject->newInstance();
-    if (!pObject)
-        return nullptr; // ERROR
+    return constructObject(m_tableMap.value(pMetaObject->className()));
+}
 
-    DataObject* pDataObject = nullptr;
-    pDataObject = qobject_cast<DataObject*>(pObject);
+namespace
+{
+    // returns a pooled object's memory to its pool; the pool lives as long as any of its objects
+    class PoolDeleter
+    {
+    public:
+        PoolDeleter(QSharedPointer<ObjectPool> pPool, void *pMemory)
+            : m_pPool(pPool), m_pMemory(pMemory) {}
 
-    if (!pDataObject)
+        void operator()(DataObject *pObject) const
+        {
+            pObject->~DataObject();
+            m_pPool->release(m_pMemory);
+        }
+
+    private:
+        QSharedPointer<ObjectPool> m_pPool;
+        void *m_pMemory;
+    };
+}
+
+DataObjectPtr DataManager::constructObject(Table *pTable) const
+{
+    if (!pTable || !pTable->metaObject())
         return nullptr; // ERROR
 
+    DataObjectPtr pDataObject;
+    const ClassFactory *pFactory = pTable->factory();
+    QSharedPointer<ObjectPool> pPool = pTable->pool();
+
+    if (pFactory && pPool)
+    {
+        void *pMemory = pPool->allocate();
+        pDataObject = DataObjectPtr(pFactory->construct(pMemory), PoolDeleter(pPool, pMemory));
+    }
+    else if (pFactory)
+    {
+        pDataObject = pFactory->create();
+    }
+    else
+    {
+        QObject *pObject = pTable->metaObject()->newInstance();
+        if (!pObject)
+            return nullptr; // ERROR
+
+        DataObject *pNewObject = qobject_cast<DataObject*>(pObject);
+        if (!pNewObject)
+        {
+            delete pObject;
+            return nullptr; // ERROR
+        }
+
+        pDataObject = DataObjectPtr(pNewObject);
+    }
+
     // TODO: is there a way around const_cast here?
     pDataObject->m_pDataManager = const_cast<DataManager*>(this);
 
     // initialize any foreign keys
-    Table *pTable = m_tableMap.value(pMetaObject->className());
-
-    for (auto & pRelationship : pTable->relationships())
+    for (int index : pTable->foreignKeyIndexes())
     {
-        if (pRelationship->type() == Relationship::OneToOneType ||
-            pRelationship->type() == Relationship::ManyToOneType)
-        {
-            pDataObject->setProperty(pRelationship->name().toLocal8Bit(), QVariant(0));
-        }
+        if (index < 0)
+            continue;
+
+        qint64 value = 0;
+        int status = -1;
+        int flags = 0;
+        void *argv[] = { &value, nullptr, &status, &flags };
+        QMetaObject::metacall(pDataObject.data(), QMetaObject::WriteProperty, index, argv);
     }
 
-    return QSharedPointer<DataObject>(pDataObject);
+    return pDataObject;
 }
 
 void DataManager::mapObject(const QMetaObject *pMetaObject, DataObjectPtr pObject) const
@@ -555,198 +3999,557 @@ DataObjectPtr DataManager::findObject(const QMetaObject *pMetaObject, qint64 id)
 
     auto & objectMap = m_classObjectMap[className];
 
+    Table *pTable = m_tableMap.value(className);
+    ObjectCache *pCache = pTable->cache();
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::FindOperation);
+
     if (objectMap.contains(id) && !objectMap.value(id).isNull())
     {
         pObject = objectMap.value(id).lock();
+        if (pCache && !pCache->hit(pTable, id))
+            cacheObject(pTable, pObject);
+        if (m_pStatistics)
+            m_pStatistics->addIdentityMapHit();
     }
     else
     {
-        QString selectStr;
-        QMap<QString, QVariant::Type> typeMap;
-        QStringList list = selectData(pMetaObject, selectStr, typeMap);
+        if (pCache)
+            pCache->miss();
+        if (m_pStatistics)
+            m_pStatistics->addIdentityMapMiss();
 
-        Table *pTable = m_tableMap.value(pMetaObject->className());
+        QElapsedTimer queryTimer;
+        startQueryTimer(queryTimer);
 
-        QSqlQuery query;
-        query.prepare(QString("SELECT %1 FROM %2 WHERE id = :id").arg(selectStr).arg(pTable->name()));
+        // objects are found by id wherever they are, so relationships reach archived rows
+        QString sql = QString("SELECT %1 FROM %2 WHERE id = :id").arg(pTable->selectString()).arg(sourceName(pTable, true));
+        QSqlQuery query = preparedQuery(sql);
         query.bindValue(":id", id);
+
+        TraceSpan span(activeTrace(), "step", sql);
         if (query.exec())
         {
             if (query.next())
+                pObject = hydrateObject(pMetaObject, pTable, query);
+        }
+        else
+        {
+            qDebug() << "Error: findObject, id = " << id << ", not found" << query.lastError();
+        }
+
+        query.finish();
+        span.end();
+        logSlowQuery(DataStatistics::FindOperation, sql, QVariantList() << id, queryTimer);
+    }
+
+    return pObject;
+}
+
+DataObjectPtr DataManager::hydrateObject(const QMetaObject *pMetaObject, Table *pTable, const QSqlQuery &query) const
+{
+    return hydrateObject(pTable, m_classObjectMap[pMetaObject->className()], query);
+}
+
+DataObjectPtr DataManager::hydrateObject(Table *pTable, ObjectMap &objectMap, const QSqlQuery &query) const
+{
+    qint64 id = query.value(0).toLongLong();
+
+    DataObjectPtr pObject = mappedObject(pTable, objectMap, id);
+    if (pObject)
+        return pObject;
+
+    TraceSpan span(activeTrace(), "hydrate");
+
+    pObject = constructObject(pTable);
+    if (!pObject)
+        return nullptr; // ERROR
+
+    if (m_pStatistics)
+        m_pStatistics->addRowsHydrated();
+
+    pObject->m_id = id;
+    readColumns(pTable, query, pObject);
+    objectMap.insert(id, pObject);
+    cacheObject(pTable, pObject);
+
+    return pObject;
+}
+
+DataObjectPtr DataManager::hydrateObject(Table *pTable, ObjectMap &objectMap, const QVariantList &row) const
+{
+    qint64 id = row.value(0).toLongLong();
+
+    DataObjectPtr pObject = mappedObject(pTable, objectMap, id);
+    if (pObject)
+        return pObject;
+
+    TraceSpan span(activeTrace(), "hydrate");
+
+    pObject = constructObject(pTable);
+    if (!pObject)
+        return nullptr; // ERROR
+
+    if (m_pStatistics)
+        m_pStatistics->addRowsHydrated();
+
+    pObject->m_id = id;
+    readColumns(pTable, row, pObject);
+    objectMap.insert(id, pObject);
+    cacheObject(pTable, pObject);
+
+    return pObject;
+}
+
+DataObjectPtr DataManager::mappedObject(Table *pTable, ObjectMap &objectMap, qint64 id) const
+{
+    auto it = objectMap.find(id);
+    if (it == objectMap.end())
+        return nullptr;
+
+    DataObjectPtr pObject = it.value().lock();
+    if (pObject && pTable->cache() && !pTable->cache()->hit(pTable, id))
+        cacheObject(pTable, pObject);
+
+    return pObject;
+}
+
+void DataManager::readColumns(Table *pTable, const QSqlQuery &query, DataObjectPtr pObject) const
+{
+    auto & columns = pTable->selectColumns();
+    for (int i = 0; i < columns.size(); i++)
+        columns.at(i).write(pObject.data(), query.value(i + 1));
+
+    pObject->m_unloadedProperties = pTable->deferredNames();
+}
+
+void DataManager::readColumns(Table *pTable, const QVariantList &row, DataObjectPtr pObject) const
+{
+    auto & columns = pTable->selectColumns();
+    for (int i = 0; i < columns.size(); i++)
+        columns.at(i).write(pObject.data(), row.value(i + 1));
+
+    pObject->m_unloadedProperties = pTable->deferredNames();
+}
+
+QString DataManager::findSql(const QMetaObject *pMetaObject, const QVariantMap &map, QVariantList &values) const
+{
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable)
+        return QString();
+
+    QString sql = QString("SELECT %1 FROM %2").arg(pTable->selectString()).arg(sourceName(pTable, false));
+    if (!map.isEmpty())
+        sql += " WHERE " + whereString(pTable, map, values);
+
+    return sql;
+}
+
+QString DataManager::textSearchSql(const QMetaObject *pMetaObject) const
+{
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable)
+        return QString();
+
+    // the bm25 rank follows the columns, so rows from several databases can be merged on it
+    return QString("SELECT %1, rank FROM %2 JOIN (SELECT rowid AS fts_id, rank FROM %2_fts WHERE %2_fts MATCH ?) ON id = fts_id ORDER BY rank")
+        .arg(pTable->selectString()).arg(pTable->name());
+}
+
+DataObjectPtr DataManager::hydrateRow(const QMetaObject *pMetaObject, const QVariantList &row) const
+{
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable)
+        return nullptr;
+
+    return hydrateObject(pTable, m_classObjectMap[pMetaObject->className()], row);
+}
+
+void DataManager::readProperty(DataObjectPtr pObject, const QString &name)
+{
+    if (!pObject)
+        return;
+
+    Table *pTable = m_tableMap.value(pObject->metaObject()->className());
+    const Column *pColumn = pTable ? pTable->column(name) : nullptr;
+    if (!pColumn)
+        return;
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::ReadOperation);
+
+    QString sql = QString("SELECT %1 FROM %2 WHERE id = :id").arg(name).arg(sourceName(pTable, true));
+    TraceSpan span(activeTrace(), "step", sql);
+
+    QSqlQuery query(m_database);
+    query.prepare(sql);
+    query.bindValue(":id", pObject->id());
+    if (query.exec())
+    {
+        if (query.next())
+        {
+            pColumn->write(pObject.data(), query.value(0));
+            pObject->m_unloadedProperties.remove(name.toUtf8());
+        }
+    }
+    else
+    {
+        qDebug() << "Error: readProperty, " << query.lastError();
+    }
+}
+
+void DataManager::readProperties(const DataObjects &objects, const QString &name)
+{
+    const int batchSize = 500;
+    QByteArray propertyName = name.toUtf8();
+
+    // only objects of the same class that still need the property share a query
+    QMap<QString, QMap<qint64, DataObjectPtr>> classObjects;
+    for (auto & pObject : objects)
+    {
+        if (pObject && pObject->m_unloadedProperties.contains(propertyName))
+            classObjects[pObject->metaObject()->className()].insert(pObject->id(), pObject);
+    }
+
+    for (auto & className : classObjects.keys())
+    {
+        Table *pTable = m_tableMap.value(className);
+        const Column *pColumn = pTable ? pTable->column(name) : nullptr;
+        if (!pColumn)
+            continue;
+
+        const QMap<qint64, DataObjectPtr> & objectMap = classObjects[className];
+        QList<qint64> ids = objectMap.keys();
+
+        for (int start = 0; start < ids.size(); start += batchSize)
+        {
+            QList<qint64> batchIds = ids.mid(start, batchSize);
+
+            QStringList placeholders;
+            for (int i = 0; i < batchIds.size(); i++)
+                placeholders.append("?");
+
+            QSqlQuery query(m_database);
+            query.setForwardOnly(true);
+            query.prepare(QString("SELECT id, %1 FROM %2 WHERE id IN (%3)").arg(name).arg(sourceName(pTable, true)).arg(placeholders.join(", ")));
+
+            for (auto id : batchIds)
+                query.addBindValue(id);
+
+            if (query.exec())
+            {
+                while (query.next())
+                {
+                    DataObjectPtr pObject = objectMap.value(query.value(0).toLongLong());
+                    if (pObject)
+                    {
+                        pColumn->write(pObject.data(), query.value(1));
+                        pObject->m_unloadedProperties.remove(propertyName);
+                    }
+                }
+            }
+            else
             {
-                pObject = constructObject(pMetaObject);
-                if (!pObject)
-                    return nullptr; // ERROR
+                qDebug() << "Error: readProperty, " << query.lastError();
+            }
+        }
+    }
+}
+
+BlobDevice * DataManager::openBlob(DataObjectPtr pObject, const QString &name, QIODevice::OpenMode mode, qint64 size)
+{
+    if (!pObject)
+        return nullptr;
+
+    Table *pTable = m_tableMap.value(pObject->metaObject()->className());
+    const Column *pColumn = pTable ? pTable->column(name) : nullptr;
+    sqlite3 *pHandle = sqliteHandle();
+    if (!pColumn || !pHandle)
+        return nullptr;
+
+    bool writable = mode.testFlag(QIODevice::WriteOnly);
+
+    if (writable && size >= 0)
+    {
+        QSqlQuery query(m_database);
+        query.prepare(QString("UPDATE %1 SET %2 = zeroblob(:size) WHERE id = :id").arg(pTable->name()).arg(name));
+        query.bindValue(":size", size);
+        query.bindValue(":id", pObject->id());
+        if (!query.exec())
+        {
+            qDebug() << "Error: openBlob, " << query.lastError();
+            return nullptr;
+        }
+    }
+
+    sqlite3_blob *pBlob = nullptr;
+    int result = sqlite3_blob_open(pHandle, "main", pTable->name().toUtf8().constData(), name.toUtf8().constData(),
+        pObject->id(), writable ? 1 : 0, &pBlob);
+
+    if (result != SQLITE_OK)
+    {
+        qDebug() << "Error: openBlob, " << sqlite3_errmsg(pHandle);
+        sqlite3_blob_close(pBlob);
+        return nullptr;
+    }
+
+    // the in-memory value no longer matches the database once the blob is written
+    if (writable)
+        pObject->m_unloadedProperties.insert(name.toUtf8());
+
+    // resizing has already changed the row
+    BlobDevice *pDevice = new BlobDevice(pBlob, mode, this, pObject, writable && size >= 0);
+    m_blobDevices.removeAll(QPointer<BlobDevice>());
+    m_blobDevices.append(pDevice);
+
+    return pDevice;
+}
+
+void DataManager::reportBlobWrite(DataObjectPtr pObject)
+{
+    Table *pTable = m_tableMap.value(pObject->metaObject()->className());
+    if (!pTable || !m_database.isOpen())
+        return;
+
+    if (pTable->cache() && pTable->cache()->costMode() == EstimatedBytesCost)
+        cacheObject(pTable, pObject);
+
+    m_pendingChanges.addUpdated(pTable->name(), pObject->id());
+    scheduleChanges();
+
+    emit objectUpdated(pObject);
+}
+
+bool DataManager::isSQLiteApiAvailable() const
+{
+    return sqliteHandle() != nullptr;
+}
+
+sqlite3 * DataManager::sqliteHandle() const
+{
+    if (!m_database.isOpen() || !m_sharedSQLite)
+        return nullptr;
+
+    QVariant handle = m_database.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0)
+        return *static_cast<sqlite3 * const *>(handle.constData());
+
+    return nullptr;
+}
+
+DataObjects DataManager::findAllObjects(const QMetaObject *pMetaObject, bool includeArchive) const
+{
+    DataObjects objectList;
+
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::FindOperation);
 
-                pObject->setProperty("id", id);
-                mapObject(pMetaObject, pObject);
+    Table *pTable = m_tableMap.value(pMetaObject->className());
 
-                for (int i = 0; i < list.size(); i++)
-                {
-                    QString name = list[i];
-                    QVariant::Type type = typeMap.value(name);
-                    QVariant value = fromSQLiteVariant(type, query.value(i));
-                    if (value.isValid())
-                        pObject->setProperty(name.toUtf8(), value);
-                }
-            }
-        }
-        else
+    QElapsedTimer queryTimer;
+    startQueryTimer(queryTimer);
+
+    QString sql = QString("SELECT %1 FROM %2").arg(pTable->selectString()).arg(sourceName(pTable, includeArchive));
+    TraceSpan span(activeTrace(), "step", sql);
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+
+    if (query.exec())
+    {
+        auto & objectMap = m_classObjectMap[pMetaObject->className()];
+        while (query.next())
         {
-            qDebug() << "Error: findObject, id = " << id << ", not found" << query.lastError();
+            DataObjectPtr pObject = hydrateObject(pTable, objectMap, query);
+            if (pObject)
+                objectList.append(pObject);
         }
     }
 
-    return pObject;
+    query.finish();
+    span.end();
+    logSlowQuery(DataStatistics::FindOperation, sql, QVariantList(), queryTimer);
+
+    return objectList;
 }
 
-DataObjects DataManager::findAllObjects(const QMetaObject *pMetaObject) const
+DataObjects DataManager::findObjects(const QMetaObject *pMetaObject, const QVariantMap &map, bool includeArchive) const
 {
     DataObjects objectList;
 
-    QString className = pMetaObject->className();
-    Table *pTable = m_tableMap.value(className);
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::FindOperation);
 
-    QString selectStr;
-    QMap<QString, QVariant::Type> typeMap;
-    QStringList list = selectData(pMetaObject, selectStr, typeMap, true);
+    Table *pTable = m_tableMap.value(pMetaObject->className());
 
-    QSqlQuery query;
-    query.prepare(QString("SELECT %1 FROM %2").arg(selectStr).arg(pTable->name()));
+    QElapsedTimer queryTimer;
+    startQueryTimer(queryTimer);
 
-    if (query.exec())
-    {
-        while (query.next())
-        {
-            QVariantMap map;
+    QVariantList values;
+    QString whereClause = whereString(pTable, map, values);
 
-            for (int i = 0; i < list.size(); i++)
-            {
-                QString name = list[i];
-                QVariant::Type type = typeMap.value(name);
-                QVariant value = fromSQLiteVariant(type, query.value(i));
-                if (value.isValid())
-                    map.insert(name, value);
-            }
+    QString sql = QString("SELECT %1 FROM %2 WHERE %3").arg(pTable->selectString()).arg(sourceName(pTable, includeArchive)).arg(whereClause);
+    TraceSpan span(activeTrace(), "step", sql);
 
-            qint64 id = map.value("id").toLongLong();
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare(sql);
 
-            auto & objectMap = m_classObjectMap[className];
+    for (auto &value : values)
+        query.addBindValue(value);
 
-            if (objectMap.contains(id) && !objectMap.value(id).isNull())
-            {
-                DataObjectPtr pObject = objectMap.value(id).lock();
+    if (query.exec())
+    {
+        auto & objectMap = m_classObjectMap[pMetaObject->className()];
+        while (query.next())
+        {
+            DataObjectPtr pObject = hydrateObject(pTable, objectMap, query);
+            if (pObject)
                 objectList.append(pObject);
-            }
-            else
-            {
-                DataObjectPtr pObject = constructObject(pMetaObject);
-                if (pObject)
-                {
-                    setObjectProperties(pObject, map);
-                    mapObject(pMetaObject, pObject);
-                    objectList.append(pObject);
-                }
-            }
         }
     }
 
+    query.finish();
+    span.end();
+    logSlowQuery(DataStatistics::FindOperation, sql, values, queryTimer);
+
     return objectList;
 }
 
-DataObjects DataManager::findObjects(const QMetaObject *pMetaObject, const QVariantMap &map) const
+DataRows DataManager::selectRows(const QMetaObject *pMetaObject, const QStringList &columns, const QVariantMap &map) const
 {
-    DataObjects objectList;
-
-    QString className = pMetaObject->className();
-    Table *pTable = m_tableMap.value(className);
-
-    QString selectStr;
-    QMap<QString, QVariant::Type> typeMap;
-    QStringList list = selectData(pMetaObject, selectStr, typeMap, true);
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable)
+        return DataRows();
 
-    QString whereClause;
-    QStringList keys = map.keys();
+    QStringList columnNames = columns;
+    if (columnNames.isEmpty())
+        columnNames = pTable->selectString().split(", ");
 
-    for (int i = 0; i < keys.size(); i++)
+    QList<const Column*> selectColumns;
+    for (auto & name : columnNames)
     {
-        whereClause += QString("%1 = :%1").arg(keys[i]);
-        if (i != keys.size() - 1)
-            whereClause += ", ";
+        const Column *pColumn = pTable->column(name);
+        if (!pColumn)
+        {
+            qDebug() << "Error: select, unknown column " << name;
+            return DataRows();
+        }
+
+        selectColumns.append(pColumn);
     }
 
-    QSqlQuery query;
-    query.prepare(QString("SELECT %1 FROM %2 WHERE %3").arg(selectStr).arg(pTable->name()).arg(whereClause));
+    QVariantList values;
+    QString queryString = QString("SELECT %1 FROM %2").arg(columnNames.join(", ")).arg(pTable->name());
+    if (!map.isEmpty())
+        queryString += " WHERE " + whereString(pTable, map, values);
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare(queryString);
+
+    for (auto &value : values)
+        query.addBindValue(value);
 
-    for (auto &key : keys)
-        query.bindValue(":" + key, map.value(key));
+    DataRows rows(columnNames);
 
     if (query.exec())
     {
+        int count = selectColumns.size();
         while (query.next())
         {
-            QVariantMap map;
+            for (int i = 0; i < count; i++)
+                rows.appendValue(selectColumns.at(i)->fromSQLite(query.value(i)));
+        }
+    }
+    else
+    {
+        qDebug() << "Error: select, " << query.lastError();
+    }
 
-            for (int i = 0; i < list.size(); i++)
-            {
-                QString name = list[i];
-                QVariant::Type type = typeMap.value(name);
-                QVariant value = fromSQLiteVariant(type, query.value(i));
-                if (value.isValid())
-                    map.insert(name, value);
-            }
+    return rows;
+}
+
+sqlite3_stmt * DataManager::prepareColumn(const QMetaObject *pMetaObject, const QString &name, const QVariantMap &map) const
+{
+    Table *pTable = m_tableMap.value(pMetaObject->className());
+    if (!pTable || !pTable->column(name))
+    {
+        qDebug() << "Error: column, unknown column " << name;
+        return nullptr;
+    }
 
-            qint64 id = map.value("id").toLongLong();
+    sqlite3 *pHandle = sqliteHandle();
+    if (!pHandle)
+    {
+        qDebug() << "Error: column, the SQLite C API is not available.";
+        return nullptr;
+    }
 
-            auto & objectMap = m_classObjectMap[className];
+    // NULLs would otherwise read as 0
+    QVariantList values;
+    QString queryString = QString("SELECT %1 FROM %2 WHERE %1 IS NOT NULL").arg(name).arg(pTable->name());
+    if (!map.isEmpty())
+        queryString += " AND (" + whereString(pTable, map, values) + ")";
 
-            if (objectMap.contains(id) && !objectMap.value(id).isNull())
-            {
-                DataObjectPtr pObject = objectMap.value(id).lock();
-                objectList.append(pObject);
-            }
-            else
-            {
-                DataObjectPtr pObject = constructObject(pMetaObject);
-                if (pObject)
-                {
-                    setObjectProperties(pObject, map);
-                    mapObject(pMetaObject, pObject);
-                    objectList.append(pObject);
-                }
-            }
-        }
+    sqlite3_stmt *pStatement = nullptr;
+    if (sqlite3_prepare_v2(pHandle, queryString.toUtf8().constData(), -1, &pStatement, nullptr) != SQLITE_OK)
+    {
+        qDebug() << "Error: column, " << sqlite3_errmsg(pHandle);
+        sqlite3_finalize(pStatement);
+        return nullptr;
     }
 
-    return objectList;
+    for (int i = 0; i < values.size(); i++)
+        bindSQLiteValue(pStatement, i + 1, values.at(i));
+
+    return pStatement;
 }
 
-QStringList DataManager::selectData(const QMetaObject *pMetaObject, QString &selectString, QMap<QString, QVariant::Type> &typeMap, bool includeId)
+bool DataManager::readColumn(const QMetaObject *pMetaObject, const QString &name, const QVariantMap &map, QVector<double> &values) const
 {
-    QStringList list;
+    sqlite3_stmt *pStatement = prepareColumn(pMetaObject, name, map);
+    if (!pStatement)
+        return false;
 
-    selectString.clear();
-    typeMap.clear();
+    int result;
+    while ((result = sqlite3_step(pStatement)) == SQLITE_ROW)
+        values.append(sqlite3_column_double(pStatement, 0));
 
-    int count = pMetaObject->propertyCount();
+    if (result != SQLITE_DONE)
+        qDebug() << "Error: column, " << sqlite3_errstr(result);
 
-    for (int i = 0; i < count; ++i)
-    {
-        QMetaProperty property = pMetaObject->property(i);
-        QString name = property.name();
-        typeMap.insert(name, property.type());
+    sqlite3_finalize(pStatement);
+    return result == SQLITE_DONE;
+}
 
-        if (name != "id" || includeId)
-        {
-            list.append(name);
-            selectString += name;
+bool DataManager::readColumn(const QMetaObject *pMetaObject, const QString &name, const QVariantMap &map, QVector<qint64> &values) const
+{
+    sqlite3_stmt *pStatement = prepareColumn(pMetaObject, name, map);
+    if (!pStatement)
+        return false;
 
-            if (i != count - 1)
-                selectString += ", ";
-        }
+    int result;
+    while ((result = sqlite3_step(pStatement)) == SQLITE_ROW)
+        values.append(sqlite3_column_int64(pStatement, 0));
+
+    if (result != SQLITE_DONE)
+        qDebug() << "Error: column, " << sqlite3_errstr(result);
+
+    sqlite3_finalize(pStatement);
+    return result == SQLITE_DONE;
+}
+
+QString DataManager::whereString(Table *pTable, const QVariantMap &map, QVariantList &values)
+{
+    QStringList conditions;
+
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it)
+    {
+        const Column *pColumn = pTable->column(it.key());
+        conditions.append(QString("%1 = ?").arg(it.key()));
+        values.append(pColumn ? pColumn->toSQLite(it.value()) : it.value());
     }
 
-    return list;
+    return conditions.join(" AND ");
 }
 
 void DataManager::deleteObject(DataObjectPtr pObject, bool cascade)
@@ -760,25 +4563,61 @@ void DataManager::deleteObject(DataObjectPtr pObject, bool cascade)
     if (!m_classObjectMap.contains(className))
         return;
 
+    // an object that was never written only has to be forgotten
+    if (m_pendingSet.contains(pObject.data()))
+    {
+        removePendingObject(pObject);
+        return;
+    }
+
+    OperationTimer deleteTimer(m_pStatistics, activeTrace(), DataStatistics::DeleteOperation);
+
     auto & objectMap = m_classObjectMap[className];
     objectMap.remove(pObject->id());
+    if (pTable->cache())
+        pTable->cache()->remove(pTable, pObject->id());
+    uncacheRelationships(pTable, pObject->id());
 
-    QSqlQuery query;
-    query.prepare(QString("DELETE FROM %1 WHERE id = (:id)").arg(pTable->name()));
-    query.bindValue(":id", pObject->id());
-    if (query.exec())
+    bool success = true;
+    QSqlQuery query(m_database);
+
+    if (m_pWriteBehind)
+    {
+        m_pWriteBehind->enqueueDelete(pTable->name(), pObject->id(), QString("DELETE FROM %1 WHERE id = ?").arg(pTable->name()));
+    }
+    else
+    {
+        QString sql = QString("DELETE FROM %1 WHERE id = (:id)").arg(pTable->name());
+        query = preparedQuery(sql);
+        query.bindValue(":id", pObject->id());
+
+        TraceSpan span(activeTrace(), "step", sql);
+        success = query.exec();
+
+        if (success && m_archiveAttached)
+            success = deleteArchived(pTable, "id", pObject->id());
+    }
+
+    if (success)
     {
+        m_pendingChanges.addDeleted(className, pObject->id());
+        scheduleChanges();
+
         emit objectDeleted(pObject);
-        emit databaseChanged();
     }
     else
     {
         qDebug() << "Error: deleteObject, " << query.lastError();
     }
 
+    query.finish();
+    deleteTimer.stop();
+
     // cascade delete
     if (cascade)
     {
+        OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::CascadeOperation);
+
         Table *pTable = m_tableMap.value(pObject->metaObject()->className());
         auto & dependencyList = pTable->dependentPairs();
         for (auto & pair : dependencyList)
@@ -788,13 +4627,32 @@ void DataManager::deleteObject(DataObjectPtr pObject, bool cascade)
 
             Table *pSubTable = m_tableMap.value(subClassName);
 
-            QSqlQuery subquery;
-            subquery.prepare(QString("DELETE FROM %1 WHERE %2 = (:%2)").arg(pSubTable->name()).arg(columnName));
+            // dependent objects still in memory must not be served after their rows are gone
+            QList<qint64> ids;
+            if (pSubTable->metaObject())
+                ids = uncacheObjects(pSubTable, columnName, pObject->id());
+
+            if (m_pWriteBehind)
+            {
+                m_pWriteBehind->enqueueStatement(QString("DELETE FROM %1 WHERE %2 = ?").arg(pSubTable->name()).arg(columnName), QVariantList() << pObject->id());
+                for (auto id : ids)
+                    m_pendingChanges.addDeleted(subClassName, id);
+                scheduleChanges();
+                continue;
+            }
+
+            QString sql = QString("DELETE FROM %1 WHERE %2 = (:%2)").arg(pSubTable->name()).arg(columnName);
+            TraceSpan span(activeTrace(), "step", sql);
+
+            QSqlQuery subquery(m_database);
+            subquery.prepare(sql);
             subquery.bindValue(":" + columnName, pObject->id());
-            if (subquery.exec())
+            if (subquery.exec() && (!m_archiveAttached || !pSubTable->metaObject() || deleteArchived(pSubTable, columnName, pObject->id())))
             {
                 //emit objectDeleted(?);
-                emit databaseChanged();
+                for (auto id : ids)
+                    m_pendingChanges.addDeleted(subClassName, id);
+                scheduleChanges();
             }
             else
             {
@@ -815,109 +4673,99 @@ void DataManager::updateObject(DataObjectPtr pObject)
     if (!m_classObjectMap.contains(className))
         return;
 
-    QString updateStr;
-    QVariantMap map = updateData(pObject, updateStr);
+    // a pending object's values are read when it is persisted
+    if (m_pendingSet.contains(pObject.data()))
+        return;
 
-    QSqlQuery query;
-    query.prepare(QString("UPDATE %1 SET %2 WHERE id = :id").arg(pTable->name()).arg(updateStr));
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::UpdateOperation);
 
-    for (auto &key : map.keys())
-        query.bindValue(":" + key, map.value(key));
+    QString sql;
+    QVariantList values;
 
-    if (query.exec())
+    if (pObject->m_unloadedProperties.isEmpty())
     {
-        //qDebug() << "Success: " << query.executedQuery();
-        emit objectUpdated(pObject);
-        emit databaseChanged();
+        sql = pTable->updateString();
+
+        for (auto & column : pTable->dataColumns())
+            values.append(column.read(pObject.data()));
     }
     else
     {
-        qDebug() << "Error: saveObject, " << query.lastError();
-        qDebug() << "Query = " << query.executedQuery();
-    }
-
-    return;
-}
-
-QVariantMap DataManager::insertData(DataObjectPtr pObject, QString &columnsString, QString &valuesString)
-{
-    QVariantMap map;
-
-    columnsString.clear();
-    valuesString.clear();
-
-    const QMetaObject *pMetaObject = pObject->metaObject();
-    int count = pMetaObject->propertyCount();
-
-    for (int i = 0; i < count; ++i)
-    {
-        QMetaProperty property = pMetaObject->property(i);
-        QString name = property.name();
+        // leave deferred columns that were never loaded untouched
+        QStringList assignments;
 
-        if (name != "id")
+        for (auto & column : pTable->dataColumns())
         {
-            columnsString += name;
-            valuesString += ":" + name;
-            map.insert(name, toSQLiteVariant(pObject->property(property.name())));
+            if (column.isDeferred() && pObject->m_unloadedProperties.contains(column.name().toUtf8()))
+                continue;
 
-            if (i != count - 1)
-            {
-                columnsString += ", ";
-                valuesString += ", ";
-            }
+            assignments.append(column.name() + " = ?");
+            values.append(column.read(pObject.data()));
         }
-    }
-
-    return map;
-}
 
-QVariantMap DataManager::updateData(DataObjectPtr pObject, QString &updateString)
-{
-    QVariantMap map;
+        // nothing loaded means nothing changed
+        if (assignments.isEmpty())
+            return;
 
-    updateString.clear();
+        sql = QString("UPDATE %1 SET %2 WHERE id = ?").arg(pTable->name()).arg(assignments.join(", "));
+    }
 
-    const QMetaObject *pMetaObject = pObject->metaObject();
-    int count = pMetaObject->propertyCount();
+    bool success = true;
+    QSqlQuery query(m_database);
 
-    for (int i = 0; i < count; ++i)
+    if (m_pWriteBehind)
+    {
+        m_pWriteBehind->enqueueUpdate(pTable->name(), pObject->id(), sql, values);
+    }
+    else
     {
-        QMetaProperty property = pMetaObject->property(i);
-        QString name = property.name();
-        map.insert(name, toSQLiteVariant(pObject->property(property.name())));
+        query = preparedQuery(sql);
 
-        if (name != "id")
-        {
-            updateString += QString("%1 = :%1").arg(name);
+        for (auto & value : values)
+            query.addBindValue(value);
+        query.addBindValue(pObject->id());
+
+        TraceSpan span(activeTrace(), "step", sql);
+        success = query.exec();
 
-            if (i != count - 1)
-                updateString += ", ";
+        // an object that is not in the hot table has been archived
+        if (success && m_archiveAttached && query.numRowsAffected() == 0)
+        {
+            query.finish();
+
+            QSqlQuery archiveQuery(m_database);
+            archiveQuery.prepare("UPDATE archive." + sql.mid(qstrlen("UPDATE ")));
+            for (auto & value : values)
+                archiveQuery.addBindValue(value);
+            archiveQuery.addBindValue(pObject->id());
+            success = archiveQuery.exec();
         }
     }
 
-    return map;
-}
-
-QVariantMap DataManager::objectProperties(DataObjectPtr pObject)
-{
-    QVariantMap map;
+    if (success)
+    {
+        //qDebug() << "Success: " << query.executedQuery();
+        if (pTable->cache() && pTable->cache()->costMode() == EstimatedBytesCost)
+            cacheObject(pTable, pObject);
+        updateCachedLists(pTable, pObject);
 
-    const QMetaObject *pMetaObject = pObject->metaObject();
-    int count = pMetaObject->propertyCount();
+        m_pendingChanges.addUpdated(className, pObject->id());
+        scheduleChanges();
 
-    for (int i = 0; i < count; ++i)
-    {
-        QMetaProperty property = pMetaObject->property(i);
-        map.insert(property.name(), pObject->property(property.name()));
+        emit objectUpdated(pObject);
     }
+    else
+    {
+        qDebug() << "Error: saveObject, " << query.lastError();
+        qDebug() << "Query = " << query.executedQuery();
 
-    return map;
-}
+        // the cached copy no longer matches the database
+        if (pTable->cache())
+            pTable->cache()->remove(pTable, pObject->id());
+    }
 
-void DataManager::setObjectProperties(DataObjectPtr pObject, const QVariantMap &map)
-{
-    for (auto &key : map.keys())
-        pObject->setProperty(key.toUtf8(), map.value(key));
+    query.finish();
+    return;
 }
 
 QString DataManager::tableName(const QMetaObject * pMetaObject1, const QString & name1, const QMetaObject * pMetaObject2, const QString & name2)
@@ -937,112 +4785,6 @@ QString DataManager::tableName(const QMetaObject * pMetaObject1, const QString &
     return name;
 }
 
-QString DataManager::toSQLiteTypeString(QVariant::Type type)
-{
-    QString typeStr;
-
-    switch (type)
-    {
-    case QVariant::Int:
-    case QVariant::UInt:
-    case QVariant::LongLong:
-    case QVariant::ULongLong:
-    case QVariant::Bool:
-        typeStr = "INTEGER";
-        break;
-    case QVariant::String:
-    case QVariant::Char:
-    case QVariant::Uuid:
-    case QVariant::Date:
-    case QVariant::DateTime:
-    case QVariant::Time:
-    case QVariant::Color:
-        typeStr = "TEXT";
-        break;
-    case QVariant::Double:
-        typeStr = "REAL";
-        break;
-    case QVariant::ByteArray:
-    default:
-        typeStr = "BLOB";
-    }
-
-    return typeStr;
-}
-
-QVariant DataManager::toSQLiteVariant(const QVariant &value)
-{
-    QVariant returnValue;
-
-    switch (value.type())
-    {
-    case QVariant::Date:
-        returnValue = value.toDate().toString(Qt::ISODate);
-        break;
-    case QVariant::Time:
-        returnValue = value.toTime().toString(Qt::ISODate);
-        break;
-    case QVariant::DateTime:
-        returnValue = value.toDateTime().toString(Qt::ISODate);
-        break;
-    case QVariant::Color:
-        returnValue = value.value<QColor>().name();
-        break;
-    case QVariant::Bool:
-    case QVariant::Int:
-        returnValue = value.toInt();;
-        break;
-    case QVariant::UInt:
-        returnValue = value.toUInt();;
-        break;
-    case QVariant::LongLong:
-        returnValue = value.toLongLong();;
-        break;
-    case QVariant::ULongLong:
-        returnValue = value.toULongLong();;
-        break;
-    case QVariant::String:
-    case QVariant::Char:
-    case QVariant::Uuid:
-        returnValue = value.toString();
-        break;
-    case QVariant::Double:
-        returnValue = value.toDouble();
-        break;
-    case QVariant::ByteArray:
-    default:
-        returnValue = value.toByteArray();
-    }
-
-    return returnValue;
-}
-
-QVariant DataManager::fromSQLiteVariant(QVariant::Type propertyType, const QVariant &value)
-{
-    QVariant returnValue;
-
-    switch (propertyType)
-    {
-    case QVariant::DateTime:
-        returnValue = QDateTime::fromString(value.toString(), Qt::ISODate);
-        break;
-    case QVariant::Date:
-        returnValue = QDate::fromString(value.toString(), Qt::ISODate);
-        break;
-    case QVariant::Time:
-        returnValue = QTime::fromString(value.toString(), Qt::ISODate);
-        break;
-    case QVariant::Color:
-        returnValue = QColor(value.toString());
-        break;
-    default:
-        returnValue = value;
-        returnValue.convert(propertyType);
-    }
-
-    return returnValue;
-}
-
 DataObjectPtr DataManager::one(ConstDataObjectPtr pObject, const QMetaObject *pMetaObject, const QString &relationshipName) const
 {
     Table *pObjectTable = m_tableMap.value(pObject->metaObject()->className());
@@ -1072,17 +4814,59 @@ DataObjects DataManager::many(ConstDataObjectPtr pObject, const QMetaObject *pMe
     if (!pObject)
         return objects;
 
+    OperationTimer timer(m_pStatistics, activeTrace(), DataStatistics::ManyOperation);
+
     Table *pObjectTable = m_tableMap.value(pObject->metaObject()->className());
     if (pObjectTable)
     {
         Relationship *pRelationship = pObjectTable->relationship(relationshipName);
         Relationship *pInverseRelationship = pRelationship->inverseRelationship();
 
+        IdListCache *pCache = pRelationship ? pRelationship->cache() : nullptr;
+        const QList<qint64> *pIds = pCache ? pCache->object(pObject->id()) : nullptr;
+
+        if (pIds && pRelationship->type() == Relationship::OneToManyType)
+        {
+            // served from memory only while every member is loaded, otherwise one query reloads them all
+            auto & objectMap = m_classObjectMap[pInverseRelationship->metaObject()->className()];
+            for (auto id : *pIds)
+            {
+                DataObjectPtr pMember = objectMap.value(id).lock();
+                if (!pMember)
+                    break;
+                objects.append(pMember);
+            }
+
+            if (objects.size() == pIds->size())
+                return objects;
+
+            objects.clear();
+        }
+        else if (pIds && pRelationship->type() == Relationship::ManyToManyType)
+        {
+            for (auto id : *pIds)
+            {
+                DataObjectPtr pMember = findObject(pInverseRelationship->metaObject(), id);
+                if (pMember)
+                    objects.append(pMember);
+            }
+
+            return objects;
+        }
+
         if (pRelationship && pInverseRelationship && pRelationship->type() == Relationship::OneToManyType)
         {
             QVariantMap map;
             map.insert(pInverseRelationship->name(), pObject->id());
-            objects = findObjects(pInverseRelationship->metaObject(), map);
+            objects = findObjects(pInverseRelationship->metaObject(), map, true);
+
+            if (pCache)
+            {
+                QList<qint64> ids;
+                for (auto & pMember : objects)
+                    ids.append(pMember->id());
+                setCachedIds(pCache, pObject->id(), ids);
+            }
         }
         else if (pRelationship && pInverseRelationship && pRelationship->type() == Relationship::ManyToManyType)
         {
@@ -1091,8 +4875,14 @@ DataObjects DataManager::many(ConstDataObjectPtr pObject, const QMetaObject *pMe
 
             QString whereStr = QString("%1 = :%1").arg(inverseName);
 
-            QSqlQuery query;
-            query.prepare(QString("SELECT %1 FROM %2 WHERE %3").arg(relationshipName).arg(manyToManyName).arg(whereStr));
+            QElapsedTimer queryTimer;
+            startQueryTimer(queryTimer);
+
+            QString sql = QString("SELECT %1 FROM %2 WHERE %3").arg(relationshipName).arg(manyToManyName).arg(whereStr);
+            TraceSpan span(activeTrace(), "step", sql);
+
+            QSqlQuery query(m_database);
+            query.prepare(sql);
             query.bindValue(":" + inverseName, pObject->id());
             if (query.exec())
             {
@@ -1100,6 +4890,13 @@ DataObjects DataManager::many(ConstDataObjectPtr pObject, const QMetaObject *pMe
                 while (query.next())
                     ids.append(query.value(0).toLongLong());
 
+                query.finish();
+                span.end();
+                logSlowQuery(DataStatistics::ManyOperation, sql, QVariantList() << pObject->id(), queryTimer);
+
+                if (pCache)
+                    setCachedIds(pCache, pObject->id(), ids);
+
                 for (auto id : ids)
                 {
                     DataObjectPtr pObject = findObject(pInverseRelationship->metaObject(), id);
@@ -1156,7 +4953,17 @@ void DataManager::add(DataObjectPtr pObject, const QString &relationshipName, Da
                 {
                     QString manyToManyName = tableName(pObject->metaObject(), pRelationship->name(), pTargetObject->metaObject(), pInverseRelationship->name());
                     Table *pManyToManyTable = m_tableMap.value(manyToManyName);
-                    if (pManyToManyTable)
+                    if (pManyToManyTable && (m_pendingSet.contains(pObject.data()) || m_pendingSet.contains(pTargetObject.data())))
+                    {
+                        // written with the pending objects
+                        PendingLink link;
+                        link.sql = QString("INSERT INTO %1 (%2, %3) VALUES (?, ?)").arg(pManyToManyTable->name()).arg(relationshipName).arg(pInverseRelationship->name());
+                        link.pRelationship = pRelationship;
+                        link.pObject = pObject;
+                        link.pTargetObject = pTargetObject;
+                        m_pendingLinks.append(link);
+                    }
+                    else if (pManyToManyTable)
                     {
                         QString name2 = pInverseRelationship->name();
 
@@ -1167,17 +4974,21 @@ void DataManager::add(DataObjectPtr pObject, const QString &relationshipName, Da
                         valuesStr = ":" + relationshipName + ", ";
                         valuesStr += ":" + name2;
 
-                        QSqlQuery query;
-                        query.prepare(QString("INSERT INTO %1 (%2) VALUES (%3)").arg(pManyToManyTable->name()).arg(columnsStr).arg(valuesStr));
+                        // links are often added in bulk, so the statement is reused
+                        QSqlQuery query = preparedQuery(QString("INSERT INTO %1 (%2) VALUES (%3)").arg(pManyToManyTable->name()).arg(columnsStr).arg(valuesStr));
                         query.bindValue(":" + relationshipName, pTargetObject->id());
                         query.bindValue(":" + name2, pObject->id());
                         if (query.exec())
                         {
+                            appendCachedId(pRelationship->cache(), pObject->id(), pTargetObject->id());
+                            appendCachedId(pInverseRelationship->cache(), pTargetObject->id(), pObject->id());
                         }
                         else
                         {
                             qDebug() << "DataManager::add() query failed.";
                         }
+
+                        query.finish();
                     }
                 }
             }
@@ -1203,6 +5014,16 @@ void DataManager::remove(DataObjectPtr pObject, const QString &relationshipName,
                 {
                     QString manyToManyName = tableName(pObject->metaObject(), pRelationship->name(), pTargetObject->metaObject(), pInverseRelationship->name());
                     Table *pManyToManyTable = m_tableMap.value(manyToManyName);
+
+                    // a link that is still pending is dropped from either side
+                    for (int i = m_pendingLinks.size() - 1; i >= 0; i--)
+                    {
+                        const PendingLink &link = m_pendingLinks.at(i);
+                        if ((link.pRelationship == pRelationship && link.pObject == pObject && link.pTargetObject == pTargetObject) ||
+                            (link.pRelationship == pInverseRelationship && link.pObject == pTargetObject && link.pTargetObject == pObject))
+                            m_pendingLinks.removeAt(i);
+                    }
+
                     if (pManyToManyTable)
                     {
                         QString inverseName = pInverseRelationship->name();
@@ -1210,13 +5031,15 @@ void DataManager::remove(DataObjectPtr pObject, const QString &relationshipName,
                         QString whereStr;
                         whereStr = QString("%1 = :%1 AND %2 = :%2").arg(relationshipName).arg(inverseName);
 
-                        QSqlQuery query;
+                        QSqlQuery query(m_database);
                         query.prepare(QString("DELETE FROM %1 WHERE %2").arg(manyToManyName).arg(whereStr));
                         query.bindValue(":" + inverseName, pObject->id());
                         query.bindValue(":" + relationshipName, pTargetObject->id());
 
                         if (query.exec())
                         {
+                            removeCachedId(pRelationship->cache(), pObject->id(), pTargetObject->id());
+                            removeCachedId(pInverseRelationship->cache(), pTargetObject->id(), pObject->id());
                         }
                         else
                         {
@@ -1251,12 +5074,28 @@ void DataManager::removeAll(DataObjectPtr pObject, const QString &relationshipNa
                     {
                         QString inverseName = pInverseRelationship->name();
 
-                        QSqlQuery query;
+                        QSqlQuery query(m_database);
                         query.prepare(QString("DELETE FROM %1 WHERE %2 = :%2").arg(manyToManyName).arg(inverseName));
                         query.bindValue(":" + inverseName, pObject->id());
 
                         if (query.exec())
                         {
+                            IdListCache *pCache = pRelationship->cache();
+                            IdListCache *pInverseCache = pInverseRelationship->cache();
+                            const QList<qint64> *pIds = pCache ? pCache->object(pObject->id()) : nullptr;
+
+                            if (pInverseCache && pIds)
+                            {
+                                for (auto id : *pIds)
+                                    removeCachedId(pInverseCache, id, pObject->id());
+                            }
+                            else if (pInverseCache)
+                            {
+                                removeCachedIdFromAll(pInverseCache, pObject->id());
+                            }
+
+                            if (pCache)
+                                setCachedIds(pCache, pObject->id(), QList<qint64>());
                         }
                         else
                         {
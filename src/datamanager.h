@@ -18,30 +18,312 @@
 #pragma once
 
 #include "cgdata.h"
+#include "changeset.h"
 #include "dataobject.h"
+#include "datastatistics.h"
+#include "blobdevice.h"
+#include "datarows.h"
 
+#include <QCache>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QPointer>
+#include <QSet>
 #include <QSqlDatabase>
+#include <QSqlQuery>
 #include <QMap>
 #include <QVariant>
 #include <QPair>
+#include <QVector>
+
+#include <functional>
+#include <new>
+
+class QTimer;
+
+struct sqlite3;
+struct sqlite3_stmt;
 
 namespace cg
 {
 
     class Table;
     class Relationship;
+    class IdListCache;
+    class Column;
+
+    class ObjectPool;
+    class ObjectCache;
+    class WriteBehindQueue;
+    class TraceRecorder;
+    class DatabaseBackup;
+
+    // called after every backup step; returning false cancels the backup
+    typedef std::function<bool(int remainingPages, int pageCount)> BackupProgressFunction;
+
+    // constructors captured by DataManager::registerClass<T>()
+    struct ClassFactory
+    {
+        DataObjectPtr (*create)();
+        DataObject * (*construct)(void *pMemory);
+        size_t size;
+        size_t alignment;
+    };
+
+    struct CacheStatistics
+    {
+        qint64 hits;
+        qint64 misses;
+        qint64 evictions;
+        int objectCount;
+        int totalCost;
+    };
+
+    // a query that took longer than the slow query threshold
+    struct SlowQuery
+    {
+        QString operation;
+        QString sql;
+        QVariantList values;
+        qint64 elapsedMicroseconds;
+        QStringList queryPlan;
+        QDateTime timestamp;
+    };
+
+    // an entry in the change log, see DataManager::changesSince()
+    struct ChangeRecord
+    {
+        enum Type
+        {
+            Inserted = 1,
+            Updated = 2,
+            Deleted = 3,
+            // moved from the hot table to the archive by archive()
+            Archived = 4
+        };
+
+        qint64 sequence;
+        QString className;
+        qint64 id;
+        Type type;
+    };
 
     class CGDATA_API DataManager : public QObject
     {
         Q_OBJECT
     public:
+        enum CacheCost
+        {
+            ObjectCountCost,
+            EstimatedBytesCost
+        };
+
+        enum DataFormat
+        {
+            CsvFormat,
+            JsonLinesFormat
+        };
+
+    public:
+        DataManager();
         DataManager(QList<const QMetaObject*> &metaObjectList);
         ~DataManager();
 
+        // Registers T with a factory that constructs it directly instead of through
+        // QMetaObject::newInstance(). Classes may be registered until the database is opened.
+        template <class T>
+        void registerClass()
+        {
+            ClassFactory factory;
+            factory.create = &DataManager::createInstance<T>;
+            factory.construct = &DataManager::constructInstance<T>;
+            factory.size = sizeof(T);
+            factory.alignment = Q_ALIGNOF(T);
+            registerClass(&T::staticMetaObject, factory);
+        }
+
+        // Allocates objects of a registered class from slabs of objectsPerSlab objects that are
+        // reused as objects are released, instead of one heap allocation per object.
+        bool setPoolingEnabled(const QMetaObject *pMetaObject, bool enabled, int objectsPerSlab = 256);
+
+        // Keeps strong references to recently used objects so they survive between lookups.
+        // A class limit gives the class its own cache; other classes share the global one.
+        // A limit of 0 disables the cache.
+        void setCacheLimit(int maxCost, CacheCost cost = ObjectCountCost);
+        void setCacheLimit(const QMetaObject *pMetaObject, int maxCost, CacheCost cost = ObjectCountCost);
+        // the limit and cost of the class's own cache, 0 when it shares the global one
+        int cacheLimit(const QMetaObject *pMetaObject) const;
+        CacheCost cacheCost(const QMetaObject *pMetaObject) const;
+        CacheStatistics cacheStatistics(const QMetaObject *pMetaObject = nullptr) const;
+        void resetCacheStatistics();
+        void clearCache();
+
+        // Counts operations, latencies, hydrated rows, statement reuse and identity map lookups.
+        // Disabled by default, in which case nothing is measured. statistics() returns a copy.
+        void setStatisticsEnabled(bool enabled);
+        bool isStatisticsEnabled() const;
+        DataStatistics statistics() const;
+        void resetStatistics();
+
+        // Records find, many and textSearch queries that take threshold microseconds or longer,
+        // with their EXPLAIN QUERY PLAN output, keeping the most recent capacity records and
+        // emitting slowQueryRecorded() for each. A negative threshold turns the log off.
+        void setSlowQueryThreshold(qint64 microseconds, int capacity = 100);
+        // bound values are left out of the records, for data that must not reach logs
+        void setSlowQueryRedaction(bool redact);
+        QList<SlowQuery> slowQueries() const;
+        void clearSlowQueries();
+
+        // Records a span for every operation and every statement it prepares, steps or hydrates,
+        // on the calling thread, until stopTrace() or maxEvents spans. The trace is kept until the
+        // next startTrace() and can be saved as Chrome trace-event JSON for chrome://tracing or Perfetto.
+        void startTrace(int maxEvents = 1000000);
+        void stopTrace();
+        bool isTracing() const;
+        QByteArray traceJson() const;
+        bool saveTrace(const QString &path) const;
+
+        // Remembers the target ids of a one-to-many or many-to-many relationship per object, so
+        // repeated many() calls skip the query. The limit is the total number of ids held.
+        // A limit of 0 disables the cache.
+        void setRelationshipCacheLimit(const QMetaObject *pMetaObject, const QString &relationshipName, int maxIds);
+
+        // The QtSql connection name, the default connection unless set before opening. Several
+        // DataManagers can be open at once with different connection names.
+        void setConnectionName(const QString &name);
+        QString connectionName() const;
+
+        // New objects get ids above base, or above the largest id in their table if that is
+        // larger, so databases with far apart bases never share an id.
+        void setIdBase(qint64 base);
+        qint64 idBase() const;
+
+        // Gives new objects of the class ids from blocks of blockSize ids reserved at a time in
+        // a sequence table in the file, instead of taking each id from its INSERT, so ids are
+        // known before rows are written. Every connection that inserts into the class should
+        // use blocks, or its inserts may take reserved ids. Unused ids are skipped after
+        // close(). A block size of 0 goes back to per-insert ids.
+        void setIdBlockSize(const QMetaObject *pMetaObject, int blockSize);
+
         bool isOpen() const;
+        // the schema is created when the database is empty; paths starting with file: are
+        // opened as URIs, so file:name?mode=memory&cache=shared opens a shared memory database
         bool open(const QString &path);
+        // Opens a private memory database, loaded from snapshotPath when that file exists, or
+        // from the previous snapshot when saving the last one was interrupted.
+        // With a snapshot path the database is saved there every snapshotInterval milliseconds
+        // (if positive), on saveSnapshot() and on close().
+        bool openInMemory(const QString &snapshotPath = QString(), int snapshotInterval = 0);
+        bool isInMemory() const;
+        bool saveSnapshot();
         void close();
+        // Blob streaming, column reads, backups and snapshots call the SQLite C API on the
+        // driver's connection; they are only available when the QSQLITE driver uses the SQLite
+        // library linked by cgData (Qt configured with -system-sqlite).
+        bool isSQLiteApiAvailable() const;
+
+        // Changes made between begin and commit are reported in a single changesCommitted().
+        // Outside a transaction, changes are collected until control returns to the event loop.
+        // databaseChanged() is not coalesced and is still emitted right after every write.
+        // Transactions nest as savepoints, so rolling back an inner one only undoes its own
+        // changes, and objects it changed are read again.
+        bool beginTransaction();
+        bool commitTransaction();
+        bool rollbackTransaction();
+
+        // Queues inserts, updates and deletes for a background thread that writes them in
+        // batches of up to batchSize statements, at most flushInterval milliseconds after they
+        // are queued. Queries do not wait for queued writes; call waitForDurable() first when
+        // they must see them.
+        bool setWriteBehindEnabled(bool enabled, int batchSize = 500, int flushInterval = 50);
+        bool isWriteBehindEnabled() const;
+        // starts writing everything queued so far without waiting for it
+        void flush();
+        // Blocks until everything queued so far is committed. False on timeout, or when a
+        // queued write failed, in which case its whole batch was rolled back and none of the
+        // writes queued with it are in the database.
+        bool waitForDurable(int timeout = -1);
+
+        // Starts an online backup to a new file at path, copying pagesPerStep pages at a time
+        // from the event loop, so the database stays readable and writable in between.
+        // backupFinished() reports the result. Writes made through this DataManager are
+        // carried into the copy; writes from other connections restart it. Write-behind batches
+        // are held back until the backup finishes, and waitForDurable() finishes it at once.
+        bool backupTo(const QString &path, int pagesPerStep = 256, BackupProgressFunction progress = BackupProgressFunction());
+        bool isBackupRunning() const;
+        void cancelBackup();
+        // Writes a compacted copy, without free pages or fragmentation, with VACUUM INTO in one
+        // statement that blocks the calling thread. Before SQLite 3.27 the copy is made with the
+        // backup API instead and is not compacted.
+        bool snapshotTo(const QString &path);
+
+        // Streams the rows of a class, or of one of its many-to-many relationships, between the
+        // database and a device without creating objects. Columns are matched by property name
+        // (the two relationship names for a relationship), ids are kept so relationships survive
+        // the round trip, and values pass through the same type converters as properties. CSV
+        // starts with a header row, an empty field is NULL and "" an empty string; blobs are
+        // base64, and JSON integers beyond 2^53 are strings. Imports commit every chunkSize rows
+        // and return the number of rows committed, or -1 when they cannot start. A failing row
+        // rolls back its chunk, keeps the earlier ones and sets ok to false.
+        qint64 importFrom(const QMetaObject *pMetaObject, QIODevice *pDevice, DataFormat format, int chunkSize = 10000, bool *ok = nullptr);
+        qint64 importFrom(const QMetaObject *pMetaObject, const QString &relationshipName, QIODevice *pDevice, DataFormat format, int chunkSize = 10000, bool *ok = nullptr);
+        qint64 exportTo(const QMetaObject *pMetaObject, QIODevice *pDevice, DataFormat format) const;
+        qint64 exportTo(const QMetaObject *pMetaObject, const QString &relationshipName, QIODevice *pDevice, DataFormat format) const;
+
+        // Attaches a second database file that holds cold rows moved out by archive(). all()
+        // and find() only read the hot tables unless includeArchive is set; lookups by id,
+        // relationships, updates and cascading deletes reach archived rows as well. Archived
+        // rows are left out of textSearch().
+        bool attachArchive(const QString &path);
+        void detachArchive();
+        bool isArchiveAttached() const;
+        // condition is an SQL expression over the class's columns, such as "date < '2017-01-01'";
+        // an empty condition removes the policy
+        void setArchivePolicy(const QMetaObject *pMetaObject, const QString &condition);
+        // moves the rows matching each policy, batchSize rows per transaction, and returns how
+        // many were moved or -1
+        qint64 archive(int batchSize = 1000);
+
+        // Notices commits made through other connections to the same file, such as other
+        // processes, by polling PRAGMA data_version every pollInterval milliseconds. Triggers
+        // stored in the file log the class and id of every row written, from any connection,
+        // so only the objects in memory whose rows changed are read again or dropped, emitting
+        // objectUpdated() or objectDeleted() and a changesCommitted(). Polls trim the log to its
+        // newest retention entries, or keep all of it with a retention of 0; a DataManager that
+        // falls further behind reads all of its objects again. Disabling it drops the triggers
+        // and empties the log, unless change capture is on.
+        bool setChangeDetectionEnabled(bool enabled, int pollInterval = 100, int retention = 10000);
+        bool isChangeDetectionEnabled() const;
+        // checks for external commits now instead of at the next poll
+        void checkForChanges();
+
+        // Change data capture keeps every entry of the same change log until a consumer
+        // truncates it, instead of trimming it to the detection retention. Consumers read
+        // entries in sequence order, in batches of up to limit, from the last sequence they
+        // processed; many-to-many tables are logged by table name and rowid. A consumer that
+        // starts with a full scan begins from the lastChangeSequence() taken before it.
+        // Rows moved by archive() are logged as Archived; writes to archived rows are logged
+        // while the archive is attached to the connection making them. The setting is stored in
+        // the database file and applies to every connection; turning it off while change
+        // detection is off as well drops the log triggers.
+        bool setChangeCaptureEnabled(bool enabled);
+        bool isChangeCaptureEnabled() const;
+        qint64 lastChangeSequence() const;
+        QList<ChangeRecord> changesSince(qint64 sequence, int limit = 1000) const;
+        // removes entries up to and including sequence, once every consumer has processed them
+        bool truncateChanges(qint64 sequence);
+
+        // Calls functor with every change set that includes pMetaObject's class.
+        template <class Functor>
+        QMetaObject::Connection subscribe(const QMetaObject *pMetaObject, const QObject *pContext, Functor functor)
+        {
+            QString className = pMetaObject->className();
+            return connect(this, &DataManager::changesCommitted, pContext, [className, functor](const ChangeSet &changes) {
+                if (changes.contains(className))
+                    functor(changes);
+            });
+        }
 
         template <class T>
         QSharedPointer<T> createObject()
@@ -50,10 +332,77 @@ namespace cg
             return pDataObject.dynamicCast<T>();
         }
 
+        // Returns a new object with an id from its class's id block but no row yet, so graphs
+        // of objects can be built and linked with setOne() and add() before persistPending()
+        // writes them and their many-to-many links in one transaction. Queries only see them
+        // once persisted; close() persists whatever is still pending.
+        template <class T>
+        QSharedPointer<T> createPending()
+        {
+            DataObjectPtr pDataObject = newPendingObject(&T::staticMetaObject);
+            return pDataObject.dynamicCast<T>();
+        }
+
+        // false leaves the objects pending, for example to retry after the database was busy.
+        // Inside a transaction objectCreated() waits for the outermost commit, and rolling back
+        // a transaction in which ids were reserved discards the pending objects holding them.
+        bool persistPending();
+        void discardPending();
+        int pendingCount() const;
+
+        // Inserts the object's row, or updates the row whose key already matches, with one
+        // INSERT ... ON CONFLICT after looking the key up in the same savepoint. The key is id,
+        // which the object must then have, or a property declared with QD_UNIQUE. Returns the
+        // object held in memory for the row, which is pObject unless another object already was
+        // and has taken its values, after emitting objectCreated() or objectUpdated(). An object
+        // that already has a row fails when its key matches another one. Not available with
+        // write-behind. Each call costs a savepoint, a key lookup and the INSERT, so batches
+        // belong in upsertMany().
+        template <class T>
+        QSharedPointer<T> upsert(QSharedPointer<T> pObject, const QString &keyName = "id")
+        {
+            DataObjectPtr pDataObject = upsertObject(pObject, keyName);
+            return pDataObject.dynamicCast<T>();
+        }
+
+        // Upserts the objects in one transaction, returning an empty list if any of them fails.
+        // The keys are looked up together, 500 to a SELECT ... IN, so each object only costs
+        // its INSERT ... ON CONFLICT. Objects are mapped and announced after the commit.
+        template <class T>
+        QList<QSharedPointer<T>> upsertMany(const QList<QSharedPointer<T>> &objects, const QString &keyName = "id")
+        {
+            DataObjects dataObjects;
+            for (auto &pObject : objects)
+                dataObjects.append(pObject);
+
+            dataObjects = upsertObjects(dataObjects, keyName);
+
+            QList<QSharedPointer<T>> list;
+            for (auto &pObject : dataObjects)
+                list.append(pObject.dynamicCast<T>());
+
+            return list;
+        }
+
         void readObject(DataObjectPtr pObject);
         void updateObject(DataObjectPtr pObject);
+        void reportBlobWrite(DataObjectPtr pObject);
         void deleteObject(DataObjectPtr pObject, bool cascade = true);
 
+        void readProperty(DataObjectPtr pObject, const QString &name);
+
+        template <class T>
+        void readProperty(const QList<QSharedPointer<T>> &objects, const QString &name)
+        {
+            DataObjects dataObjects;
+            for (auto &pObject : objects)
+                dataObjects.append(pObject);
+
+            readProperties(dataObjects, name);
+        }
+
+        BlobDevice * openBlob(DataObjectPtr pObject, const QString &name, QIODevice::OpenMode mode, qint64 size = -1);
+
         template <class T>
         QSharedPointer<T> object(qint64 id) const
         {
@@ -62,9 +411,9 @@ namespace cg
         }
 
         template <class T>
-        QList<QSharedPointer<T>> all() const
+        QList<QSharedPointer<T>> all(bool includeArchive = false) const
         {
-            DataObjects objects = findAllObjects(&T::staticMetaObject);
+            DataObjects objects = findAllObjects(&T::staticMetaObject, includeArchive);
 
             QList<QSharedPointer<T>> list;
             for (auto &pObject : objects)
@@ -74,9 +423,9 @@ namespace cg
         }
 
         template <class T>
-        QList<QSharedPointer<T>> find(const QVariantMap &map) const
+        QList<QSharedPointer<T>> find(const QVariantMap &map, bool includeArchive = false) const
         {
-            DataObjects objects = findObjects(&T::staticMetaObject, map);
+            DataObjects objects = findObjects(&T::staticMetaObject, map, includeArchive);
 
             QList<QSharedPointer<T>> list;
             for (auto &pObject : objects)
@@ -97,6 +446,27 @@ namespace cg
             return list;
         }
 
+        template <class T>
+        DataRows select(const QStringList &columns, const QVariantMap &map = QVariantMap()) const
+        {
+            return selectRows(&T::staticMetaObject, columns, map);
+        }
+
+        // Contiguous values of one numeric column, read without QVariant boxing; T is double or
+        // qint64. Rows where the column is NULL are left out. ok is set to false, with nothing
+        // returned, for an unknown column, without the SQLite C API or when the read fails.
+        template <class T>
+        QVector<T> column(const QMetaObject *pMetaObject, const QString &name, const QVariantMap &map = QVariantMap(), bool *ok = nullptr) const
+        {
+            QVector<T> values;
+            bool success = readColumn(pMetaObject, name, map, values);
+            if (!success)
+                values.clear();
+            if (ok)
+                *ok = success;
+            return values;
+        }
+
         DataObjectPtr one(ConstDataObjectPtr pObject, const QMetaObject *pMetaObject, const QString &name) const;
         DataObjects many(ConstDataObjectPtr pObject, const QMetaObject *pMetaObject, const QString &name) const;
         void setOne(DataObjectPtr pObject, const QString &relationshipName, DataObjectPtr pTargetObject);
@@ -108,41 +478,182 @@ namespace cg
         void databaseOpened();
         void databaseClosed();
         void databaseChanged();
+        void changesCommitted(const cg::ChangeSet &changes);
+        void slowQueryRecorded(const cg::SlowQuery &query);
+        void backupFinished(const QString &path, bool success);
         void objectCreated(DataObjectPtr pObject);
         void objectUpdated(DataObjectPtr pObject);
         void objectDeleted(DataObjectPtr pObject);
 
     private:
+        friend class ShardedDataManager;
+        typedef QMap<qint64, QWeakPointer<DataObject>> ObjectMap;
+
+        // a many-to-many link added while one of its objects was pending
+        struct PendingLink
+        {
+            QString sql;
+            Relationship *pRelationship;
+            DataObjectPtr pObject, pTargetObject;
+        };
+
+        // ids reserved inside a transaction, which go back to the sequence table on rollback
+        struct ReservedBlock
+        {
+            Table *pTable;
+            qint64 start, end;
+            int depth;
+        };
+
+        // a row written by an upsert, whose object is mapped and announced once it is committed
+        struct UpsertedRow
+        {
+            Table *pTable;
+            DataObjectPtr pObject;
+            qint64 id;
+            bool created;
+            QList<const Column*> columns;
+        };
+
+        template <class T>
+        static DataObjectPtr createInstance()
+        {
+            return QSharedPointer<T>::create();
+        }
+
+        template <class T>
+        static DataObject * constructInstance(void *pMemory)
+        {
+            return new (pMemory) T();
+        }
+
+        void addClass(const QMetaObject *pMetaObject);
+        void registerClass(const QMetaObject *pMetaObject, const ClassFactory &factory);
+        void createRelationships();
+        void clearRelationships();
+
         DataObjectPtr newObject(const QMetaObject *pMetaObject);
+        DataObjectPtr newPendingObject(const QMetaObject *pMetaObject);
+        void removePendingObject(DataObjectPtr pObject);
+        DataObjectPtr upsertObject(DataObjectPtr pObject, const QString &keyName);
+        DataObjects upsertObjects(const DataObjects &objects, const QString &keyName);
+        Table * upsertTable(DataObjectPtr pObject, const QString &keyName) const;
+        QVariant upsertKey(Table *pTable, DataObjectPtr pObject, const QString &keyName) const;
+        bool findUpsertIds(Table *pTable, const QString &keyName, const QVariantList &keys, QHash<QString, qint64> &ids);
+        bool writeUpsert(const QString &keyName, UpsertedRow &row);
+        DataObjectPtr mapUpsert(const UpsertedRow &row);
         DataObjectPtr constructObject(const QMetaObject *pMetaObject) const;
+        DataObjectPtr constructObject(Table *pTable) const;
         void mapObject(const QMetaObject *pMetaObject, DataObjectPtr pObject) const;
         DataObjectPtr findObject(const QMetaObject *pMetaObject, qint64 id) const;
-        DataObjects findAllObjects(const QMetaObject *pMetaObject) const;
-        DataObjects findObjects(const QMetaObject *pMetaObject, const QVariantMap &map) const;
+        DataObjects findAllObjects(const QMetaObject *pMetaObject, bool includeArchive) const;
+        DataObjects findObjects(const QMetaObject *pMetaObject, const QVariantMap &map, bool includeArchive) const;
+        DataRows selectRows(const QMetaObject *pMetaObject, const QStringList &columns, const QVariantMap &map) const;
+        bool readColumn(const QMetaObject *pMetaObject, const QString &name, const QVariantMap &map, QVector<double> &values) const;
+        bool readColumn(const QMetaObject *pMetaObject, const QString &name, const QVariantMap &map, QVector<qint64> &values) const;
+        sqlite3_stmt * prepareColumn(const QMetaObject *pMetaObject, const QString &name, const QVariantMap &map) const;
+        DataObjectPtr hydrateObject(const QMetaObject *pMetaObject, Table *pTable, const QSqlQuery &query) const;
+        DataObjectPtr hydrateObject(Table *pTable, ObjectMap &objectMap, const QSqlQuery &query) const;
+        DataObjectPtr hydrateObject(Table *pTable, ObjectMap &objectMap, const QVariantList &row) const;
+        DataObjectPtr mappedObject(Table *pTable, ObjectMap &objectMap, qint64 id) const;
+        void readColumns(Table *pTable, const QSqlQuery &query, DataObjectPtr pObject) const;
+        void readColumns(Table *pTable, const QVariantList &row, DataObjectPtr pObject) const;
+        // SQL run on the ShardedDataManager's reader threads, whose rows are hydrated by hydrateRow()
+        QString findSql(const QMetaObject *pMetaObject, const QVariantMap &map, QVariantList &values) const;
+        QString textSearchSql(const QMetaObject *pMetaObject) const;
+        DataObjectPtr hydrateRow(const QMetaObject *pMetaObject, const QVariantList &row) const;
         void clearObjects();
+        void cacheObject(Table *pTable, DataObjectPtr pObject) const;
+        QList<qint64> uncacheObjects(Table *pTable, const QString &columnName, qint64 id);
+        void updateTableCaches();
+        void updateRelationshipCaches();
+        void updateCachedLists(Table *pTable, DataObjectPtr pObject);
+        void uncacheRelationships(Table *pTable, qint64 id);
+        void scheduleChanges();
+        qint64 allocateId(Table *pTable);
+        qint64 reserveId(Table *pTable);
+        bool createSequence(Table *pTable);
+        bool raiseSequence(Table *pTable);
+        bool allocatesIds(Table *pTable) const;
+        QString sourceName(Table *pTable, bool includeArchive) const;
+        bool deleteArchived(Table *pTable, const QString &columnName, qint64 id);
+        bool createChangeLog();
+        bool startChangeDetection();
+        bool dropChangeLog();
+        bool createArchiveLog();
+        bool isChangeLogged() const;
+        void refreshObjects(Table *pTable, const QList<qint64> &ids);
+        void revertChanges(const ChangeSet &changes);
+        void pruneChangeLog(qint64 minSequence, qint64 maxSequence);
+        bool transferColumns(const QMetaObject *pMetaObject, const QString &relationshipName, QString &name, QStringList &names, QList<const Column*> &columns) const;
+        QSqlQuery preparedQuery(const QString &sql) const;
+        TraceRecorder * activeTrace() const;
+        void startQueryTimer(QElapsedTimer &timer) const;
+        void logSlowQuery(DataStatistics::Operation operation, const QString &sql, const QVariantList &values, const QElapsedTimer &timer) const;
+        void flushChanges();
+        void stepBackup();
+        void readProperties(const DataObjects &objects, const QString &name);
+        sqlite3 * sqliteHandle() const;
 
+        void createSchema();
+        void createUniqueIndexes();
+        bool loadSnapshot(const QString &path);
         void createVirtualTable(const QString &tableName, const QStringList &textColumnList);
         DataObjects textSearch(const QMetaObject *pMetaObject, const QString &text) const;
 
     private:
-        static QString toSQLiteTypeString(QVariant::Type type);
-        static QVariant toSQLiteVariant(const QVariant &value);
-        static QVariant fromSQLiteVariant(QVariant::Type propertyType, const QVariant &value);
-        static QVariantMap insertData(DataObjectPtr pObject, QString &columnsString, QString &valuesString);
-        static QVariantMap updateData(DataObjectPtr pObject, QString &updateString);
-        static QStringList selectData(const QMetaObject *pMetaObject, QString &selectString, QMap<QString, QVariant::Type> &typeMap, bool includeId = false);
-        static QVariantMap objectProperties(DataObjectPtr pObject);
-        static void setObjectProperties(DataObjectPtr pObject, const QVariantMap &values);
+        static QString whereString(Table *pTable, const QVariantMap &map, QVariantList &values);
         static QString tableName(const QMetaObject *pMetaObject1, const QString &name1, const QMetaObject *pMetaObject2, const QString &name2);
 
     private:
         QSqlDatabase m_database;
+        QList<const QMetaObject*> m_metaObjects;
         QMap<QString, Table*> m_tableMap;
         QList<Relationship*> m_relationships;
-        typedef QMap<qint64, QWeakPointer<DataObject>> ObjectMap;
+        bool m_relationshipsDirty;
         mutable QMap<QString, ObjectMap> m_classObjectMap;
+        ObjectCache *m_pCache;
+        QMap<QString, ObjectCache*> m_classCaches;
+        QMap<QString, IdListCache*> m_relationshipCaches;
+        QList<QPointer<BlobDevice>> m_blobDevices;
+        ChangeSet m_pendingChanges;
+        bool m_changesScheduled;
+        int m_transactionDepth;
+        QList<ChangeSet> m_savepointChanges;
+        WriteBehindQueue *m_pWriteBehind;
+        DataStatistics *m_pStatistics;
+        mutable QHash<QString, QSqlQuery> m_statements;
+        qint64 m_slowQueryThreshold;
+        int m_slowQueryCapacity;
+        bool m_redactSlowQueries;
+        mutable QList<SlowQuery> m_slowQueries;
+        TraceRecorder *m_pTrace;
+        bool m_tracing;
+        DatabaseBackup *m_pBackup;
+        int m_backupPagesPerStep;
+        BackupProgressFunction m_backupProgress;
+        bool m_inMemory;
+        QString m_snapshotPath;
+        QTimer *m_pSnapshotTimer;
+        QString m_connectionName;
+        qint64 m_idBase;
+        bool m_archiveAttached;
+        bool m_sharedSQLite;
+        QMap<QString, QString> m_archivePolicies;
+        bool m_changeDetection;
+        int m_changeRetention;
+        QTimer *m_pChangeTimer;
+        qint64 m_dataVersion;
+        qint64 m_lastChangeSequence;
+        DataObjects m_pendingObjects;
+        QSet<const DataObject*> m_pendingSet;
+        QList<PendingLink> m_pendingLinks;
+        QList<ReservedBlock> m_reservedBlocks;
+        DataObjects m_persistedObjects;
     };
 
 }
 
+Q_DECLARE_METATYPE(cg::SlowQuery)
+
 #endif // CGDATA_DATAMANAGER_H
\ No newline at end of file
@@ -48,6 +48,40 @@ namespace cg
             m_pDataManager->deleteObject(sharedFromThis(), cascade);
     }
 
+    bool DataObject::isPropertyLoaded(const char *name) const
+    {
+        return !m_unloadedProperties.contains(name);
+    }
+
+    void DataObject::loadProperty(const char *name) const
+    {
+        if (m_pDataManager && !m_unloadedProperties.isEmpty() && m_unloadedProperties.contains(name))
+        {
+            DataObjectPtr pObject = const_cast<DataObject*>(this)->sharedFromThis();
+            m_pDataManager->readProperty(pObject, name);
+        }
+    }
+
+    void DataObject::setPropertyLoaded(const char *name)
+    {
+        if (!m_unloadedProperties.isEmpty())
+            m_unloadedProperties.remove(name);
+    }
+
+    void DataObject::readProperty(const char *name)
+    {
+        if (m_pDataManager)
+            m_pDataManager->readProperty(sharedFromThis(), name);
+    }
+
+    BlobDevice * DataObject::openBlob(const char *name, QIODevice::OpenMode mode, qint64 size)
+    {
+        if (m_pDataManager)
+            return m_pDataManager->openBlob(sharedFromThis(), name, mode, size);
+
+        return nullptr;
+    }
+
     void DataObject::setOne(const QString &relationshipName, DataObjectPtr pObject)
     {
         if (m_pDataManager)
@@ -88,4 +122,4 @@ namespace cg
         return DataObjects();
     }
 
-}
\ No newline at end of file
+}
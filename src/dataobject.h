@@ -20,12 +20,32 @@
 #include "cgdata.h"
 #include <QObject>
 #include <QEnableSharedFromThis>
+#include <QIODevice>
 #include <QList>
+#include <QSet>
 
 #define QD_PROPERTY(name, type, variable) \
     Q_PROPERTY(type name MEMBER variable) \
     type variable;
 
+#define QD_BLOB_PROPERTY(name, variable) \
+    Q_CLASSINFO(#name, "deferred") \
+    Q_PROPERTY(QByteArray name READ qd_get_##name WRITE qd_set_##name) \
+    QByteArray variable; \
+    QByteArray qd_get_##name() const { return variable; } \
+    void qd_set_##name(const QByteArray &value) { variable = value; setPropertyLoaded(#name); }
+
+#define QD_LAZY_PROPERTY(name, type, variable) \
+    Q_CLASSINFO(#name, "deferred") \
+    Q_PROPERTY(type name READ qd_get_##name WRITE qd_set_##name) \
+    type variable; \
+    type qd_get_##name() const { loadProperty(#name); return variable; } \
+    void qd_set_##name(const type &value) { variable = value; setPropertyLoaded(#name); }
+
+// a property with a unique index, which DataManager::upsert() can match rows on
+#define QD_UNIQUE(name) \
+    Q_CLASSINFO(#name, "unique")
+
 #define QD_TO_ONE_RELATIONSHIP(name, classname) \
     Q_CLASSINFO(#name, "-1:" #classname) \
     Q_PROPERTY(qint64 name MEMBER qd_##name) \
@@ -52,6 +72,7 @@ namespace cg
 {
     class DataManager;
     class DataObject;
+    class BlobDevice;
     typedef QSharedPointer<DataObject> DataObjectPtr;
     typedef QSharedPointer<const DataObject> ConstDataObjectPtr;
     typedef QList<DataObjectPtr> DataObjects;
@@ -72,6 +93,10 @@ namespace cg
         void update();
         void del(bool cascade = true);
 
+        bool isPropertyLoaded(const char *name) const;
+        void readProperty(const char *name);
+        BlobDevice * openBlob(const char *name, QIODevice::OpenMode mode, qint64 size = -1);
+
         template <class T>
         QSharedPointer<T> one(const QString &relationshipName) const
         {
@@ -97,6 +122,10 @@ namespace cg
         void remove(const QString &relationshipName, DataObjectPtr pObject);
         void removeAll(const QString &relationshipName);
 
+    protected:
+        void loadProperty(const char *name) const;
+        void setPropertyLoaded(const char *name);
+
     private:
         DataObjectPtr one(const QMetaObject *pMetaObject, const QString &name) const;
         DataObjects many(const QMetaObject *pMetaObject, const QString &name) const;
@@ -104,6 +133,7 @@ namespace cg
     private:
         friend class DataManager;
         DataManager *m_pDataManager;
+        QSet<QByteArray> m_unloadedProperties;
     };
 
 }
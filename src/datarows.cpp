@@ -0,0 +1,64 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "datarows.h"
+
+namespace cg
+{
+
+DataRows::DataRows()
+{
+}
+
+DataRows::DataRows(const QStringList &columnNames)
+    : m_columnNames(columnNames)
+{
+}
+
+int DataRows::rowCount() const
+{
+    if (m_columnNames.isEmpty())
+        return 0;
+
+    return m_values.size() / m_columnNames.size();
+}
+
+QVariant DataRows::value(int row, const QString &name) const
+{
+    int column = columnIndex(name);
+    if (column < 0)
+        return QVariant();
+
+    return value(row, column);
+}
+
+QVector<QVariant> DataRows::row(int row) const
+{
+    int count = m_columnNames.size();
+
+    QVector<QVariant> values;
+    values.reserve(count);
+    for (int i = 0; i < count; i++)
+        values.append(m_values.at(row * count + i));
+
+    return values;
+}
+
+void DataRows::reserve(int rowCount)
+{
+    m_values.reserve(rowCount * m_columnNames.size());
+}
+
+}
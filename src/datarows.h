@@ -0,0 +1,60 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_DATAROWS_H
+#define CGDATA_DATAROWS_H
+#pragma once
+
+#include "cgdata.h"
+
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+namespace cg
+{
+
+    // Result of a projection query: the selected columns of each row, stored row-major
+    // in a single buffer without constructing any objects.
+    class CGDATA_API DataRows
+    {
+    public:
+        DataRows();
+        DataRows(const QStringList &columnNames);
+
+        QStringList columnNames() const { return m_columnNames; }
+        int columnCount() const { return m_columnNames.size(); }
+        int rowCount() const;
+        int columnIndex(const QString &name) const { return m_columnNames.indexOf(name); }
+        bool isEmpty() const { return m_values.isEmpty(); }
+
+        QVariant value(int row, int column) const { return m_values.at(row * m_columnNames.size() + column); }
+        QVariant value(int row, const QString &name) const;
+        QVector<QVariant> row(int row) const;
+
+        // row-major buffer of rowCount() * columnCount() values
+        const QVector<QVariant> & values() const { return m_values; }
+
+        void reserve(int rowCount);
+        void appendValue(const QVariant &value) { m_values.append(value); }
+
+    private:
+        QStringList m_columnNames;
+        QVector<QVariant> m_values;
+    };
+
+}
+
+#endif // CGDATA_DATAROWS_H
@@ -0,0 +1,112 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "datastatistics.h"
+
+namespace cg
+{
+
+OperationStatistics::OperationStatistics()
+    : count(0), totalNanoseconds(0), maxNanoseconds(0), histogram(BucketCount, 0)
+{
+}
+
+void OperationStatistics::record(qint64 nanoseconds)
+{
+    count++;
+    totalNanoseconds += nanoseconds;
+    maxNanoseconds = qMax(maxNanoseconds, nanoseconds);
+
+    qint64 microseconds = nanoseconds / 1000;
+    int bucket = 0;
+    while (bucket < BucketCount - 1 && microseconds >= (Q_INT64_C(1) << bucket))
+        bucket++;
+
+    histogram[bucket]++;
+}
+
+double OperationStatistics::averageMicroseconds() const
+{
+    return count > 0 ? totalNanoseconds / 1000.0 / count : 0.0;
+}
+
+qint64 OperationStatistics::percentileMicroseconds(double fraction) const
+{
+    if (count == 0)
+        return 0;
+
+    qint64 target = qMax(Q_INT64_C(1), qint64(fraction * count + 0.5));
+    qint64 total = 0;
+
+    for (int bucket = 0; bucket < BucketCount; bucket++)
+    {
+        total += histogram.at(bucket);
+        if (total >= target)
+            return bucket < BucketCount - 1 ? (Q_INT64_C(1) << bucket) : maxNanoseconds / 1000;
+    }
+
+    return maxNanoseconds / 1000;
+}
+
+DataStatistics::DataStatistics()
+    : m_operations(OperationCount)
+{
+    reset();
+}
+
+const char * DataStatistics::operationName(Operation operation)
+{
+    switch (operation)
+    {
+    case CreateOperation:
+        return "create";
+    case ReadOperation:
+        return "read";
+    case UpdateOperation:
+        return "update";
+    case DeleteOperation:
+        return "delete";
+    case FindOperation:
+        return "find";
+    case ManyOperation:
+        return "many";
+    case TextSearchOperation:
+        return "textSearch";
+    case CascadeOperation:
+        return "cascade";
+    case UpsertOperation:
+        return "upsert";
+    default:
+        return "";
+    }
+}
+
+double DataStatistics::identityMapHitRate() const
+{
+    qint64 lookups = m_identityMapHits + m_identityMapMisses;
+    return lookups > 0 ? double(m_identityMapHits) / lookups : 0.0;
+}
+
+void DataStatistics::reset()
+{
+    m_operations.fill(OperationStatistics());
+    m_rowsHydrated = 0;
+    m_statementsPrepared = 0;
+    m_statementsReused = 0;
+    m_identityMapHits = 0;
+    m_identityMapMisses = 0;
+}
+
+}
@@ -0,0 +1,94 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_DATASTATISTICS_H
+#define CGDATA_DATASTATISTICS_H
+#pragma once
+
+#include "cgdata.h"
+
+#include <QString>
+#include <QVector>
+
+namespace cg
+{
+
+    // Count and latency distribution of one kind of operation. Bucket i of the histogram counts
+    // operations that finished in under 2^i microseconds; the last bucket holds everything slower.
+    struct CGDATA_API OperationStatistics
+    {
+        enum { BucketCount = 24 };
+
+        OperationStatistics();
+
+        void record(qint64 nanoseconds);
+        double averageMicroseconds() const;
+        // upper bound of the bucket that reaches the given fraction of operations
+        qint64 percentileMicroseconds(double fraction) const;
+
+        qint64 count;
+        qint64 totalNanoseconds;
+        qint64 maxNanoseconds;
+        QVector<qint64> histogram;
+    };
+
+    class CGDATA_API DataStatistics
+    {
+    public:
+        enum Operation
+        {
+            CreateOperation,
+            ReadOperation,
+            UpdateOperation,
+            DeleteOperation,
+            FindOperation,
+            ManyOperation,
+            TextSearchOperation,
+            CascadeOperation,
+            UpsertOperation,
+            OperationCount
+        };
+
+    public:
+        DataStatistics();
+
+        const OperationStatistics & operation(Operation operation) const { return m_operations.at(operation); }
+        static const char * operationName(Operation operation);
+
+        qint64 rowsHydrated() const { return m_rowsHydrated; }
+        qint64 statementsPrepared() const { return m_statementsPrepared; }
+        qint64 statementsReused() const { return m_statementsReused; }
+        qint64 identityMapHits() const { return m_identityMapHits; }
+        qint64 identityMapMisses() const { return m_identityMapMisses; }
+        double identityMapHitRate() const;
+
+        void record(Operation operation, qint64 nanoseconds) { m_operations[operation].record(nanoseconds); }
+        void addRowsHydrated(qint64 count = 1) { m_rowsHydrated += count; }
+        void addStatementPrepared() { m_statementsPrepared++; }
+        void addStatementReused() { m_statementsReused++; }
+        void addIdentityMapHit() { m_identityMapHits++; }
+        void addIdentityMapMiss() { m_identityMapMisses++; }
+        void reset();
+
+    private:
+        QVector<OperationStatistics> m_operations;
+        qint64 m_rowsHydrated;
+        qint64 m_statementsPrepared, m_statementsReused;
+        qint64 m_identityMapHits, m_identityMapMisses;
+    };
+
+}
+
+#endif // CGDATA_DATASTATISTICS_H
@@ -0,0 +1,72 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "objectcache.h"
+
+namespace cg
+{
+
+ObjectCache::ObjectCache(int maxCost)
+    : m_cache(maxCost), m_costMode(0), m_hits(0), m_misses(0), m_evictions(0)
+{
+}
+
+void ObjectCache::setMaxCost(int maxCost)
+{
+    int count = m_cache.count();
+    m_cache.setMaxCost(maxCost);
+    m_evictions += count - m_cache.count();
+}
+
+void ObjectCache::resetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_evictions = 0;
+}
+
+bool ObjectCache::hit(const void *pClass, qint64 id)
+{
+    // QCache::object() moves the entry to the front of the LRU list
+    bool cached = m_cache.object(Key(quintptr(pClass), id)) != nullptr;
+    if (cached)
+        m_hits++;
+    else
+        m_misses++;
+
+    return cached;
+}
+
+void ObjectCache::insert(const void *pClass, DataObjectPtr pObject, int cost)
+{
+    Key key(quintptr(pClass), pObject->id());
+    bool replacing = m_cache.contains(key);
+    int count = m_cache.count();
+
+    if (m_cache.insert(key, new DataObjectPtr(pObject), cost))
+        m_evictions += count + (replacing ? 0 : 1) - m_cache.count();
+}
+
+void ObjectCache::remove(const void *pClass, qint64 id)
+{
+    m_cache.remove(Key(quintptr(pClass), id));
+}
+
+void ObjectCache::clear()
+{
+    m_cache.clear();
+}
+
+}
@@ -0,0 +1,67 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_OBJECTCACHE_H
+#define CGDATA_OBJECTCACHE_H
+#pragma once
+
+#include "dataobject.h"
+
+#include <QCache>
+#include <QPair>
+
+namespace cg
+{
+
+    // Strong references to recently used objects, bounded by total cost and evicted least
+    // recently used first. Keys combine a class token with the object id, so one cache can
+    // serve several classes.
+    class ObjectCache
+    {
+    public:
+        explicit ObjectCache(int maxCost = 0);
+
+        int maxCost() const { return m_cache.maxCost(); }
+        void setMaxCost(int maxCost);
+
+        int costMode() const { return m_costMode; }
+        void setCostMode(int costMode) { m_costMode = costMode; }
+
+        int count() const { return m_cache.count(); }
+        int totalCost() const { return m_cache.totalCost(); }
+        qint64 hits() const { return m_hits; }
+        qint64 misses() const { return m_misses; }
+        qint64 evictions() const { return m_evictions; }
+        void resetStatistics();
+
+        // counts a hit and marks the object as most recently used, or counts a miss and
+        // returns false if it is not cached
+        bool hit(const void *pClass, qint64 id);
+        void miss() { m_misses++; }
+
+        void insert(const void *pClass, DataObjectPtr pObject, int cost);
+        void remove(const void *pClass, qint64 id);
+        void clear();
+
+    private:
+        typedef QPair<quintptr, qint64> Key;
+        QCache<Key, DataObjectPtr> m_cache;
+        int m_costMode;
+        qint64 m_hits, m_misses, m_evictions;
+    };
+
+}
+
+#endif // CGDATA_OBJECTCACHE_H
@@ -0,0 +1,77 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "objectpool.h"
+
+#include <cstddef>
+#include <new>
+
+namespace cg
+{
+
+ObjectPool::ObjectPool(size_t objectSize, size_t alignment, int objectsPerSlab)
+    : m_slotSize(0), m_objectsPerSlab(qMax(objectsPerSlab, 1)), m_pFreeList(nullptr)
+{
+    size_t size = qMax(objectSize, sizeof(FreeSlot));
+    m_slotSize = (size + alignment - 1) / alignment * alignment;
+}
+
+ObjectPool::~ObjectPool()
+{
+    for (auto pSlab : m_slabs)
+        ::operator delete(pSlab);
+}
+
+bool ObjectPool::supportsAlignment(size_t alignment)
+{
+    // slabs come from operator new, which aligns for any fundamental type
+    return alignment > 0 && alignment <= Q_ALIGNOF(std::max_align_t);
+}
+
+void * ObjectPool::allocate()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_pFreeList)
+    {
+        char *pSlab = static_cast<char*>(::operator new(m_slotSize * m_objectsPerSlab));
+        m_slabs.append(pSlab);
+
+        for (int i = m_objectsPerSlab - 1; i >= 0; i--)
+        {
+            FreeSlot *pSlot = reinterpret_cast<FreeSlot*>(pSlab + i * m_slotSize);
+            pSlot->pNext = m_pFreeList;
+            m_pFreeList = pSlot;
+        }
+    }
+
+    FreeSlot *pSlot = m_pFreeList;
+    m_pFreeList = pSlot->pNext;
+    return pSlot;
+}
+
+void ObjectPool::release(void *pMemory)
+{
+    if (!pMemory)
+        return;
+
+    QMutexLocker locker(&m_mutex);
+
+    FreeSlot *pSlot = static_cast<FreeSlot*>(pMemory);
+    pSlot->pNext = m_pFreeList;
+    m_pFreeList = pSlot;
+}
+
+}
@@ -0,0 +1,54 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_OBJECTPOOL_H
+#define CGDATA_OBJECTPOOL_H
+#pragma once
+
+#include <QMutex>
+#include <QList>
+
+namespace cg
+{
+
+    // Fixed-size slots carved out of slabs of objectsPerSlab objects. Released slots are kept on
+    // a free list and reused; slabs are only returned to the heap when the pool is destroyed.
+    class ObjectPool
+    {
+    public:
+        ObjectPool(size_t objectSize, size_t alignment, int objectsPerSlab);
+        ~ObjectPool();
+
+        void * allocate();
+        void release(void *pMemory);
+
+        static bool supportsAlignment(size_t alignment);
+
+    private:
+        struct FreeSlot
+        {
+            FreeSlot *pNext;
+        };
+
+        QMutex m_mutex;
+        size_t m_slotSize;
+        int m_objectsPerSlab;
+        QList<char*> m_slabs;
+        FreeSlot *m_pFreeList;
+    };
+
+}
+
+#endif // CGDATA_OBJECTPOOL_H
@@ -0,0 +1,241 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "shardeddatamanager.h"
+#include "shardreader.h"
+#include "tracerecorder.h"
+
+#include <QDebug>
+#include <QPair>
+
+#include <algorithm>
+
+namespace cg
+{
+
+    const qint64 ShardedDataManager::ShardIdRange;
+
+    namespace
+    {
+        typedef QPair<double, DataObjectPtr> RankedObject;
+
+        bool idLessThan(const DataObjectPtr &pObject1, const DataObjectPtr &pObject2)
+        {
+            return pObject1->id() < pObject2->id();
+        }
+
+        bool rankLessThan(const RankedObject &object1, const RankedObject &object2)
+        {
+            return object1.first < object2.first;
+        }
+    }
+
+    ShardedDataManager::ShardedDataManager(QList<const QMetaObject*> &metaObjectList, int shardCount)
+        : m_nextShard(0)
+    {
+        for (int i = 0; i < qMax(1, shardCount); i++)
+        {
+            DataManager *pShard = new DataManager(metaObjectList);
+            pShard->setParent(this);
+            pShard->setConnectionName(QString("cgdata_shard%1_%2").arg(i).arg(qulonglong(quintptr(this)), 0, 16));
+            pShard->setIdBase(i * ShardIdRange);
+            m_shards.append(pShard);
+        }
+    }
+
+    ShardedDataManager::~ShardedDataManager()
+    {
+        close();
+    }
+
+    void ShardedDataManager::setClassShard(const QMetaObject *pMetaObject, int index)
+    {
+        if (index >= 0 && index < m_shards.size())
+            m_classShards.insert(pMetaObject->className(), index);
+        else
+            m_classShards.remove(pMetaObject->className());
+    }
+
+    int ShardedDataManager::classShard(const QMetaObject *pMetaObject) const
+    {
+        return m_classShards.value(pMetaObject->className(), -1);
+    }
+
+    bool ShardedDataManager::open(const QStringList &paths)
+    {
+        if (paths.size() != m_shards.size())
+        {
+            qDebug() << "Error: ShardedDataManager::open, expected " << m_shards.size() << " paths.";
+            return false;
+        }
+
+        for (int i = 0; i < m_shards.size(); i++)
+        {
+            m_shards.at(i)->open(paths.at(i));
+            if (!m_shards.at(i)->isOpen())
+            {
+                close();
+                return false;
+            }
+        }
+
+        // a private memory database can only be read on the shard's own connection
+        for (auto & pShard : m_shards)
+            m_readers.append(pShard->m_inMemory && !pShard->m_database.databaseName().startsWith("file:") ? nullptr : new ShardReader(pShard->m_database.databaseName()));
+
+        return true;
+    }
+
+    bool ShardedDataManager::isOpen() const
+    {
+        for (auto & pShard : m_shards)
+        {
+            if (!pShard->isOpen())
+                return false;
+        }
+
+        return true;
+    }
+
+    void ShardedDataManager::close()
+    {
+        qDeleteAll(m_readers);
+        m_readers.clear();
+
+        for (auto & pShard : m_shards)
+            pShard->close();
+    }
+
+    int ShardedDataManager::nextShard(const QMetaObject *pMetaObject)
+    {
+        int index = classShard(pMetaObject);
+        if (index >= 0)
+            return index;
+
+        index = m_nextShard;
+        m_nextShard = (m_nextShard + 1) % m_shards.size();
+        return index;
+    }
+
+    QList<ShardedDataManager::ShardRows> ShardedDataManager::fanOut(const QMetaObject *pMetaObject, const ShardSql &shardSql) const
+    {
+        // a pinned class only has rows in its own shard
+        QList<int> indexes;
+        int index = classShard(pMetaObject);
+        if (index >= 0)
+        {
+            indexes.append(index);
+        }
+        else
+        {
+            for (int i = 0; i < m_shards.size(); i++)
+                indexes.append(i);
+        }
+
+        // every reader has its query before any rows are collected, so the shards are read at once
+        QList<ShardReader*> readers;
+        QStringList sqlList;
+        QList<QVariantList> valuesList;
+        for (int i : indexes)
+        {
+            DataManager *pShard = m_shards.at(i);
+
+            QVariantList values;
+            QString sql = shardSql(pShard, values);
+
+            ShardReader *pReader = pShard->m_transactionDepth == 0 ? m_readers.value(i) : nullptr;
+            if (pReader && !sql.isEmpty())
+                pReader->post(sql, values, pShard->activeTrace());
+
+            readers.append(pReader);
+            sqlList.append(sql);
+            valuesList.append(values);
+        }
+
+        QList<ShardRows> results;
+        for (int i = 0; i < indexes.size(); i++)
+        {
+            if (sqlList.at(i).isEmpty())
+                continue;
+
+            ShardRows shardRows;
+            shardRows.pShard = m_shards.at(indexes.at(i));
+
+            if (readers.at(i))
+            {
+                readers.at(i)->read(shardRows.rows);
+            }
+            else
+            {
+                TraceRecorder *pTrace = shardRows.pShard->activeTrace();
+                qint64 start = pTrace ? pTrace->now() : 0;
+                ShardReader::select(shardRows.pShard->m_database, sqlList.at(i), valuesList.at(i), shardRows.rows);
+                if (pTrace)
+                    pTrace->addEvent("step", "sql", start, pTrace->now(), "sql", sqlList.at(i));
+            }
+
+            results.append(shardRows);
+        }
+
+        return results;
+    }
+
+    DataObjects ShardedDataManager::findAllObjects(const QMetaObject *pMetaObject) const
+    {
+        return findObjects(pMetaObject, QVariantMap());
+    }
+
+    DataObjects ShardedDataManager::findObjects(const QMetaObject *pMetaObject, const QVariantMap &map) const
+    {
+        DataObjects objects;
+        for (auto & shardRows : fanOut(pMetaObject, [pMetaObject, map](DataManager *pShard, QVariantList &values) { return pShard->findSql(pMetaObject, map, values); }))
+        {
+            for (auto & row : shardRows.rows)
+            {
+                DataObjectPtr pObject = shardRows.pShard->hydrateRow(pMetaObject, row);
+                if (pObject)
+                    objects.append(pObject);
+            }
+        }
+
+        std::sort(objects.begin(), objects.end(), idLessThan);
+        return objects;
+    }
+
+    DataObjects ShardedDataManager::textSearch(const QMetaObject *pMetaObject, const QString &text) const
+    {
+        QList<RankedObject> rankedObjects;
+        for (auto & shardRows : fanOut(pMetaObject, [pMetaObject, text](DataManager *pShard, QVariantList &values) -> QString { values.append(text); return pShard->textSearchSql(pMetaObject); }))
+        {
+            // the rank is the last column, after the ones the object is built from
+            for (auto & row : shardRows.rows)
+            {
+                DataObjectPtr pObject = shardRows.pShard->hydrateRow(pMetaObject, row);
+                if (pObject)
+                    rankedObjects.append(RankedObject(row.last().toDouble(), pObject));
+            }
+        }
+
+        // bm25 ranks are negative and best first; each shard weighs terms by its own statistics
+        std::stable_sort(rankedObjects.begin(), rankedObjects.end(), rankLessThan);
+
+        DataObjects objects;
+        for (auto & rankedObject : rankedObjects)
+            objects.append(rankedObject.second);
+
+        return objects;
+    }
+
+}
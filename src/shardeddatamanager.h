@@ -0,0 +1,152 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_SHARDEDDATAMANAGER_H
+#define CGDATA_SHARDEDDATAMANAGER_H
+#pragma once
+
+#include "cgdata.h"
+#include "datamanager.h"
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+
+#include <functional>
+
+namespace cg
+{
+
+    class ShardReader;
+
+    // Spreads one model over several database files, each with its own DataManager (a shard)
+    // and so its own write lock. A class is either pinned to one shard or spread over all of
+    // them. Shard i hands out ids above i * ShardIdRange, so ids are unique across shards and
+    // name the shard that owns them.
+    //
+    // object() goes straight to the owning shard. all(), find() and textSearch() run their SQL on
+    // every shard at once, each on a reader thread with its own read-only connection, and build
+    // the objects from the rows on the calling thread, which owns the shards' identity maps and
+    // caches. A shard inside a transaction is read on its own connection instead, so it sees its
+    // uncommitted writes. Relationships are followed within a shard, so related objects belong
+    // together: create them with createObject<T>(shardOf(id)).
+    class CGDATA_API ShardedDataManager : public QObject
+    {
+        Q_OBJECT
+    public:
+        static const qint64 ShardIdRange = Q_INT64_C(1) << 48;
+
+    public:
+        ShardedDataManager(QList<const QMetaObject*> &metaObjectList, int shardCount);
+        ~ShardedDataManager();
+
+        template <class T>
+        void registerClass()
+        {
+            for (auto & pShard : m_shards)
+                pShard->registerClass<T>();
+        }
+
+        int shardCount() const { return m_shards.size(); }
+        DataManager * shard(int index) const { return m_shards.value(index); }
+        int shardOf(qint64 id) const { return int(id / ShardIdRange); }
+
+        // Keeps every object of the class in one shard. Classes are spread by default.
+        void setClassShard(const QMetaObject *pMetaObject, int index);
+        int classShard(const QMetaObject *pMetaObject) const;
+
+        // one path per shard
+        bool open(const QStringList &paths);
+        bool isOpen() const;
+        void close();
+
+        // in the class's shard, or the next shard in turn for a spread class
+        template <class T>
+        QSharedPointer<T> createObject()
+        {
+            return createObject<T>(nextShard(&T::staticMetaObject));
+        }
+
+        template <class T>
+        QSharedPointer<T> createObject(int shardIndex)
+        {
+            DataManager *pShard = shard(shardIndex);
+            return pShard ? pShard->createObject<T>() : QSharedPointer<T>();
+        }
+
+        template <class T>
+        QSharedPointer<T> object(qint64 id) const
+        {
+            DataManager *pShard = shard(shardOf(id));
+            return pShard ? pShard->object<T>(id) : QSharedPointer<T>();
+        }
+
+        // ordered by id
+        template <class T>
+        QList<QSharedPointer<T>> all() const
+        {
+            return cast<T>(findAllObjects(&T::staticMetaObject));
+        }
+
+        // ordered by id
+        template <class T>
+        QList<QSharedPointer<T>> find(const QVariantMap &map) const
+        {
+            return cast<T>(findObjects(&T::staticMetaObject, map));
+        }
+
+        // ordered by the bm25 rank each shard gives its matches
+        template <class T>
+        QList<QSharedPointer<T>> textSearch(const QString &text) const
+        {
+            return cast<T>(textSearch(&T::staticMetaObject, text));
+        }
+
+    private:
+        typedef std::function<QString(DataManager *pShard, QVariantList &values)> ShardSql;
+
+        struct ShardRows
+        {
+            DataManager *pShard;
+            QList<QVariantList> rows;
+        };
+
+        template <class T>
+        static QList<QSharedPointer<T>> cast(const DataObjects &objects)
+        {
+            QList<QSharedPointer<T>> list;
+            for (auto &pObject : objects)
+                list.append(pObject.dynamicCast<T>());
+
+            return list;
+        }
+
+        int nextShard(const QMetaObject *pMetaObject);
+        QList<ShardRows> fanOut(const QMetaObject *pMetaObject, const ShardSql &shardSql) const;
+        DataObjects findAllObjects(const QMetaObject *pMetaObject) const;
+        DataObjects findObjects(const QMetaObject *pMetaObject, const QVariantMap &map) const;
+        DataObjects textSearch(const QMetaObject *pMetaObject, const QString &text) const;
+
+    private:
+        QList<DataManager*> m_shards;
+        QList<ShardReader*> m_readers;
+        QMap<QString, int> m_classShards;
+        int m_nextShard;
+    };
+
+}
+
+#endif // CGDATA_SHARDEDDATAMANAGER_H
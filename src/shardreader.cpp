@@ -0,0 +1,157 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "shardreader.h"
+#include "tracerecorder.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QDebug>
+
+namespace cg
+{
+
+ShardReader::ShardReader(const QString &databaseName)
+    : m_databaseName(databaseName), m_pTrace(nullptr), m_queued(false), m_busy(false), m_success(false), m_stopping(false)
+{
+    m_connectionName = QString("cgdata_shardreader_%1").arg(qulonglong(quintptr(this)), 0, 16);
+}
+
+ShardReader::~ShardReader()
+{
+    stop();
+}
+
+void ShardReader::post(const QString &sql, const QVariantList &values, TraceRecorder *pTrace)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_sql = sql;
+    m_values = values;
+    m_pTrace = pTrace;
+    m_queued = true;
+    m_busy = true;
+
+    if (!isRunning() && !m_stopping)
+        start();
+
+    m_posted.wakeAll();
+}
+
+bool ShardReader::read(QList<QVariantList> &rows)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_busy)
+        m_finished.wait(&m_mutex);
+
+    rows.swap(m_rows);
+    m_rows.clear();
+    return m_success;
+}
+
+void ShardReader::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_posted.wakeAll();
+    }
+
+    wait();
+}
+
+void ShardReader::run()
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+        database.setDatabaseName(m_databaseName);
+        database.setConnectOptions(m_databaseName.startsWith("file:") ?
+            "QSQLITE_OPEN_READONLY;QSQLITE_OPEN_URI;QSQLITE_BUSY_TIMEOUT=5000" : "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+
+        if (!database.open())
+            qDebug() << "Error: shard reader connection, " << database.lastError();
+
+        forever
+        {
+            QString sql;
+            QVariantList values;
+            TraceRecorder *pTrace;
+
+            {
+                QMutexLocker locker(&m_mutex);
+
+                while (!m_queued && !m_stopping)
+                    m_posted.wait(&m_mutex);
+
+                if (!m_queued)
+                    break;
+
+                sql = m_sql;
+                values = m_values;
+                pTrace = m_pTrace;
+                m_queued = false;
+            }
+
+            QList<QVariantList> rows;
+            qint64 start = pTrace ? pTrace->now() : 0;
+            bool success = select(database, sql, values, rows);
+            if (pTrace)
+                pTrace->addEvent("step", "sql", start, pTrace->now(), "sql", sql);
+
+            QMutexLocker locker(&m_mutex);
+            m_rows.swap(rows);
+            m_success = success;
+            m_busy = false;
+            m_finished.wakeAll();
+        }
+
+        database.close();
+    }
+
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+bool ShardReader::select(QSqlDatabase &database, const QString &sql, const QVariantList &values, QList<QVariantList> &rows)
+{
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+
+    for (auto & value : values)
+        query.addBindValue(value);
+
+    if (!query.exec())
+    {
+        qDebug() << "Error: shard reader, " << query.lastError();
+        qDebug() << "Query = " << sql;
+        return false;
+    }
+
+    int count = query.record().count();
+    while (query.next())
+    {
+        QVariantList row;
+        row.reserve(count);
+        for (int i = 0; i < count; i++)
+            row.append(query.value(i));
+        rows.append(row);
+    }
+
+    return true;
+}
+
+}
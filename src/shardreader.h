@@ -0,0 +1,69 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_SHARDREADER_H
+#define CGDATA_SHARDREADER_H
+#pragma once
+
+#include <QList>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QString>
+#include <QThread>
+#include <QVariant>
+#include <QWaitCondition>
+
+namespace cg
+{
+
+    class TraceRecorder;
+
+    // A background thread with its own read-only connection to one shard's database file. The
+    // calling thread posts a query and later collects the rows, so queries posted to several
+    // readers run at the same time. Rows are plain values; objects are built from them on the
+    // calling thread, which owns the shard's identity map and caches.
+    class ShardReader : public QThread
+    {
+    public:
+        explicit ShardReader(const QString &databaseName);
+        ~ShardReader();
+
+        // values are bound in order; a "step" span is added to pTrace when it is set
+        void post(const QString &sql, const QVariantList &values, TraceRecorder *pTrace);
+        // blocks until the posted query has run, false when it failed
+        bool read(QList<QVariantList> &rows);
+        void stop();
+
+        // runs a query on the calling thread's connection, for shards that cannot be read from another one
+        static bool select(QSqlDatabase &database, const QString &sql, const QVariantList &values, QList<QVariantList> &rows);
+
+    protected:
+        void run() override;
+
+    private:
+        QString m_databaseName, m_connectionName;
+
+        QMutex m_mutex;
+        QWaitCondition m_posted, m_finished;
+        QString m_sql;
+        QVariantList m_values;
+        TraceRecorder *m_pTrace;
+        QList<QVariantList> m_rows;
+        bool m_queued, m_busy, m_success, m_stopping;
+    };
+
+}
+
+#endif // CGDATA_SHARDREADER_H
@@ -5,11 +5,47 @@ CONFIG += dll
 TEMPLATE = lib
 VERSION	= 0.1.1
 
-HEADERS += cgdata.h \
+HEADERS += blobdevice.h \
+	cgdata.h \
+	changeset.h \
+	columnkernels.h \
+	databasebackup.h \
 	datamanager.h \
-    dataobject.h
+	datastatistics.h \
+    dataobject.h \
+	datarows.h \
+	objectcache.h \
+	objectpool.h \
+	shardeddatamanager.h \
+	shardreader.h \
+	tracerecorder.h \
+    typeconverter.h \
+	writebehindqueue.h
 
-SOURCES += datamanager.cpp \
-    dataobject.cpp
+SOURCES += blobdevice.cpp \
+	changeset.cpp \
+	columnkernels.cpp \
+	databasebackup.cpp \
+	datamanager.cpp \
+	datastatistics.cpp \
+    dataobject.cpp \
+	datarows.cpp \
+	objectcache.cpp \
+	objectpool.cpp \
+	shardeddatamanager.cpp \
+	shardreader.cpp \
+	tracerecorder.cpp \
+    typeconverter.cpp \
+	writebehindqueue.cpp
 
-DEFINES += CGDATA_EXPORTS
\ No newline at end of file
+DEFINES += CGDATA_EXPORTS
+
+# Incremental blob I/O, column reads, online backups and memory snapshots use the SQLite C API
+# on the QSQLITE driver's handle, so Qt must be configured with -system-sqlite against the same
+# library linked here; otherwise those features report an error at run time. SQLITE_DIR names
+# an installation with include and lib directories, as needed on Windows.
+!isEmpty(SQLITE_DIR) {
+	INCLUDEPATH += $$SQLITE_DIR/include
+	LIBS += -L$$SQLITE_DIR/lib
+}
+LIBS += -lsqlite3
\ No newline at end of file
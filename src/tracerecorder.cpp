@@ -0,0 +1,87 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "tracerecorder.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+namespace cg
+{
+
+TraceRecorder::TraceRecorder(int maxEvents)
+    : m_maxEvents(maxEvents)
+{
+    m_clock.start();
+}
+
+void TraceRecorder::addEvent(const char *name, const char *category, qint64 start, qint64 end,
+    const char *argumentName, const QString &argument)
+{
+    Event event = { name, category, start, end - start, quint64(quintptr(QThread::currentThreadId())), argumentName, argument };
+
+    QMutexLocker locker(&m_mutex);
+
+    // later events are dropped rather than growing without bound
+    if (m_events.size() < m_maxEvents)
+        m_events.append(event);
+}
+
+int TraceRecorder::eventCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_events.size();
+}
+
+QByteArray TraceRecorder::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QJsonArray events;
+    qint64 pid = QCoreApplication::applicationPid();
+
+    for (auto & event : m_events)
+    {
+        // timestamps are in microseconds
+        QJsonObject object;
+        object.insert("name", QString::fromLatin1(event.name));
+        object.insert("cat", QString::fromLatin1(event.category));
+        object.insert("ph", QString("X"));
+        object.insert("ts", event.start / 1000.0);
+        object.insert("dur", event.duration / 1000.0);
+        object.insert("pid", pid);
+        object.insert("tid", qint64(event.threadId));
+
+        if (event.argumentName)
+        {
+            QJsonObject args;
+            args.insert(QString::fromLatin1(event.argumentName), event.argument);
+            object.insert("args", args);
+        }
+
+        events.append(object);
+    }
+
+    QJsonObject root;
+    root.insert("traceEvents", events);
+    root.insert("displayTimeUnit", QString("ms"));
+
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+}
@@ -0,0 +1,64 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_TRACERECORDER_H
+#define CGDATA_TRACERECORDER_H
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+namespace cg
+{
+
+    // Complete ("X") trace events with start and duration relative to the recorder's creation,
+    // serialized as Chrome trace-event JSON. Events may be added from any thread.
+    class TraceRecorder
+    {
+    public:
+        explicit TraceRecorder(int maxEvents);
+
+        qint64 now() const { return m_clock.nsecsElapsed(); }
+
+        void addEvent(const char *name, const char *category, qint64 start, qint64 end,
+            const char *argumentName = nullptr, const QString &argument = QString());
+
+        int eventCount() const;
+        QByteArray toJson() const;
+
+    private:
+        struct Event
+        {
+            const char *name;
+            const char *category;
+            qint64 start;
+            qint64 duration;
+            quint64 threadId;
+            const char *argumentName;
+            QString argument;
+        };
+
+        QElapsedTimer m_clock;
+        int m_maxEvents;
+        mutable QMutex m_mutex;
+        QList<Event> m_events;
+    };
+
+}
+
+#endif // CGDATA_TRACERECORDER_H
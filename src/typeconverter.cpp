@@ -0,0 +1,285 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "typeconverter.h"
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QDateTime>
+#include <QColor>
+#include <QUuid>
+#include <QPointF>
+#include <QStringList>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QtEndian>
+#include <cstring>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#include <QCborValue>
+#endif
+
+namespace cg
+{
+
+namespace
+{
+    template <int TypeId>
+    QVariant convertTo(const QVariant &value)
+    {
+        QVariant returnValue = value;
+        returnValue.convert(TypeId);
+        return returnValue;
+    }
+
+    QVariant intToSQLite(const QVariant &value) { return value.toInt(); }
+    QVariant uintToSQLite(const QVariant &value) { return value.toUInt(); }
+    QVariant longLongToSQLite(const QVariant &value) { return value.toLongLong(); }
+    QVariant ulongLongToSQLite(const QVariant &value) { return value.toULongLong(); }
+    QVariant doubleToSQLite(const QVariant &value) { return value.toDouble(); }
+    QVariant stringToSQLite(const QVariant &value) { return value.toString(); }
+    QVariant byteArrayToSQLite(const QVariant &value) { return value.toByteArray(); }
+
+    QVariant dateToSQLite(const QVariant &value) { return value.toDate().toString(Qt::ISODate); }
+    QVariant dateFromSQLite(const QVariant &value) { return QDate::fromString(value.toString(), Qt::ISODate); }
+
+    QVariant timeToSQLite(const QVariant &value) { return value.toTime().toString(Qt::ISODate); }
+    QVariant timeFromSQLite(const QVariant &value) { return QTime::fromString(value.toString(), Qt::ISODate); }
+
+    QVariant dateTimeToSQLite(const QVariant &value) { return value.toDateTime().toString(Qt::ISODate); }
+    QVariant dateTimeFromSQLite(const QVariant &value) { return QDateTime::fromString(value.toString(), Qt::ISODate); }
+
+    QVariant colorToSQLite(const QVariant &value) { return value.value<QColor>().name(); }
+    QVariant colorFromSQLite(const QVariant &value) { return QColor(value.toString()); }
+
+    // text, as in files written before converters, so find() keeps matching existing rows
+    QVariant uuidToSQLite(const QVariant &value) { return value.toUuid().toString(); }
+    QVariant uuidFromSQLite(const QVariant &value) { return QUuid(value.toString()); }
+
+    void appendUInt32(QByteArray &bytes, quint32 value)
+    {
+        char buffer[sizeof(quint32)];
+        qToLittleEndian<quint32>(value, buffer);
+        bytes.append(buffer, sizeof(buffer));
+    }
+
+    // count, then byte length and UTF-8 data of each string
+    QVariant stringListToSQLite(const QVariant &value)
+    {
+        const QStringList list = value.toStringList();
+
+        QByteArray bytes;
+        bytes.reserve(int(sizeof(quint32)) * (list.size() + 1));
+        appendUInt32(bytes, quint32(list.size()));
+
+        for (auto &str : list)
+        {
+            QByteArray utf8 = str.toUtf8();
+            appendUInt32(bytes, quint32(utf8.size()));
+            bytes.append(utf8);
+        }
+
+        return bytes;
+    }
+
+    QVariant stringListFromSQLite(const QVariant &value)
+    {
+        const QByteArray bytes = value.toByteArray();
+        const char *pData = bytes.constData();
+        const char *pEnd = pData + bytes.size();
+
+        QStringList list;
+        if (pEnd - pData < qint64(sizeof(quint32)))
+            return list;
+
+        quint32 count = qFromLittleEndian<quint32>(pData);
+        pData += sizeof(quint32);
+        list.reserve(int(qMin<qint64>(count, (pEnd - pData) / qint64(sizeof(quint32)))));
+
+        for (quint32 i = 0; i < count && pEnd - pData >= qint64(sizeof(quint32)); i++)
+        {
+            quint32 length = qFromLittleEndian<quint32>(pData);
+            pData += sizeof(quint32);
+            if (pEnd - pData < qint64(length))
+                break;
+
+            list.append(QString::fromUtf8(pData, int(length)));
+            pData += length;
+        }
+
+        return list;
+    }
+
+    // CBOR where available, compact JSON text otherwise; both forms are readable
+    QByteArray jsonToBytes(const QJsonDocument &document)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        if (document.isArray())
+            return QCborValue::fromJsonValue(document.array()).toCbor();
+        return QCborValue::fromJsonValue(document.object()).toCbor();
+#else
+        return document.toJson(QJsonDocument::Compact);
+#endif
+    }
+
+    QJsonDocument jsonFromBytes(const QByteArray &bytes)
+    {
+        if (bytes.isEmpty())
+            return QJsonDocument();
+
+        if (bytes.at(0) == '{' || bytes.at(0) == '[')
+            return QJsonDocument::fromJson(bytes);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        QJsonValue json = QCborValue::fromCbor(bytes).toJsonValue();
+        if (json.isArray())
+            return QJsonDocument(json.toArray());
+        return QJsonDocument(json.toObject());
+#else
+        return QJsonDocument();
+#endif
+    }
+
+    QVariant jsonObjectToSQLite(const QVariant &value) { return jsonToBytes(QJsonDocument(value.toJsonObject())); }
+    QVariant jsonObjectFromSQLite(const QVariant &value) { return jsonFromBytes(value.toByteArray()).object(); }
+
+    QVariant jsonArrayToSQLite(const QVariant &value) { return jsonToBytes(QJsonDocument(value.toJsonArray())); }
+    QVariant jsonArrayFromSQLite(const QVariant &value) { return jsonFromBytes(value.toByteArray()).array(); }
+
+    QVariant jsonDocumentToSQLite(const QVariant &value) { return jsonToBytes(value.toJsonDocument()); }
+    QVariant jsonDocumentFromSQLite(const QVariant &value) { return jsonFromBytes(value.toByteArray()); }
+
+    // two little-endian doubles
+    QVariant pointFToSQLite(const QVariant &value)
+    {
+        QPointF point = value.toPointF();
+        double coordinates[2] = { point.x(), point.y() };
+
+        QByteArray bytes(int(sizeof(coordinates)), Qt::Uninitialized);
+        for (int i = 0; i < 2; i++)
+        {
+            quint64 bits;
+            std::memcpy(&bits, &coordinates[i], sizeof(bits));
+            qToLittleEndian<quint64>(bits, bytes.data() + i * sizeof(bits));
+        }
+
+        return bytes;
+    }
+
+    QVariant pointFFromSQLite(const QVariant &value)
+    {
+        const QByteArray bytes = value.toByteArray();
+        if (bytes.size() != 2 * int(sizeof(quint64)))
+            return QPointF();
+
+        double coordinates[2];
+        for (int i = 0; i < 2; i++)
+        {
+            quint64 bits = qFromLittleEndian<quint64>(bytes.constData() + i * sizeof(bits));
+            std::memcpy(&coordinates[i], &bits, sizeof(bits));
+        }
+
+        return QPointF(coordinates[0], coordinates[1]);
+    }
+
+    class ConverterRegistry
+    {
+    public:
+        ConverterRegistry()
+        {
+            const QString integerType("INTEGER");
+            const QString realType("REAL");
+            const QString textType("TEXT");
+            const QString blobType("BLOB");
+
+            m_converters.insert(QMetaType::Bool, TypeConverter(integerType, intToSQLite, convertTo<QMetaType::Bool>));
+            m_converters.insert(QMetaType::Int, TypeConverter(integerType, intToSQLite, convertTo<QMetaType::Int>));
+            m_converters.insert(QMetaType::UInt, TypeConverter(integerType, uintToSQLite, convertTo<QMetaType::UInt>));
+            m_converters.insert(QMetaType::LongLong, TypeConverter(integerType, longLongToSQLite, convertTo<QMetaType::LongLong>));
+            m_converters.insert(QMetaType::ULongLong, TypeConverter(integerType, ulongLongToSQLite, convertTo<QMetaType::ULongLong>));
+            m_converters.insert(QMetaType::Double, TypeConverter(realType, doubleToSQLite, convertTo<QMetaType::Double>));
+            m_converters.insert(QMetaType::Float, TypeConverter(realType, doubleToSQLite, convertTo<QMetaType::Float>));
+            m_converters.insert(QMetaType::QString, TypeConverter(textType, stringToSQLite, convertTo<QMetaType::QString>));
+            m_converters.insert(QMetaType::QChar, TypeConverter(textType, stringToSQLite, convertTo<QMetaType::QChar>));
+            m_converters.insert(QMetaType::QDate, TypeConverter(textType, dateToSQLite, dateFromSQLite));
+            m_converters.insert(QMetaType::QTime, TypeConverter(textType, timeToSQLite, timeFromSQLite));
+            m_converters.insert(QMetaType::QDateTime, TypeConverter(textType, dateTimeToSQLite, dateTimeFromSQLite));
+            m_converters.insert(QMetaType::QColor, TypeConverter(textType, colorToSQLite, colorFromSQLite));
+            m_converters.insert(QMetaType::QByteArray, TypeConverter(blobType, byteArrayToSQLite, convertTo<QMetaType::QByteArray>));
+            m_converters.insert(QMetaType::QUuid, TypeConverter(textType, uuidToSQLite, uuidFromSQLite));
+            m_converters.insert(QMetaType::QStringList, TypeConverter(blobType, stringListToSQLite, stringListFromSQLite));
+            m_converters.insert(QMetaType::QJsonObject, TypeConverter(blobType, jsonObjectToSQLite, jsonObjectFromSQLite));
+            m_converters.insert(QMetaType::QJsonArray, TypeConverter(blobType, jsonArrayToSQLite, jsonArrayFromSQLite));
+            m_converters.insert(QMetaType::QJsonDocument, TypeConverter(blobType, jsonDocumentToSQLite, jsonDocumentFromSQLite));
+            m_converters.insert(QMetaType::QPointF, TypeConverter(blobType, pointFToSQLite, pointFFromSQLite));
+        }
+
+        void insert(int metaTypeId, const TypeConverter &converter)
+        {
+            QWriteLocker locker(&m_lock);
+            m_converters.insert(metaTypeId, converter);
+        }
+
+        void remove(int metaTypeId)
+        {
+            QWriteLocker locker(&m_lock);
+            m_converters.remove(metaTypeId);
+        }
+
+        TypeConverter value(int metaTypeId)
+        {
+            QReadLocker locker(&m_lock);
+            return m_converters.value(metaTypeId);
+        }
+
+    private:
+        QReadWriteLock m_lock;
+        QHash<int, TypeConverter> m_converters;
+    };
+
+    ConverterRegistry & registry()
+    {
+        static ConverterRegistry s_registry;
+        return s_registry;
+    }
+}
+
+TypeConverter::TypeConverter()
+    : m_toFunction(nullptr), m_fromFunction(nullptr)
+{
+}
+
+TypeConverter::TypeConverter(const QString &sqliteType, ToSQLiteFunction toFunction, FromSQLiteFunction fromFunction)
+    : m_sqliteType(sqliteType), m_toFunction(toFunction), m_fromFunction(fromFunction)
+{
+}
+
+void TypeConverter::registerConverter(int metaTypeId, const TypeConverter &converter)
+{
+    registry().insert(metaTypeId, converter);
+}
+
+void TypeConverter::unregisterConverter(int metaTypeId)
+{
+    registry().remove(metaTypeId);
+}
+
+TypeConverter TypeConverter::converter(int metaTypeId)
+{
+    return registry().value(metaTypeId);
+}
+
+}
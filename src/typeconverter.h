@@ -0,0 +1,63 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_TYPECONVERTER_H
+#define CGDATA_TYPECONVERTER_H
+#pragma once
+
+#include "cgdata.h"
+
+#include <QString>
+#include <QVariant>
+
+namespace cg
+{
+    typedef QVariant (*ToSQLiteFunction)(const QVariant &value);
+    typedef QVariant (*FromSQLiteFunction)(const QVariant &value);
+
+    // Maps a property type to an SQLite storage class and a pair of conversion functions.
+    // Converters are looked up by metatype id when a DataManager is constructed, so custom
+    // converters must be registered before then.
+    class CGDATA_API TypeConverter
+    {
+    public:
+        TypeConverter();
+        TypeConverter(const QString &sqliteType, ToSQLiteFunction toFunction, FromSQLiteFunction fromFunction);
+
+        bool isValid() const { return m_toFunction && m_fromFunction; }
+        QString sqliteType() const { return m_sqliteType; }
+
+        QVariant toSQLite(const QVariant &value) const { return m_toFunction(value); }
+        QVariant fromSQLite(const QVariant &value) const { return m_fromFunction(value); }
+
+        static void registerConverter(int metaTypeId, const TypeConverter &converter);
+        static void unregisterConverter(int metaTypeId);
+        static TypeConverter converter(int metaTypeId);
+
+        template <class T>
+        static void registerConverter(const QString &sqliteType, ToSQLiteFunction toFunction, FromSQLiteFunction fromFunction)
+        {
+            registerConverter(qMetaTypeId<T>(), TypeConverter(sqliteType, toFunction, fromFunction));
+        }
+
+    private:
+        QString m_sqliteType;
+        ToSQLiteFunction m_toFunction;
+        FromSQLiteFunction m_fromFunction;
+    };
+
+}
+
+#endif // CGDATA_TYPECONVERTER_H
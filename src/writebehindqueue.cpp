@@ -0,0 +1,290 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "writebehindqueue.h"
+
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+
+namespace cg
+{
+
+WriteBehindQueue::WriteBehindQueue(const QString &databaseName, int batchSize, int flushInterval)
+    : m_databaseName(databaseName), m_batchSize(batchSize), m_flushInterval(flushInterval),
+    m_queuedCount(0), m_writtenCount(0), m_flushRequested(false), m_stopping(false), m_writeFailed(false), m_paused(false)
+{
+    m_connectionName = QString("cgdata_writebehind_%1").arg(qulonglong(quintptr(this)), 0, 16);
+}
+
+WriteBehindQueue::~WriteBehindQueue()
+{
+    stop();
+}
+
+void WriteBehindQueue::enqueueInsert(const QString &tableName, qint64 id, const QString &sql, const QVariantList &values)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Operation operation = { InsertOperation, tableName, id, sql, values };
+    enqueue(operation);
+}
+
+void WriteBehindQueue::enqueueUpdate(const QString &tableName, qint64 id, const QString &sql, const QVariantList &values)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // the last queued insert or update of the row takes the latest values instead, earlier
+    // ones would move the update ahead of the statements queued after them
+    if (!m_operations.isEmpty())
+    {
+        Operation &pending = m_operations.last();
+        if (pending.id == id && pending.tableName == tableName &&
+            ((pending.type == InsertOperation && pending.values.size() == values.size()) ||
+             (pending.type == UpdateOperation && pending.sql == sql)))
+        {
+            pending.values = values;
+            m_queuedCount++;
+            return;
+        }
+    }
+
+    Operation operation = { UpdateOperation, tableName, id, sql, values };
+    enqueue(operation);
+}
+
+void WriteBehindQueue::enqueueDelete(const QString &tableName, qint64 id, const QString &sql)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // pending writes of a deleted row are pointless
+    for (auto & operation : m_operations)
+    {
+        if ((operation.type == InsertOperation || operation.type == UpdateOperation) && operation.id == id && operation.tableName == tableName)
+            operation.type = DroppedOperation;
+    }
+
+    Operation operation = { StatementOperation, tableName, id, sql, QVariantList() << id };
+    enqueue(operation);
+}
+
+void WriteBehindQueue::enqueueStatement(const QString &sql, const QVariantList &values)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Operation operation = { StatementOperation, QString(), 0, sql, values };
+    enqueue(operation);
+}
+
+void WriteBehindQueue::enqueue(const Operation &operation)
+{
+    m_operations.append(operation);
+    m_queuedCount++;
+
+    if (!isRunning() && !m_stopping)
+        start();
+
+    // the first statement starts the flush interval, a full batch ends it early
+    if (m_operations.size() == 1 || m_operations.size() >= m_batchSize)
+        m_queued.wakeAll();
+}
+
+void WriteBehindQueue::setPaused(bool paused)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_paused = paused;
+    m_queued.wakeAll();
+}
+
+void WriteBehindQueue::flush()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_flushRequested = true;
+    m_queued.wakeAll();
+}
+
+bool WriteBehindQueue::waitForDurable(int timeout)
+{
+    QMutexLocker locker(&m_mutex);
+
+    quint64 target = m_queuedCount;
+    if (m_writtenCount >= target)
+    {
+        bool durable = !m_writeFailed;
+        m_writeFailed = false;
+        return durable;
+    }
+
+    m_flushRequested = true;
+    m_queued.wakeAll();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (m_writtenCount < target)
+    {
+        if (timeout < 0)
+        {
+            m_written.wait(&m_mutex);
+        }
+        else
+        {
+            qint64 remaining = timeout - timer.elapsed();
+            if (remaining <= 0 || !m_written.wait(&m_mutex, static_cast<unsigned long>(remaining)))
+                break;
+        }
+    }
+
+    if (m_writtenCount < target)
+        return false;
+
+    // the batch may have been written, but not committed
+    bool durable = !m_writeFailed;
+    m_writeFailed = false;
+    return durable;
+}
+
+void WriteBehindQueue::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_queued.wakeAll();
+    }
+
+    // the writer drains the queue before it exits
+    wait();
+}
+
+void WriteBehindQueue::run()
+{
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+        database.setDatabaseName(m_databaseName);
+        database.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+
+        if (!database.open())
+            qDebug() << "Error: write-behind connection, " << database.lastError();
+
+        forever
+        {
+            QList<Operation> operations;
+            quint64 queuedCount;
+
+            {
+                QMutexLocker locker(&m_mutex);
+
+                while ((m_operations.isEmpty() || m_paused) && !m_stopping)
+                    m_queued.wait(&m_mutex);
+
+                if (m_operations.isEmpty())
+                    break;
+
+                // later writes get the chance to collapse into this batch
+                if (!m_flushRequested && !m_stopping && m_operations.size() < m_batchSize)
+                    m_queued.wait(&m_mutex, static_cast<unsigned long>(m_flushInterval));
+
+                if (m_paused && !m_stopping)
+                    continue;
+
+                operations.swap(m_operations);
+                queuedCount = m_queuedCount;
+                m_flushRequested = false;
+            }
+
+            bool written = write(database, operations);
+
+            QMutexLocker locker(&m_mutex);
+            m_writtenCount = queuedCount;
+            if (!written)
+                m_writeFailed = true;
+            m_written.wakeAll();
+        }
+
+        database.close();
+    }
+
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+bool WriteBehindQueue::write(QSqlDatabase &database, const QList<Operation> &operations)
+{
+    // without a transaction the statements would commit one by one
+    if (!database.transaction())
+    {
+        qDebug() << "Error: write-behind transaction, " << database.lastError();
+        return false;
+    }
+
+    bool success = true;
+
+    // each distinct statement is prepared once per batch
+    QHash<QString, QSqlQuery> queries;
+
+    for (auto & operation : operations)
+    {
+        if (operation.type == DroppedOperation)
+            continue;
+
+        auto it = queries.find(operation.sql);
+        if (it == queries.end())
+        {
+            QSqlQuery query(database);
+            query.prepare(operation.sql);
+            it = queries.insert(operation.sql, query);
+        }
+
+        QSqlQuery &query = it.value();
+
+        if (operation.type == InsertOperation)
+            query.addBindValue(operation.id);
+        for (auto & value : operation.values)
+            query.addBindValue(value);
+        if (operation.type == UpdateOperation)
+            query.addBindValue(operation.id);
+
+        if (!query.exec())
+        {
+            success = false;
+            qDebug() << "Error: write-behind, " << query.lastError();
+            qDebug() << "Query = " << operation.sql;
+            break;
+        }
+    }
+
+    queries.clear();
+
+    // a batch is written as a whole or not at all
+    if (!success)
+    {
+        database.rollback();
+        return false;
+    }
+
+    if (!database.commit())
+    {
+        qDebug() << "Error: write-behind commit, " << database.lastError();
+        database.rollback();
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,93 @@
+/**
+* Copyright 2017 Charles Glancy (charles@glancyfamily.net)
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation
+* files (the "Software"), to deal in the Software without restriction, including  without limitation the rights to use, copy,
+* modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software
+* is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+* WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef CGDATA_WRITEBEHINDQUEUE_H
+#define CGDATA_WRITEBEHINDQUEUE_H
+#pragma once
+
+#include <QList>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QString>
+#include <QThread>
+#include <QVariant>
+#include <QWaitCondition>
+
+namespace cg
+{
+
+    // Statements queued by the calling thread and written by a background thread on its own
+    // connection, in one transaction per batch. A batch is written once batchSize statements
+    // are queued, flushInterval milliseconds after the first one, or when a flush is requested.
+    // An update queued right after an insert or update of the same row that has not been
+    // written yet collapses into it, so statements are never reordered. A batch in which any
+    // statement fails is rolled back as a whole and dropped.
+    class WriteBehindQueue : public QThread
+    {
+    public:
+        WriteBehindQueue(const QString &databaseName, int batchSize, int flushInterval);
+        ~WriteBehindQueue();
+
+        // values are bound in order, followed by id for updates
+        void enqueueInsert(const QString &tableName, qint64 id, const QString &sql, const QVariantList &values);
+        void enqueueUpdate(const QString &tableName, qint64 id, const QString &sql, const QVariantList &values);
+        void enqueueDelete(const QString &tableName, qint64 id, const QString &sql);
+        void enqueueStatement(const QString &sql, const QVariantList &values);
+
+        void flush();
+        // a paused writer keeps queueing, and writes nothing until it is resumed or stopped
+        void setPaused(bool paused);
+        // false on timeout, or when a batch was dropped since the last call
+        bool waitForDurable(int timeout = -1);
+        void stop();
+
+    protected:
+        void run() override;
+
+    private:
+        enum OperationType
+        {
+            InsertOperation,
+            UpdateOperation,
+            StatementOperation,
+            DroppedOperation
+        };
+
+        struct Operation
+        {
+            OperationType type;
+            QString tableName;
+            qint64 id;
+            QString sql;
+            QVariantList values;
+        };
+
+        void enqueue(const Operation &operation);
+        bool write(QSqlDatabase &database, const QList<Operation> &operations);
+
+    private:
+        QString m_databaseName, m_connectionName;
+        int m_batchSize, m_flushInterval;
+
+        QMutex m_mutex;
+        QWaitCondition m_queued, m_written;
+        QList<Operation> m_operations;
+        quint64 m_queuedCount, m_writtenCount;
+        bool m_flushRequested, m_stopping, m_writeFailed, m_paused;
+    };
+
+}
+
+#endif // CGDATA_WRITEBEHINDQUEUE_H
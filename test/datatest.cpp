@@ -20,13 +20,47 @@
 #include "comment.h"
 #include "tag.h"
 #include "userprofile.h"
+#include "blobdevice.h"
+#include "columnkernels.h"
+#include "shardeddatamanager.h"
+#include "datagenerator.h"
+#include "typeconverter.h"
 
+#include <QBuffer>
 #include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSignalSpy>
 #include <QTest>
 #include <QScopedPointer>
+#include <QSemaphore>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QThread>
+
+#include <thread>
 
 using namespace cg;
 
+namespace
+{
+    // stored as "major.minor" text
+    QVariant versionToSQLite(const QVariant &value)
+    {
+        Version version = value.value<Version>();
+        return QString("%1.%2").arg(version.majorVersion).arg(version.minorVersion);
+    }
+
+    QVariant versionFromSQLite(const QVariant &value)
+    {
+        QStringList parts = value.toString().split('.');
+        if (parts.size() != 2)
+            return QVariant();
+
+        return QVariant::fromValue(Version(parts.at(0).toInt(), parts.at(1).toInt()));
+    }
+}
+
 DataTest::DataTest()
     : m_pDataManager(nullptr)
 {
@@ -44,13 +78,24 @@ void DataTest::init()
     QList<const QMetaObject*> metaObjects;
     metaObjects << &Class1::staticMetaObject;
     metaObjects << &Class2::staticMetaObject;
+    metaObjects << &Class3::staticMetaObject;
+    metaObjects << &Class4::staticMetaObject;
+    metaObjects << &Class5::staticMetaObject;
     metaObjects << &User::staticMetaObject;
     metaObjects << &Post::staticMetaObject;
     metaObjects << &Comment::staticMetaObject;
     metaObjects << &Tag::staticMetaObject;
     metaObjects << &UserProfile::staticMetaObject;
 
+    // converters are looked up when the DataManager is constructed
+    TypeConverter::registerConverter<Version>("TEXT", versionToSQLite, versionFromSQLite);
+
     m_pDataManager = new DataManager(metaObjects);
+    m_pDataManager->registerClass<User>();
+    m_pDataManager->registerClass<Post>();
+    m_pDataManager->registerClass<Comment>();
+    m_pDataManager->registerClass<Tag>();
+    m_pDataManager->registerClass<UserProfile>();
 
     QString filePath = "C:\\Temp\\database.db";
     QFile file(filePath);
@@ -137,6 +182,113 @@ void DataTest::testClass1Class2()
     QCOMPARE(count, 0);
 }
 
+void DataTest::testTypeConverters()
+{
+    QUuid testUuid = QUuid::createUuid();
+    QStringList testStringList = QStringList() << "one" << QString() << QString::fromUtf8("dr\xc3\xa9i");
+    QPointF testPoint(1.5, -2.25);
+    QJsonObject testJson;
+    testJson["name"] = "value";
+    testJson["number"] = 42;
+    Version testVersion(2, 15);
+
+    Class3Ptr pObject = m_pDataManager->createObject<Class3>();
+    pObject->setUuidValue(testUuid);
+    pObject->setStringListValue(testStringList);
+    pObject->setPointValue(testPoint);
+    pObject->setJsonValue(testJson);
+    pObject->setVersionValue(testVersion);
+    pObject->update();
+
+    qint64 id = pObject->id();
+    pObject.reset();
+
+    Class3Ptr pFoundObject = m_pDataManager->object<Class3>(id);
+    QVERIFY(pFoundObject != nullptr);
+
+    QCOMPARE(pFoundObject->uuidValue(), testUuid);
+    QCOMPARE(pFoundObject->stringListValue(), testStringList);
+    QCOMPARE(pFoundObject->pointValue(), testPoint);
+    QCOMPARE(pFoundObject->jsonValue(), testJson);
+    QVERIFY(pFoundObject->versionValue() == testVersion);
+
+    QVariantMap map;
+    map["uuidValue"] = testUuid;
+    QCOMPARE(m_pDataManager->find<Class3>(map).size(), 1);
+
+    map.clear();
+    map["versionValue"] = QVariant::fromValue(testVersion);
+    QCOMPARE(m_pDataManager->find<Class3>(map).size(), 1);
+    map["versionValue"] = QVariant::fromValue(Version(2, 16));
+    QCOMPARE(m_pDataManager->find<Class3>(map).size(), 0);
+}
+
+void DataTest::testBlobProperty()
+{
+    QByteArray testData(1024 * 1024, 'x');
+    for (int i = 0; i < testData.size(); i += 4096)
+        testData[i] = char(i / 4096);
+
+    Class4Ptr pObject = m_pDataManager->createObject<Class4>();
+    pObject->setName("Attachment1");
+    pObject->setData(testData);
+    pObject->update();
+
+    qint64 id = pObject->id();
+    pObject.reset();
+
+    // listing leaves the blob unloaded
+    auto list = m_pDataManager->all<Class4>();
+    QCOMPARE(list.size(), 1);
+    Class4Ptr pFoundObject = list.at(0);
+    QCOMPARE(pFoundObject->id(), id);
+    QCOMPARE(pFoundObject->name(), QString("Attachment1"));
+    QVERIFY(!pFoundObject->isPropertyLoaded("data"));
+    QVERIFY(pFoundObject->data().isEmpty());
+
+    // an update must not overwrite the unloaded blob
+    pFoundObject->setName("Attachment2");
+    pFoundObject->update();
+
+    pFoundObject->readProperty("data");
+    QVERIFY(pFoundObject->isPropertyLoaded("data"));
+    QCOMPARE(pFoundObject->data(), testData);
+
+    if (!m_pDataManager->isSQLiteApiAvailable())
+        QSKIP("The QSQLITE driver does not use the SQLite library linked by cgData.");
+
+    // chunked read
+    {
+        QScopedPointer<BlobDevice> pDevice(pFoundObject->openBlob("data", QIODevice::ReadOnly));
+        QVERIFY(pDevice != nullptr);
+        QCOMPARE(pDevice->size(), qint64(testData.size()));
+
+        QByteArray readData;
+        while (!pDevice->atEnd())
+            readData += pDevice->read(64 * 1024);
+        QCOMPARE(readData, testData);
+    }
+
+    // chunked write, reported as an update when the device closes
+    QObject context;
+    int updatedCount = 0;
+    connect(m_pDataManager, &DataManager::objectUpdated, &context, [&updatedCount](DataObjectPtr) { updatedCount++; });
+    QByteArray newData(256 * 1024, 'y');
+    {
+        QScopedPointer<BlobDevice> pDevice(pFoundObject->openBlob("data", QIODevice::WriteOnly, newData.size()));
+        QVERIFY(pDevice != nullptr);
+
+        for (int offset = 0; offset < newData.size(); offset += 64 * 1024)
+            QCOMPARE(pDevice->write(newData.mid(offset, 64 * 1024)), qint64(64 * 1024));
+        QCOMPARE(updatedCount, 0);
+    }
+
+    QCOMPARE(updatedCount, 1);
+    QVERIFY(!pFoundObject->isPropertyLoaded("data"));
+    pFoundObject->readProperty("data");
+    QCOMPARE(pFoundObject->data(), newData);
+}
+
 void DataTest::testDataModel()
 {
     // create
@@ -305,3 +457,1551 @@ void DataTest::testTextSearch()
             QVERIFY(posts.at(0) == pPost2);
     }
 }
+
+
+void DataTest::testLazyProperty()
+{
+    UserPtr pUser1 = m_pDataManager->createObject<User>();
+    pUser1->init("User1", "user1@example.com");
+    pUser1->update();
+
+    for (int i = 0; i < 3; i++)
+    {
+        PostPtr pPost = m_pDataManager->createObject<Post>();
+        pPost->init(pUser1, QString("Post %1").arg(i), QString("The body of post %1.").arg(i));
+        pPost->update();
+    }
+
+    // loaded transparently on first access
+    {
+        Posts posts = m_pDataManager->all<Post>();
+        QCOMPARE(posts.size(), 3);
+
+        PostPtr pPost = posts.at(0);
+        QVERIFY(!pPost->isPropertyLoaded("body"));
+        QCOMPARE(pPost->title(), QString("Post 0"));
+        QCOMPARE(pPost->body(), QString("The body of post 0."));
+        QVERIFY(pPost->isPropertyLoaded("body"));
+    }
+
+    // batch loaded for a whole result set
+    {
+        Posts posts = m_pDataManager->all<Post>();
+        m_pDataManager->readProperty(posts, "body");
+
+        for (int i = 0; i < posts.size(); i++)
+        {
+            QVERIFY(posts.at(i)->isPropertyLoaded("body"));
+            QCOMPARE(posts.at(i)->body(), QString("The body of post %1.").arg(i));
+        }
+    }
+
+    // an update without loading keeps the stored body
+    {
+        Posts posts = m_pDataManager->all<Post>();
+        PostPtr pPost = posts.at(1);
+        pPost->setTitle("Post 1 renamed");
+        pPost->update();
+        qint64 id = pPost->id();
+        posts.clear();
+        pPost.reset();
+
+        pPost = m_pDataManager->object<Post>(id);
+        QCOMPARE(pPost->title(), QString("Post 1 renamed"));
+        QCOMPARE(pPost->body(), QString("The body of post 1."));
+    }
+}
+
+void DataTest::testProjection()
+{
+    QDate testDate(1967, 8, 9);
+
+    for (int i = 0; i < 4; i++)
+    {
+        Class1Ptr pObject = m_pDataManager->createObject<Class1>();
+        pObject->setStringValue(QString("String%1").arg(i));
+        pObject->setBoolValue(i % 2 == 0);
+        pObject->setDoubleValue(i * 0.5);
+        pObject->setDateValue(testDate.addDays(i));
+        pObject->update();
+    }
+
+    DataRows rows = m_pDataManager->select<Class1>(QStringList() << "id" << "stringValue" << "dateValue");
+    QCOMPARE(rows.columnCount(), 3);
+    QCOMPARE(rows.rowCount(), 4);
+    QCOMPARE(rows.values().size(), 12);
+
+    for (int i = 0; i < rows.rowCount(); i++)
+    {
+        QCOMPARE(rows.value(i, "stringValue").toString(), QString("String%1").arg(i));
+        QCOMPARE(rows.value(i, 2).toDate(), testDate.addDays(i));
+    }
+
+    QVariantMap map;
+    map["boolValue"] = true;
+    map["doubleValue"] = 1.0;
+    rows = m_pDataManager->select<Class1>(QStringList() << "stringValue", map);
+    QCOMPARE(rows.rowCount(), 1);
+    QCOMPARE(rows.value(0, 0).toString(), QString("String2"));
+
+    rows = m_pDataManager->select<Class1>(QStringList() << "noSuchColumn");
+    QCOMPARE(rows.rowCount(), 0);
+}
+
+void DataTest::testColumn()
+{
+    if (!m_pDataManager->isSQLiteApiAvailable())
+        QSKIP("The QSQLITE driver does not use the SQLite library linked by cgData.");
+
+    for (int i = 1; i <= 10; i++)
+    {
+        Class2Ptr pObject = m_pDataManager->createObject<Class2>();
+        pObject->setDoubleValue(i * 0.5);
+        pObject->setIntValue(i);
+        pObject->setBoolValue(i > 5);
+        pObject->update();
+    }
+
+    // rows without values are left out rather than read as 0
+    QSqlQuery query(QSqlDatabase::database());
+    QVERIFY(query.exec("INSERT INTO Class2 (boolValue, doubleValue, intValue) VALUES (1, NULL, NULL)"));
+    QVERIFY(query.exec("INSERT INTO Class2 (boolValue, doubleValue, intValue) VALUES (0, NULL, NULL)"));
+
+    bool ok = false;
+    QVector<double> doubleValues = m_pDataManager->column<double>(&Class2::staticMetaObject, "doubleValue", QVariantMap(), &ok);
+    QVERIFY(ok);
+    QCOMPARE(doubleValues.size(), 10);
+    QCOMPARE(columnSum(doubleValues), 27.5);
+
+    double minValue = 0.0, maxValue = 0.0;
+    QVERIFY(columnMinMax(doubleValues, minValue, maxValue));
+    QCOMPARE(minValue, 0.5);
+    QCOMPARE(maxValue, 5.0);
+
+    QVector<qint64> bins = columnHistogram(doubleValues, 0.0, 5.0, 5);
+    QCOMPARE(bins.size(), 5);
+    QCOMPARE(columnSum(bins), qint64(10));
+    QCOMPARE(bins.at(0), qint64(1));
+    QCOMPARE(bins.at(4), qint64(3));
+
+    QVariantMap map;
+    map["boolValue"] = true;
+    QVector<qint64> intValues = m_pDataManager->column<qint64>(&Class2::staticMetaObject, "intValue", map);
+    QCOMPARE(intValues.size(), 5);
+    QCOMPARE(columnSum(intValues), qint64(6 + 7 + 8 + 9 + 10));
+
+    // an unknown column is an error, not an empty table
+    QVERIFY(m_pDataManager->column<qint64>(&Class2::staticMetaObject, "noValue", QVariantMap(), &ok).isEmpty());
+    QVERIFY(!ok);
+}
+
+void DataTest::testRegisterClass()
+{
+    TagPtr pTag = m_pDataManager->createObject<Tag>();
+    QCOMPARE(pTag->property("user").toLongLong(), qint64(0));
+    QVERIFY(pTag->one<User>("user") == nullptr);
+
+    CommentPtr pComment = m_pDataManager->createObject<Comment>();
+    QCOMPARE(pComment->property("user").toLongLong(), qint64(0));
+    QCOMPARE(pComment->property("post").toLongLong(), qint64(0));
+    QVERIFY(pComment->dataManager() == m_pDataManager);
+
+    // objects read back are constructed by the registered factory too
+    qint64 tagId = pTag->id();
+    pTag.reset();
+    pTag = m_pDataManager->object<Tag>(tagId);
+    QVERIFY(pTag != nullptr);
+    QCOMPARE(pTag->id(), tagId);
+    QVERIFY(pTag->dataManager() == m_pDataManager);
+
+    // a DataManager can be built from registered classes alone
+    DataManager registered;
+    registered.registerClass<User>();
+    registered.registerClass<Post>();
+    registered.registerClass<Comment>();
+    registered.registerClass<Tag>();
+    registered.registerClass<UserProfile>();
+    registered.setConnectionName("registered");
+
+    QString path = "C:\\Temp\\registered.db";
+    QFile::remove(path);
+    QVERIFY(registered.open(path));
+
+    UserPtr pUser = registered.createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+
+    PostPtr pPost = registered.createObject<Post>();
+    pPost->init(pUser, "Post1", "Body1");
+    pPost->update();
+    qint64 postId = pPost->id();
+    pPost.reset();
+
+    pPost = registered.object<Post>(postId);
+    QVERIFY(pPost != nullptr);
+    QCOMPARE(pPost->title(), QString("Post1"));
+    QCOMPARE(pPost->one<User>("user"), pUser);
+    QCOMPARE(pUser->many<Post>("posts").size(), 1);
+
+    registered.close();
+}
+
+void DataTest::testObjectPool()
+{
+    QVERIFY(!m_pDataManager->setPoolingEnabled(&Class1::staticMetaObject, true));
+    QVERIFY(m_pDataManager->setPoolingEnabled(&Comment::staticMetaObject, true, 16));
+
+    UserPtr pUser1 = m_pDataManager->createObject<User>();
+    pUser1->init("User1", "user1@example.com");
+    pUser1->update();
+
+    PostPtr pPost1 = m_pDataManager->createObject<Post>();
+    pPost1->init(pUser1, "My first post", "The body of post 1.");
+    pPost1->update();
+
+    for (int i = 0; i < 40; i++)
+    {
+        CommentPtr pComment = m_pDataManager->createObject<Comment>();
+        pComment->init(pUser1, pPost1, QString("Comment %1").arg(i));
+        pComment->update();
+    }
+
+    // slots released by the comments above are reused for the bulk load, so the second pass
+    // hydrates into exactly the slots the first one released
+    QSet<const Comment*> addresses;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        Comments comments = m_pDataManager->all<Comment>();
+        QCOMPARE(comments.size(), 40);
+        QCOMPARE(comments.at(39)->body(), QString("Comment 39"));
+        QVERIFY(comments.at(0)->one<Post>("post") == pPost1);
+
+        for (auto & pComment : comments)
+        {
+            if (pass == 0)
+                addresses.insert(pComment.data());
+            else
+                QVERIFY(addresses.contains(pComment.data()));
+        }
+    }
+    QCOMPARE(addresses.size(), 40);
+
+    Comments comments = pPost1->many<Comment>("comments");
+    QVERIFY(m_pDataManager->setPoolingEnabled(&Comment::staticMetaObject, false));
+    QCOMPARE(comments.size(), 40);
+    comments.clear();
+}
+
+void DataTest::testObjectCache()
+{
+    m_pDataManager->setCacheLimit(&User::staticMetaObject, 3);
+
+    QList<qint64> ids;
+    for (int i = 0; i < 5; i++)
+    {
+        UserPtr pUser = m_pDataManager->createObject<User>();
+        pUser->init(QString("User%1").arg(i), QString("user%1@example.com").arg(i));
+        pUser->update();
+        ids.append(pUser->id());
+    }
+
+    // only the three most recently used users are still cached
+    CacheStatistics statistics = m_pDataManager->cacheStatistics(&User::staticMetaObject);
+    QCOMPARE(statistics.objectCount, 3);
+    QCOMPARE(statistics.evictions, qint64(2));
+
+    // most recently created first, so the two misses do not evict the hits
+    m_pDataManager->resetCacheStatistics();
+    for (int i = 4; i >= 0; i--)
+        QVERIFY(m_pDataManager->object<User>(ids.at(i)) != nullptr);
+
+    statistics = m_pDataManager->cacheStatistics(&User::staticMetaObject);
+    QCOMPARE(statistics.misses, qint64(2));
+    QCOMPARE(statistics.hits, qint64(3));
+
+    // deleting removes the object from the cache
+    UserPtr pUser = m_pDataManager->object<User>(ids.at(4));
+    pUser->del();
+    pUser.reset();
+    QVERIFY(m_pDataManager->object<User>(ids.at(4)) == nullptr);
+
+    // cascade deleted dependents are not served from the cache either
+    pUser = m_pDataManager->object<User>(ids.at(3));
+    m_pDataManager->setCacheLimit(&Post::staticMetaObject, 10);
+    PostPtr pPost = m_pDataManager->createObject<Post>();
+    pPost->init(pUser, "My first post", "The body of post 1.");
+    pPost->update();
+    qint64 postId = pPost->id();
+    pPost.reset();
+
+    pUser->del();
+    QVERIFY(m_pDataManager->object<Post>(postId) == nullptr);
+
+    m_pDataManager->setCacheLimit(1000, DataManager::EstimatedBytesCost);
+    Class1Ptr pObject = m_pDataManager->createObject<Class1>();
+    QVERIFY(m_pDataManager->cacheStatistics(&Class1::staticMetaObject).totalCost > 1);
+
+    // estimating a cost leaves lazy properties unloaded
+    m_pDataManager->setCacheLimit(&Post::staticMetaObject, 100000, DataManager::EstimatedBytesCost);
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    pPost = m_pDataManager->createObject<Post>();
+    pPost->init(pUser2, "My second post", "The body of post 2.");
+    pPost->update();
+    pPost.reset();
+    m_pDataManager->clearCache();
+
+    Posts posts = m_pDataManager->all<Post>();
+    QCOMPARE(posts.size(), 1);
+    QVERIFY(!posts.first()->isPropertyLoaded("body"));
+}
+
+void DataTest::testRelationshipCache()
+{
+    m_pDataManager->setRelationshipCacheLimit(&Post::staticMetaObject, "comments", 100);
+    m_pDataManager->setRelationshipCacheLimit(&Post::staticMetaObject, "tags", 100);
+    m_pDataManager->setRelationshipCacheLimit(&Tag::staticMetaObject, "posts", 100);
+
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+
+    PostPtr pPost1 = m_pDataManager->createObject<Post>();
+    pPost1->init(pUser, "My first post", "The body of post 1.");
+    pPost1->update();
+
+    PostPtr pPost2 = m_pDataManager->createObject<Post>();
+    pPost2->init(pUser, "My second post", "The body of post 2.");
+    pPost2->update();
+
+    // one-to-many lists follow foreign key updates and deletes
+    QCOMPARE(pPost1->many<Comment>("comments").size(), 0);
+    QCOMPARE(pPost2->many<Comment>("comments").size(), 0);
+
+    CommentPtr pComment1 = m_pDataManager->createObject<Comment>();
+    pComment1->init(pUser, pPost1, "Comment 1");
+    pComment1->update();
+
+    // the list was patched, so it is served without a query
+    m_pDataManager->startTrace();
+    QCOMPARE(pPost1->many<Comment>("comments").size(), 1);
+    m_pDataManager->stopTrace();
+    QJsonArray events = QJsonDocument::fromJson(m_pDataManager->traceJson()).object().value("traceEvents").toArray();
+    QCOMPARE(events.size(), 1);
+    QCOMPARE(events.at(0).toObject().value("name").toString(), QString("many"));
+
+    CommentPtr pComment2 = m_pDataManager->createObject<Comment>();
+    pComment2->init(pUser, pPost2, "Comment 2");
+    pComment2->update();
+
+    pComment1->setOne("post", pPost2);
+    pComment1->update();
+
+    QCOMPARE(pPost1->many<Comment>("comments").size(), 0);
+    Comments comments = pPost2->many<Comment>("comments");
+    QCOMPARE(comments.size(), 2);
+    QCOMPARE(comments.at(0), pComment1);
+    QCOMPARE(comments.at(1), pComment2);
+
+    pComment1->del();
+    comments = pPost2->many<Comment>("comments");
+    QCOMPARE(comments.size(), 1);
+    QCOMPARE(comments.at(0), pComment2);
+
+    // members that are no longer in memory are reloaded
+    qint64 commentId = pComment2->id();
+    comments.clear();
+    pComment2.reset();
+    comments = pPost2->many<Comment>("comments");
+    QCOMPARE(comments.size(), 1);
+    QCOMPARE(comments.at(0)->id(), commentId);
+
+    // many-to-many lists are patched on both sides
+    TagPtr pTag = m_pDataManager->createObject<Tag>();
+    pTag->setName("Tag1");
+    pTag->setOne("user", pUser);
+    pTag->update();
+
+    QCOMPARE(pPost1->many<Tag>("tags").size(), 0);
+    QCOMPARE(pTag->many<Post>("posts").size(), 0);
+
+    pPost1->add("tags", pTag);
+    pPost2->add("tags", pTag);
+    QCOMPARE(pPost1->many<Tag>("tags").size(), 1);
+    QCOMPARE(pTag->many<Post>("posts").size(), 2);
+
+    pPost1->remove("tags", pTag);
+    QCOMPARE(pPost1->many<Tag>("tags").size(), 0);
+    QCOMPARE(pTag->many<Post>("posts").size(), 1);
+
+    pPost2->removeAll("tags");
+    QCOMPARE(pTag->many<Post>("posts").size(), 0);
+
+    pPost1->add("tags", pTag);
+    pPost1->del();
+    QCOMPARE(pTag->many<Post>("posts").size(), 0);
+}
+
+void DataTest::testChangeNotifications()
+{
+    QSignalSpy spy(m_pDataManager, &DataManager::changesCommitted);
+    QSignalSpy changedSpy(m_pDataManager, &DataManager::databaseChanged);
+
+    int userNotifications = 0, tagNotifications = 0;
+    QMetaObject::Connection userConnection = m_pDataManager->subscribe(&User::staticMetaObject, this, [&userNotifications](const ChangeSet &) { userNotifications++; });
+    QMetaObject::Connection tagConnection = m_pDataManager->subscribe(&Tag::staticMetaObject, this, [&tagNotifications](const ChangeSet &) { tagNotifications++; });
+
+    // changes are collected until the event loop runs
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+
+    PostPtr pPost = m_pDataManager->createObject<Post>();
+    pPost->init(pUser, "My first post", "The body of post 1.");
+    pPost->update();
+
+    // databaseChanged() still follows every write right away
+    QCOMPARE(changedSpy.count(), 4);
+    QCOMPARE(spy.count(), 0);
+    QTRY_COMPARE(spy.count(), 1);
+
+    ChangeSet changes = spy.at(0).at(0).value<ChangeSet>();
+    QCOMPARE(changes.classNames(), QStringList() << "Post" << "User");
+    QCOMPARE(changes.created("User"), QList<qint64>() << pUser->id());
+    QVERIFY(changes.updated("User").isEmpty());
+    QCOMPARE(changes.created("Post"), QList<qint64>() << pPost->id());
+    QCOMPARE(userNotifications, 1);
+    QCOMPARE(tagNotifications, 0);
+
+    // a transaction is reported once, when it is committed
+    QVERIFY(m_pDataManager->beginTransaction());
+    pUser->setName("User2");
+    pUser->update();
+
+    TagPtr pTag = m_pDataManager->createObject<Tag>();
+    pTag->setName("Tag1");
+    pTag->update();
+
+    QVERIFY(m_pDataManager->beginTransaction());
+    pUser->setEmail("user2@example.com");
+    pUser->update();
+    QVERIFY(m_pDataManager->commitTransaction());
+    QCOMPARE(spy.count(), 1);
+
+    QVERIFY(m_pDataManager->commitTransaction());
+    QCOMPARE(spy.count(), 2);
+
+    changes = spy.at(1).at(0).value<ChangeSet>();
+    QCOMPARE(changes.updated("User"), QList<qint64>() << pUser->id());
+    QCOMPARE(changes.created("Tag"), QList<qint64>() << pTag->id());
+    QVERIFY(!changes.contains("Post"));
+    QCOMPARE(userNotifications, 2);
+    QCOMPARE(tagNotifications, 1);
+
+    // cascade deletes are listed under the dependent class
+    qint64 userId = pUser->id();
+    qint64 postId = pPost->id();
+    pUser->del();
+    QTRY_COMPARE(spy.count(), 3);
+
+    changes = spy.at(2).at(0).value<ChangeSet>();
+    QCOMPARE(changes.deleted("User"), QList<qint64>() << userId);
+    QCOMPARE(changes.deleted("Post"), QList<qint64>() << postId);
+
+    // rolled back changes are not reported
+    QVERIFY(m_pDataManager->beginTransaction());
+    TagPtr pTag2 = m_pDataManager->createObject<Tag>();
+    qint64 tagId = pTag2->id();
+    pTag2.reset();
+    QVERIFY(m_pDataManager->rollbackTransaction());
+
+    QTest::qWait(10);
+    QCOMPARE(spy.count(), 3);
+    QVERIFY(m_pDataManager->object<Tag>(tagId) == nullptr);
+
+    // an inner rollback only undoes its own changes, and objects it changed are read again
+    QVERIFY(m_pDataManager->beginTransaction());
+    pTag->setName("Tag2");
+    pTag->update();
+
+    QVERIFY(m_pDataManager->beginTransaction());
+    pTag->setName("Tag3");
+    pTag->update();
+    TagPtr pTag3 = m_pDataManager->createObject<Tag>();
+    qint64 tag3Id = pTag3->id();
+    pTag3.reset();
+    QVERIFY(m_pDataManager->rollbackTransaction());
+    QCOMPARE(pTag->name(), QString("Tag2"));
+
+    QVERIFY(m_pDataManager->commitTransaction());
+    QTRY_COMPARE(spy.count(), 4);
+
+    changes = spy.at(3).at(0).value<ChangeSet>();
+    QCOMPARE(changes.updated("Tag"), QList<qint64>() << pTag->id());
+    QVERIFY(changes.created("Tag").isEmpty());
+    QVERIFY(m_pDataManager->object<Tag>(tag3Id) == nullptr);
+
+    m_pDataManager->clearCache();
+    QCOMPARE(m_pDataManager->object<Tag>(pTag->id())->name(), QString("Tag2"));
+
+    disconnect(userConnection);
+    disconnect(tagConnection);
+}
+
+void DataTest::testWriteBehind()
+{
+    QVERIFY(m_pDataManager->setWriteBehindEnabled(true, 100, 1000));
+    QVERIFY(m_pDataManager->isWriteBehindEnabled());
+
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+
+    qint64 id = pUser->id();
+    QVERIFY(id > 0);
+
+    // repeated updates collapse into the queued insert
+    for (int i = 0; i < 100; i++)
+    {
+        pUser->setEmail(QString("user%1@example.com").arg(i));
+        pUser->update();
+    }
+
+    QVERIFY(m_pDataManager->waitForDurable(5000));
+
+    QVariantMap map;
+    map.insert("id", id);
+    DataRows rows = m_pDataManager->select<User>(QStringList() << "name" << "email", map);
+    QCOMPARE(rows.rowCount(), 1);
+    QCOMPARE(rows.value(0, "name").toString(), QString("User1"));
+    QCOMPARE(rows.value(0, "email").toString(), QString("user99@example.com"));
+
+    // ids are handed out before the rows exist
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    QCOMPARE(pUser2->id(), id + 1);
+    pUser2->del();
+
+    m_pDataManager->flush();
+    QVERIFY(m_pDataManager->waitForDurable(5000));
+    QCOMPARE(m_pDataManager->all<User>().size(), 1);
+
+    // a batch with a failing statement is rolled back as a whole
+    Class5Ptr pFirst = m_pDataManager->createObject<Class5>();
+    pFirst->setCode("a");
+    pFirst->update();
+
+    UserPtr pUser4 = m_pDataManager->createObject<User>();
+    pUser4->init("User4", "user4@example.com");
+    pUser4->update();
+
+    Class5Ptr pSecond = m_pDataManager->createObject<Class5>();
+    pSecond->setCode("a");
+    pSecond->update();
+
+    QVERIFY(!m_pDataManager->waitForDurable(5000));
+    QCOMPARE(m_pDataManager->all<Class5>().size(), 0);
+    QCOMPARE(m_pDataManager->all<User>().size(), 1);
+    QVERIFY(m_pDataManager->waitForDurable(5000));
+
+    QVERIFY(m_pDataManager->setWriteBehindEnabled(false));
+    QVERIFY(!m_pDataManager->isWriteBehindEnabled());
+    QVERIFY(m_pDataManager->waitForDurable());
+
+    UserPtr pUser3 = m_pDataManager->createObject<User>();
+    QVERIFY(pUser3->id() > id);
+}
+
+void DataTest::testStatistics()
+{
+    QVERIFY(!m_pDataManager->isStatisticsEnabled());
+    m_pDataManager->setStatisticsEnabled(true);
+
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+
+    for (int i = 0; i < 3; i++)
+    {
+        pUser->setName(QString("User%1").arg(i));
+        pUser->update();
+    }
+
+    // the first lookup loads the object, the second finds it in memory
+    qint64 id = pUser->id();
+    pUser.reset();
+    pUser = m_pDataManager->object<User>(id);
+    QVERIFY(pUser != nullptr);
+    QVERIFY(m_pDataManager->object<User>(id) != nullptr);
+
+    pUser->many<Post>("posts");
+    pUser->del();
+
+    DataStatistics statistics = m_pDataManager->statistics();
+    QCOMPARE(statistics.operation(DataStatistics::CreateOperation).count, qint64(1));
+    QCOMPARE(statistics.operation(DataStatistics::UpdateOperation).count, qint64(4));
+    QCOMPARE(statistics.operation(DataStatistics::ManyOperation).count, qint64(1));
+    QCOMPARE(statistics.operation(DataStatistics::DeleteOperation).count, qint64(1));
+    QCOMPARE(statistics.operation(DataStatistics::CascadeOperation).count, qint64(1));
+    QCOMPARE(statistics.identityMapMisses(), qint64(1));
+    QCOMPARE(statistics.identityMapHits(), qint64(1));
+    QCOMPARE(statistics.rowsHydrated(), qint64(1));
+
+    // the update statement is prepared once and reused afterwards
+    QVERIFY(statistics.statementsReused() >= 3);
+
+    const OperationStatistics &updates = statistics.operation(DataStatistics::UpdateOperation);
+    qint64 histogramCount = 0;
+    for (auto count : updates.histogram)
+        histogramCount += count;
+    QCOMPARE(histogramCount, updates.count);
+    QVERIFY(updates.percentileMicroseconds(0.5) <= updates.percentileMicroseconds(1.0));
+
+    m_pDataManager->resetStatistics();
+    QCOMPARE(m_pDataManager->statistics().operation(DataStatistics::CreateOperation).count, qint64(0));
+
+    m_pDataManager->setStatisticsEnabled(false);
+    m_pDataManager->createObject<User>();
+    QCOMPARE(m_pDataManager->statistics().operation(DataStatistics::CreateOperation).count, qint64(0));
+}
+
+void DataTest::testSlowQueryLog()
+{
+    QSignalSpy spy(m_pDataManager, &DataManager::slowQueryRecorded);
+    m_pDataManager->setSlowQueryThreshold(0, 2);
+
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+    QCOMPARE(spy.count(), 0);
+
+    QVariantMap map;
+    map.insert("name", "User1");
+    QCOMPARE(m_pDataManager->find<User>(map).size(), 1);
+    QCOMPARE(spy.count(), 1);
+
+    SlowQuery slowQuery = m_pDataManager->slowQueries().last();
+    QCOMPARE(slowQuery.operation, QString("find"));
+    QVERIFY(slowQuery.sql.contains("WHERE name = ?"));
+    QCOMPARE(slowQuery.values, QVariantList() << "User1");
+    QVERIFY(slowQuery.elapsedMicroseconds >= 0);
+
+    // name has no index, so the plan is a full table scan
+    QVERIFY(!slowQuery.queryPlan.isEmpty());
+    QVERIFY(slowQuery.queryPlan.first().startsWith("SCAN"));
+
+    // only the most recent records are kept
+    m_pDataManager->all<User>();
+    m_pDataManager->all<Post>();
+    QCOMPARE(m_pDataManager->slowQueries().size(), 2);
+    QVERIFY(m_pDataManager->slowQueries().last().sql.contains("FROM Post"));
+
+    m_pDataManager->setSlowQueryRedaction(true);
+    m_pDataManager->clearSlowQueries();
+    m_pDataManager->find<User>(map);
+    QCOMPARE(m_pDataManager->slowQueries().size(), 1);
+    QCOMPARE(m_pDataManager->slowQueries().first().values, QVariantList() << "<redacted>");
+
+    m_pDataManager->setSlowQueryThreshold(-1);
+    m_pDataManager->all<User>();
+    QCOMPARE(m_pDataManager->slowQueries().size(), 1);
+}
+
+void DataTest::testTrace()
+{
+    m_pDataManager->startTrace();
+    QVERIFY(m_pDataManager->isTracing());
+
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+
+    PostPtr pPost = m_pDataManager->createObject<Post>();
+    pPost->init(pUser, "My first post", "The body of post 1.");
+    pPost->update();
+    pPost.reset();
+
+    QCOMPARE(pUser->many<Post>("posts").size(), 1);
+    pUser->del();
+
+    m_pDataManager->stopTrace();
+    QVERIFY(!m_pDataManager->isTracing());
+
+    QJsonDocument document = QJsonDocument::fromJson(m_pDataManager->traceJson());
+    QJsonArray events = document.object().value("traceEvents").toArray();
+    QVERIFY(!events.isEmpty());
+
+    QStringList names;
+    QJsonObject deleteEvent, cascadeEvent;
+    for (auto value : events)
+    {
+        QJsonObject event = value.toObject();
+        QCOMPARE(event.value("ph").toString(), QString("X"));
+        QVERIFY(event.contains("tid"));
+
+        QString name = event.value("name").toString();
+        names.append(name);
+        if (name == "delete")
+            deleteEvent = event;
+        else if (name == "cascade")
+            cascadeEvent = event;
+    }
+
+    QVERIFY(names.contains("create"));
+    QVERIFY(names.contains("many"));
+    QVERIFY(names.contains("prepare"));
+    QVERIFY(names.contains("step"));
+    QVERIFY(names.contains("hydrate"));
+
+    // the cascade runs inside the delete span
+    double deleteStart = deleteEvent.value("ts").toDouble();
+    double deleteEnd = deleteStart + deleteEvent.value("dur").toDouble();
+    double cascadeStart = cascadeEvent.value("ts").toDouble();
+    double cascadeEnd = cascadeStart + cascadeEvent.value("dur").toDouble();
+    QVERIFY(cascadeStart >= deleteStart);
+    QVERIFY(cascadeEnd <= deleteEnd + 0.001);
+
+    // nothing is recorded once tracing stops
+    m_pDataManager->createObject<User>();
+    QCOMPARE(QJsonDocument::fromJson(m_pDataManager->traceJson()).object().value("traceEvents").toArray().size(), events.size());
+}
+
+void DataTest::testBackup()
+{
+    if (!m_pDataManager->isSQLiteApiAvailable())
+        QSKIP("The QSQLITE driver does not use the SQLite library linked by cgData.");
+
+    QString backupPath = "C:\\Temp\\backup.db";
+    QString snapshotPath = "C:\\Temp\\snapshot.db";
+    QFile::remove(backupPath);
+    QFile::remove(snapshotPath);
+
+    for (int i = 0; i < 100; i++)
+    {
+        PostPtr pPost = m_pDataManager->createObject<Post>();
+        pPost->init(UserPtr(), QString("Post %1").arg(i), QString(1000, QChar('x')));
+        pPost->update();
+    }
+
+    QSignalSpy spy(m_pDataManager, &DataManager::backupFinished);
+
+    // a page per step, writing in between steps
+    int steps = 0;
+    QVERIFY(m_pDataManager->backupTo(backupPath, 1, [this, &steps](int remaining, int pageCount) {
+        Q_UNUSED(remaining);
+        Q_UNUSED(pageCount);
+        if (steps++ == 2)
+            m_pDataManager->createObject<User>()->update();
+        return true;
+    }));
+    QVERIFY(m_pDataManager->isBackupRunning());
+    QVERIFY(!m_pDataManager->backupTo(backupPath));
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).toBool(), true);
+    QVERIFY(steps > 2);
+    QVERIFY(!m_pDataManager->isBackupRunning());
+
+    QVERIFY(m_pDataManager->snapshotTo(snapshotPath));
+    QVERIFY(QFile::exists(snapshotPath));
+
+    // both copies include the user created during the backup
+    for (auto & path : QStringList() << backupPath << snapshotPath)
+    {
+        {
+            QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "backup");
+            database.setDatabaseName(path);
+            QVERIFY(database.open());
+
+            QSqlQuery query(database);
+            QVERIFY(query.exec("SELECT COUNT(*) FROM Post"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 100);
+
+            QVERIFY(query.exec("SELECT COUNT(*) FROM User"));
+            QVERIFY(query.next());
+            QCOMPARE(query.value(0).toInt(), 1);
+        }
+        QSqlDatabase::removeDatabase("backup");
+    }
+
+    // a cancelled backup leaves no file behind
+    QVERIFY(m_pDataManager->backupTo("C:\\Temp\\cancelled.db", 1, [](int, int) { return false; }));
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(1).toBool(), false);
+    QVERIFY(!QFile::exists("C:\\Temp\\cancelled.db"));
+}
+
+void DataTest::testInMemory()
+{
+    if (!m_pDataManager->isSQLiteApiAvailable())
+        QSKIP("The QSQLITE driver does not use the SQLite library linked by cgData.");
+
+    QString snapshotPath = "C:\\Temp\\snapshot.db";
+    QFile::remove(snapshotPath);
+
+    m_pDataManager->close();
+    QVERIFY(m_pDataManager->openInMemory(snapshotPath));
+    QVERIFY(m_pDataManager->isInMemory());
+
+    // the schema is created even though no file exists
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+    qint64 userId = pUser->id();
+    pUser.reset();
+
+    QVERIFY(m_pDataManager->saveSnapshot());
+    QVERIFY(QFile::exists(snapshotPath));
+
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    pUser2->init("User2", "user2@example.com");
+    pUser2->update();
+    pUser2.reset();
+
+    // close saves the latest state, which is loaded again on the next open
+    m_pDataManager->close();
+    QVERIFY(!m_pDataManager->isInMemory());
+
+    QVERIFY(m_pDataManager->openInMemory(snapshotPath, 50));
+    QCOMPARE(m_pDataManager->all<User>().size(), 2);
+    QCOMPARE(m_pDataManager->object<User>(userId)->name(), QString("User1"));
+
+    // and it is saved periodically
+    QFile::remove(snapshotPath);
+    QTRY_VERIFY(QFile::exists(snapshotPath));
+
+    m_pDataManager->close();
+    QVERIFY(!QFile::exists(snapshotPath + ".bak"));
+
+    // a save interrupted between moving the old snapshot aside and renaming the new one
+    QVERIFY(QFile::rename(snapshotPath, snapshotPath + ".bak"));
+    QVERIFY(m_pDataManager->openInMemory(snapshotPath));
+    QCOMPARE(m_pDataManager->all<User>().size(), 2);
+
+    m_pDataManager->close();
+    QVERIFY(QFile::exists(snapshotPath));
+    QVERIFY(!QFile::exists(snapshotPath + ".bak"));
+
+    // without a snapshot path nothing is kept
+    QVERIFY(m_pDataManager->openInMemory());
+    QVERIFY(m_pDataManager->all<User>().isEmpty());
+    QVERIFY(!m_pDataManager->saveSnapshot());
+}
+
+void DataTest::testImportExport()
+{
+    UserPtr pUser1 = m_pDataManager->createObject<User>();
+    pUser1->init("User1", "user1@example.com");
+    pUser1->update();
+
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    pUser2->init("Smith, \"Two\"", "user2@example.com");
+    pUser2->update();
+
+    PostPtr pPost = m_pDataManager->createObject<Post>();
+    pPost->init(pUser2, "Line one\nline two", "The body of post 1.");
+    pPost->update();
+
+    TagPtr pTag = m_pDataManager->createObject<Tag>();
+    pTag->setName("Tag1");
+    pTag->update();
+    pPost->add("tags", pTag);
+
+    qint64 user2Id = pUser2->id();
+    qint64 postId = pPost->id();
+    qint64 tagId = pTag->id();
+
+    QBuffer users, posts, tags, postTags;
+    users.open(QIODevice::ReadWrite);
+    posts.open(QIODevice::ReadWrite);
+    tags.open(QIODevice::ReadWrite);
+    postTags.open(QIODevice::ReadWrite);
+
+    QCOMPARE(m_pDataManager->exportTo(&User::staticMetaObject, &users, DataManager::CsvFormat), 2);
+    QCOMPARE(m_pDataManager->exportTo(&Post::staticMetaObject, &posts, DataManager::JsonLinesFormat), 1);
+    QCOMPARE(m_pDataManager->exportTo(&Tag::staticMetaObject, &tags, DataManager::CsvFormat), 1);
+    QCOMPARE(m_pDataManager->exportTo(&Post::staticMetaObject, "tags", &postTags, DataManager::JsonLinesFormat), 1);
+    QCOMPARE(m_pDataManager->exportTo(&Post::staticMetaObject, "title", &postTags, DataManager::JsonLinesFormat), -1);
+    QVERIFY(users.data().startsWith("id,"));
+
+    pUser1.reset();
+    pUser2.reset();
+    pPost.reset();
+    pTag.reset();
+
+    // into an empty database
+    m_pDataManager->close();
+    QFile::remove("C:\\Temp\\database.db");
+    m_pDataManager->open("C:\\Temp\\database.db");
+
+    users.seek(0);
+    posts.seek(0);
+    tags.seek(0);
+    postTags.seek(0);
+    QCOMPARE(m_pDataManager->importFrom(&User::staticMetaObject, &users, DataManager::CsvFormat, 1), 2);
+    QCOMPARE(m_pDataManager->importFrom(&Post::staticMetaObject, &posts, DataManager::JsonLinesFormat), 1);
+    QCOMPARE(m_pDataManager->importFrom(&Tag::staticMetaObject, &tags, DataManager::CsvFormat), 1);
+    QCOMPARE(m_pDataManager->importFrom(&Post::staticMetaObject, "tags", &postTags, DataManager::JsonLinesFormat), 1);
+
+    UserPtr pImported = m_pDataManager->object<User>(user2Id);
+    QVERIFY(pImported != nullptr);
+    QCOMPARE(pImported->name(), QString("Smith, \"Two\""));
+
+    Posts importedPosts = pImported->many<Post>("posts");
+    QCOMPARE(importedPosts.size(), 1);
+    QCOMPARE(importedPosts.at(0)->id(), postId);
+    QCOMPARE(importedPosts.at(0)->title(), QString("Line one\nline two"));
+    QCOMPARE(importedPosts.at(0)->body(), QString("The body of post 1."));
+
+    Tags importedTags = importedPosts.at(0)->many<Tag>("tags");
+    QCOMPARE(importedTags.size(), 1);
+    QCOMPARE(importedTags.at(0)->id(), tagId);
+
+    // new objects continue after the imported ids, and imported rows are searchable
+    UserPtr pUser3 = m_pDataManager->createObject<User>();
+    QVERIFY(pUser3->id() > user2Id);
+    QCOMPARE(m_pDataManager->textSearch<Post>("body").size(), 1);
+
+    // a failing import is rolled back
+    QBuffer duplicate;
+    duplicate.setData("id,name\r\n100,New\r\n" + QByteArray::number(user2Id) + ",Duplicate\r\n");
+    duplicate.open(QIODevice::ReadOnly);
+    bool ok = true;
+    QCOMPARE(m_pDataManager->importFrom(&User::staticMetaObject, &duplicate, DataManager::CsvFormat, 10000, &ok), 0);
+    QVERIFY(!ok);
+    QVERIFY(m_pDataManager->object<User>(100) == nullptr);
+
+    // with smaller chunks only the failing one is, earlier ones stay committed
+    duplicate.seek(0);
+    QCOMPARE(m_pDataManager->importFrom(&User::staticMetaObject, &duplicate, DataManager::CsvFormat, 1, &ok), 1);
+    QVERIFY(!ok);
+    QVERIFY(m_pDataManager->object<User>(100) != nullptr);
+
+    // NULL and empty strings survive CSV, integers beyond 2^53 survive JSON
+    QBuffer nulls;
+    nulls.setData("id,name,email\r\n200,,\"\"\r\n");
+    nulls.open(QIODevice::ReadOnly);
+    QCOMPARE(m_pDataManager->importFrom(&User::staticMetaObject, &nulls, DataManager::CsvFormat, 10000, &ok), 1);
+    QVERIFY(ok);
+
+    QBuffer exported;
+    exported.open(QIODevice::ReadWrite);
+    m_pDataManager->exportTo(&User::staticMetaObject, &exported, DataManager::CsvFormat);
+    QVERIFY(exported.data().contains("\r\n200,,\"\"\r\n"));
+
+    QBuffer bigIds;
+    bigIds.setData("{\"id\":\"9007199254740993\",\"name\":\"Big\"}\n");
+    bigIds.open(QIODevice::ReadOnly);
+    QCOMPARE(m_pDataManager->importFrom(&Tag::staticMetaObject, &bigIds, DataManager::JsonLinesFormat), 1);
+    QVERIFY(m_pDataManager->object<Tag>(Q_INT64_C(9007199254740993)) != nullptr);
+
+    QBuffer exportedTags;
+    exportedTags.open(QIODevice::ReadWrite);
+    m_pDataManager->exportTo(&Tag::staticMetaObject, &exportedTags, DataManager::JsonLinesFormat);
+    QVERIFY(exportedTags.data().contains("\"id\":\"9007199254740993\""));
+}
+
+void DataTest::testShardedDataManager()
+{
+    QList<const QMetaObject*> metaObjects;
+    metaObjects << &User::staticMetaObject;
+    metaObjects << &Post::staticMetaObject;
+    metaObjects << &Comment::staticMetaObject;
+    metaObjects << &Tag::staticMetaObject;
+    metaObjects << &UserProfile::staticMetaObject;
+
+    ShardedDataManager sharded(metaObjects, 3);
+    sharded.registerClass<User>();
+    sharded.registerClass<Post>();
+    sharded.registerClass<Comment>();
+    sharded.registerClass<Tag>();
+    sharded.setClassShard(&Tag::staticMetaObject, 0);
+
+    QStringList paths;
+    for (int i = 0; i < sharded.shardCount(); i++)
+    {
+        paths << QString("C:\\Temp\\shard%1.db").arg(i);
+        QFile::remove(paths.last());
+    }
+
+    // shards use their own connections, next to the default one
+    QVERIFY(sharded.open(paths));
+    QVERIFY(m_pDataManager->isOpen());
+
+    Users users;
+    QSet<qint64> ids;
+    for (int i = 0; i < 6; i++)
+    {
+        UserPtr pUser = sharded.createObject<User>();
+        pUser->init(QString("User%1").arg(i), QString("user%1@example.com").arg(i));
+        pUser->update();
+        QCOMPARE(sharded.shardOf(pUser->id()), i % 3);
+        QCOMPARE(pUser->dataManager(), sharded.shard(i % 3));
+        users.append(pUser);
+        ids.insert(pUser->id());
+    }
+    QCOMPARE(ids.size(), 6);
+
+    QCOMPARE(sharded.object<User>(users.at(4)->id()), users.at(4));
+
+    // related objects live in the same shard
+    PostPtr pPost = sharded.createObject<Post>(sharded.shardOf(users.at(2)->id()));
+    pPost->init(users.at(2), "Sharded post", "The body of the sharded post.");
+    pPost->update();
+    QCOMPARE(users.at(2)->many<Post>("posts").size(), 1);
+
+    TagPtr pTag1 = sharded.createObject<Tag>();
+    TagPtr pTag2 = sharded.createObject<Tag>();
+    QCOMPARE(sharded.shardOf(pTag1->id()), 0);
+    QCOMPARE(sharded.shardOf(pTag2->id()), 0);
+
+    // fan-out queries merge every shard's results in id order
+    Users allUsers = sharded.all<User>();
+    QCOMPARE(allUsers.size(), 6);
+    for (int i = 1; i < allUsers.size(); i++)
+        QVERIFY(allUsers.at(i - 1)->id() < allUsers.at(i)->id());
+
+    QVariantMap map;
+    map.insert("name", "User5");
+    Users found = sharded.find<User>(map);
+    QCOMPARE(found.size(), 1);
+    QCOMPARE(found.at(0), users.at(5));
+
+    Posts posts = sharded.textSearch<Post>("sharded");
+    QCOMPARE(posts.size(), 1);
+    QCOMPARE(posts.at(0)->id(), pPost->id());
+
+    // matches are merged on their bm25 rank, not taken from each shard in turn
+    PostPtr pWeakPost = sharded.createObject<Post>(0);
+    pWeakPost->init(users.at(0), "Weak post", "A longer body that names the sharded word once among many other words.");
+    pWeakPost->update();
+    PostPtr pStrongPost = sharded.createObject<Post>(1);
+    pStrongPost->init(users.at(1), "Sharded sharded", "Sharded sharded.");
+    pStrongPost->update();
+
+    posts = sharded.textSearch<Post>("sharded");
+    QCOMPARE(posts.size(), 3);
+    QCOMPARE(posts.at(0), pStrongPost);
+    QCOMPARE(posts.at(1), pPost);
+    QCOMPARE(posts.at(2), pWeakPost);
+
+    // The shards are read at once on threads of their own: while shard 0 waits for a lock
+    // held by another connection, the other shards have already been read.
+    for (int i = 0; i < sharded.shardCount(); i++)
+        sharded.shard(i)->startTrace();
+
+    QSemaphore locked;
+    bool lockTaken = false;
+    std::thread locker([&]()
+    {
+        {
+            QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "shardlocker");
+            database.setDatabaseName(paths.at(0));
+            database.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+            QSqlQuery query(database);
+            lockTaken = database.open() && query.exec("BEGIN EXCLUSIVE");
+            locked.release();
+
+            QThread::msleep(500);
+            query.exec("COMMIT");
+        }
+        QSqlDatabase::removeDatabase("shardlocker");
+    });
+
+    locked.acquire();
+    allUsers = sharded.all<User>();
+    locker.join();
+    QVERIFY(lockTaken);
+    QCOMPARE(allUsers.size(), 6);
+
+    // thread ids pass through JSON as doubles
+    double callerThread = double(quint64(quintptr(QThread::currentThreadId())));
+    QSet<double> readerThreads;
+    QList<QJsonObject> steps;
+    for (int i = 0; i < sharded.shardCount(); i++)
+    {
+        sharded.shard(i)->stopTrace();
+        for (auto value : QJsonDocument::fromJson(sharded.shard(i)->traceJson()).object().value("traceEvents").toArray())
+        {
+            QJsonObject event = value.toObject();
+            if (event.value("name").toString() == "step")
+            {
+                steps.append(event);
+                readerThreads.insert(event.value("tid").toDouble());
+            }
+        }
+        QCOMPARE(steps.size(), i + 1);
+    }
+
+    QCOMPARE(readerThreads.size(), 3);
+    QVERIFY(!readerThreads.contains(callerThread));
+
+    double lockedEnd = steps.at(0).value("ts").toDouble() + steps.at(0).value("dur").toDouble();
+    QVERIFY(steps.at(0).value("dur").toDouble() >= 400000);
+    for (int i = 1; i < steps.size(); i++)
+        QVERIFY(steps.at(i).value("ts").toDouble() + steps.at(i).value("dur").toDouble() < lockedEnd - 250000);
+
+    QCOMPARE(sharded.all<Tag>().size(), 2);
+
+    sharded.close();
+    QVERIFY(!sharded.isOpen());
+}
+
+void DataTest::testArchive()
+{
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+
+    PostPtr pOldPost = m_pDataManager->createObject<Post>();
+    pOldPost->init(pUser, "Old post", "An archived body.");
+    pOldPost->update();
+    qint64 oldPostId = pOldPost->id();
+
+    PostPtr pNewPost = m_pDataManager->createObject<Post>();
+    pNewPost->init(pUser, "New post", "A hot body.");
+    pNewPost->update();
+
+    QString archivePath = "C:\\Temp\\archive.db";
+    QFile::remove(archivePath);
+    QVERIFY(m_pDataManager->attachArchive(archivePath));
+    QVERIFY(m_pDataManager->isArchiveAttached());
+
+    m_pDataManager->setArchivePolicy(&Post::staticMetaObject, "title = 'Old post'");
+    QCOMPARE(m_pDataManager->archive(1), Q_INT64_C(1));
+    QCOMPARE(m_pDataManager->archive(1), Q_INT64_C(0));
+
+    // queries read the hot table unless asked otherwise
+    QCOMPARE(m_pDataManager->all<Post>().size(), 1);
+    QCOMPARE(m_pDataManager->all<Post>(true).size(), 2);
+
+    QVariantMap map;
+    map.insert("title", "Old post");
+    QCOMPARE(m_pDataManager->find<Post>(map).size(), 0);
+    QCOMPARE(m_pDataManager->find<Post>(map, true).size(), 1);
+    QCOMPARE(m_pDataManager->textSearch<Post>("archived").size(), 0);
+    QCOMPARE(m_pDataManager->textSearch<Post>("hot").size(), 1);
+
+    // lookups by id and relationships still reach archived rows
+    pOldPost.reset();
+    pNewPost.reset();
+    QCOMPARE(pUser->many<Post>("posts").size(), 2);
+
+    PostPtr pArchived = m_pDataManager->object<Post>(oldPostId);
+    QVERIFY(pArchived != nullptr);
+    QCOMPARE(pArchived->body(), QString("An archived body."));
+
+    pArchived->setTitle("Old post, edited");
+    pArchived->update();
+    map.insert("title", "Old post, edited");
+    QCOMPARE(m_pDataManager->find<Post>(map, true).size(), 1);
+    pArchived.reset();
+
+    // and so do cascading deletes
+    pUser->del();
+    QCOMPARE(m_pDataManager->all<Post>(true).size(), 0);
+
+    // new ids stay above archived ones, also while the archive is detached
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    PostPtr pLastPost = m_pDataManager->createObject<Post>();
+    pLastPost->init(pUser2, "Last post", "The last body.");
+    pLastPost->update();
+    qint64 lastPostId = pLastPost->id();
+
+    m_pDataManager->setArchivePolicy(&Post::staticMetaObject, "title = 'Last post'");
+    QCOMPARE(m_pDataManager->archive(), Q_INT64_C(1));
+    QVERIFY(m_pDataManager->createObject<Post>()->id() > lastPostId);
+
+    // archived dependents still in memory are dropped by the cascade too
+    pUser2->del();
+    QVERIFY(m_pDataManager->object<Post>(lastPostId) == nullptr);
+    pLastPost.reset();
+
+    m_pDataManager->detachArchive();
+    QVERIFY(!m_pDataManager->isArchiveAttached());
+
+    m_pDataManager->close();
+    m_pDataManager->open("C:\\Temp\\database.db");
+    QVERIFY(m_pDataManager->createObject<Post>()->id() > lastPostId);
+}
+
+void DataTest::testChangeDetection()
+{
+    QVERIFY(m_pDataManager->setChangeDetectionEnabled(true, 10));
+    QVERIFY(m_pDataManager->isChangeDetectionEnabled());
+
+    UserPtr pUser1 = m_pDataManager->createObject<User>();
+    pUser1->init("User1", "user1@example.com");
+    pUser1->update();
+
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    pUser2->init("User2", "user2@example.com");
+    pUser2->update();
+
+    // a second connection to the same file stands in for another process
+    QList<const QMetaObject*> metaObjects;
+    metaObjects << &User::staticMetaObject;
+    metaObjects << &Post::staticMetaObject;
+    metaObjects << &Comment::staticMetaObject;
+    metaObjects << &Tag::staticMetaObject;
+    metaObjects << &UserProfile::staticMetaObject;
+
+    DataManager other(metaObjects);
+    other.setConnectionName("other");
+    QVERIFY(other.open("C:\\Temp\\database.db"));
+
+    QObject context;
+    DataObjects updated, deleted;
+    connect(m_pDataManager, &DataManager::objectUpdated, &context, [&updated](DataObjectPtr pObject) { updated.append(pObject); });
+    connect(m_pDataManager, &DataManager::objectDeleted, &context, [&deleted](DataObjectPtr pObject) { deleted.append(pObject); });
+
+    // writes through this connection are not reported again
+    pUser1->setEmail("first@example.com");
+    pUser1->update();
+    QCOMPARE(updated.size(), 1);
+    m_pDataManager->checkForChanges();
+    QCOMPARE(updated.size(), 1);
+
+    UserPtr pOtherUser1 = other.object<User>(pUser1->id());
+    pOtherUser1->setName("Renamed");
+    pOtherUser1->update();
+    other.object<User>(pUser2->id())->del();
+
+    m_pDataManager->checkForChanges();
+    QCOMPARE(updated.size(), 2);
+    QCOMPARE(updated.last(), DataObjectPtr(pUser1));
+    QCOMPARE(pUser1->name(), QString("Renamed"));
+    QCOMPARE(pUser1->email(), QString("first@example.com"));
+    QCOMPARE(deleted.size(), 1);
+    QVERIFY(m_pDataManager->object<User>(pUser2->id()) == nullptr);
+
+    // the poll timer picks up later commits by itself
+    pOtherUser1->setName("Renamed again");
+    pOtherUser1->update();
+    QTRY_COMPARE(pUser1->name(), QString("Renamed again"));
+
+    other.close();
+    QVERIFY(m_pDataManager->setChangeDetectionEnabled(false));
+
+    // without detection or capture the log is dropped and stops growing
+    qint64 sequence = m_pDataManager->lastChangeSequence();
+    pUser1->setName("Not logged");
+    pUser1->update();
+    QCOMPARE(m_pDataManager->lastChangeSequence(), sequence);
+    QVERIFY(m_pDataManager->changesSince(0).isEmpty());
+}
+
+void DataTest::testChangeCapture()
+{
+    QVERIFY(!m_pDataManager->isChangeCaptureEnabled());
+    QVERIFY(m_pDataManager->setChangeCaptureEnabled(true));
+    QVERIFY(m_pDataManager->isChangeCaptureEnabled());
+
+    qint64 sequence = m_pDataManager->lastChangeSequence();
+
+    UserPtr pUser = m_pDataManager->createObject<User>();
+    pUser->init("User1", "user1@example.com");
+    pUser->update();
+    qint64 userId = pUser->id();
+    pUser->del();
+
+    // read in batches from the last sequence processed
+    QList<ChangeRecord> changes = m_pDataManager->changesSince(sequence, 2);
+    QCOMPARE(changes.size(), 2);
+    QCOMPARE(changes.at(0).className, QString("User"));
+    QCOMPARE(changes.at(0).id, userId);
+    QCOMPARE(changes.at(0).type, ChangeRecord::Inserted);
+    QCOMPARE(changes.at(1).type, ChangeRecord::Updated);
+    QVERIFY(changes.at(0).sequence < changes.at(1).sequence);
+
+    sequence = changes.last().sequence;
+    changes = m_pDataManager->changesSince(sequence, 2);
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).id, userId);
+    QCOMPARE(changes.at(0).type, ChangeRecord::Deleted);
+    QCOMPARE(changes.at(0).sequence, m_pDataManager->lastChangeSequence());
+
+    // consumed history is removed, later entries keep counting up
+    sequence = changes.last().sequence;
+    QVERIFY(m_pDataManager->truncateChanges(sequence));
+    QCOMPARE(m_pDataManager->changesSince(0).size(), 0);
+    QCOMPARE(m_pDataManager->lastChangeSequence(), sequence);
+
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    changes = m_pDataManager->changesSince(sequence);
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).sequence, sequence + 1);
+
+    // archive moves are logged as such, and writes to archived rows are logged too
+    QString archivePath = "C:\\Temp\\archive.db";
+    QFile::remove(archivePath);
+    QVERIFY(m_pDataManager->attachArchive(archivePath));
+
+    sequence = m_pDataManager->lastChangeSequence();
+    m_pDataManager->setArchivePolicy(&User::staticMetaObject, QString("id = %1").arg(pUser2->id()));
+    QCOMPARE(m_pDataManager->archive(), Q_INT64_C(1));
+    pUser2->setName("Archived");
+    pUser2->update();
+
+    changes = m_pDataManager->changesSince(sequence);
+    QCOMPARE(changes.size(), 2);
+    QCOMPARE(changes.at(0).id, pUser2->id());
+    QCOMPARE(changes.at(0).type, ChangeRecord::Archived);
+    QCOMPARE(changes.at(1).id, pUser2->id());
+    QCOMPARE(changes.at(1).type, ChangeRecord::Updated);
+    m_pDataManager->detachArchive();
+
+    QVERIFY(m_pDataManager->setChangeCaptureEnabled(false));
+    QVERIFY(!m_pDataManager->isChangeCaptureEnabled());
+
+    // with change detection off as well nothing is logged any more
+    sequence = m_pDataManager->lastChangeSequence();
+    UserPtr pUser3 = m_pDataManager->createObject<User>();
+    QCOMPARE(m_pDataManager->lastChangeSequence(), sequence);
+}
+
+void DataTest::testUpsert()
+{
+    QObject context;
+    int createdCount = 0, updatedCount = 0;
+    connect(m_pDataManager, &DataManager::objectCreated, &context, [&createdCount](DataObjectPtr) { createdCount++; });
+    connect(m_pDataManager, &DataManager::objectUpdated, &context, [&updatedCount](DataObjectPtr) { updatedCount++; });
+
+    // matched on a unique key
+    Class5Ptr pObject = Class5Ptr::create();
+    pObject->setCode("a");
+    pObject->setValue(1);
+    QCOMPARE(m_pDataManager->upsert(pObject, "code"), pObject);
+    QVERIFY(pObject->id() > 0);
+    QCOMPARE(pObject->dataManager(), m_pDataManager);
+    QCOMPARE(m_pDataManager->object<Class5>(pObject->id()), pObject);
+    QCOMPARE(createdCount, 1);
+
+    Class5Ptr pSameCode = Class5Ptr::create();
+    pSameCode->setCode("a");
+    pSameCode->setValue(2);
+    QCOMPARE(m_pDataManager->upsert(pSameCode, "code"), pObject);
+    QCOMPARE(pObject->value(), 2);
+    QCOMPARE(createdCount, 1);
+    QCOMPARE(updatedCount, 1);
+
+    // matched on id
+    Class5Ptr pWithId = Class5Ptr::create();
+    pWithId->setProperty("id", 100);
+    pWithId->setCode("b");
+    QCOMPARE(m_pDataManager->upsert(pWithId), pWithId);
+    QCOMPARE(pWithId->id(), Q_INT64_C(100));
+    QCOMPARE(createdCount, 2);
+
+    pWithId->setValue(5);
+    m_pDataManager->upsert(pWithId);
+    QCOMPARE(updatedCount, 2);
+
+    pWithId.reset();
+    QCOMPARE(m_pDataManager->object<Class5>(100)->value(), 5);
+
+    // keys that are neither id nor unique are refused
+    QVERIFY(m_pDataManager->upsert(Class5Ptr::create(), "value") == nullptr);
+    QVERIFY(m_pDataManager->upsert(Class5Ptr::create()) == nullptr);
+
+    Class5Ptr pFirst = Class5Ptr::create();
+    pFirst->setCode("a");
+    pFirst->setValue(3);
+    Class5Ptr pSecond = Class5Ptr::create();
+    pSecond->setCode("c");
+
+    // the keys of a batch are looked up with one query
+    m_pDataManager->startTrace();
+    QList<Class5Ptr> upserted = m_pDataManager->upsertMany(QList<Class5Ptr>() << pFirst << pSecond, "code");
+    m_pDataManager->stopTrace();
+    QCOMPARE(upserted.size(), 2);
+    QCOMPARE(upserted.at(0), pObject);
+    QCOMPARE(upserted.at(1), pSecond);
+    QCOMPARE(pObject->value(), 3);
+    QCOMPARE(m_pDataManager->all<Class5>().size(), 3);
+    QCOMPARE(createdCount, 3);
+    QCOMPARE(updatedCount, 3);
+
+    int selectCount = 0;
+    for (auto value : QJsonDocument::fromJson(m_pDataManager->traceJson()).object().value("traceEvents").toArray())
+    {
+        QJsonObject event = value.toObject();
+        if (event.value("name").toString() == "step" && event.value("args").toObject().value("sql").toString().startsWith("SELECT"))
+            selectCount++;
+    }
+    QCOMPARE(selectCount, 1);
+
+    // a key repeated in a batch updates the row its first object created
+    Class5Ptr pRepeated1 = Class5Ptr::create();
+    pRepeated1->setCode("e");
+    Class5Ptr pRepeated2 = Class5Ptr::create();
+    pRepeated2->setCode("e");
+    pRepeated2->setValue(7);
+    upserted = m_pDataManager->upsertMany(QList<Class5Ptr>() << pRepeated1 << pRepeated2, "code");
+    QCOMPARE(upserted.size(), 2);
+    QCOMPARE(upserted.at(0), pRepeated1);
+    QCOMPARE(upserted.at(1), pRepeated1);
+    QCOMPARE(pRepeated1->value(), 7);
+    QCOMPARE(m_pDataManager->all<Class5>().size(), 4);
+    QCOMPARE(createdCount, 4);
+    QCOMPARE(updatedCount, 4);
+
+    // an object with a row of its own does not take over another row
+    qint64 objectId = pObject->id();
+    pObject->setCode("c");
+    QVERIFY(m_pDataManager->upsert(pObject, "code") == nullptr);
+    pObject->setCode("d");
+    QVERIFY(m_pDataManager->upsert(pObject, "code") == nullptr);
+    QCOMPARE(pObject->id(), objectId);
+    QCOMPARE(m_pDataManager->object<Class5>(objectId), pObject);
+    QCOMPARE(m_pDataManager->all<Class5>().size(), 4);
+}
+
+void DataTest::testIdBlocks()
+{
+    m_pDataManager->setIdBlockSize(&User::staticMetaObject, 10);
+    m_pDataManager->setIdBlockSize(&Post::staticMetaObject, 10);
+    m_pDataManager->setIdBlockSize(&Comment::staticMetaObject, 10);
+    m_pDataManager->setIdBlockSize(&Tag::staticMetaObject, 2);
+
+    QVERIFY(m_pDataManager->createPending<Class1>() == nullptr);
+
+    // a whole graph is built and linked before anything is written
+    UserPtr pUser = m_pDataManager->createPending<User>();
+    QVERIFY(pUser->id() > 0);
+    pUser->init("User1", "user1@example.com");
+
+    PostPtr pPost = m_pDataManager->createPending<Post>();
+    pPost->init(pUser, "Post1", "Body1");
+
+    CommentPtr pComment = m_pDataManager->createPending<Comment>();
+    pComment->init(pUser, pPost, "Comment1");
+
+    Tags tags;
+    for (int i = 0; i < 3; i++)
+    {
+        TagPtr pTag = m_pDataManager->createPending<Tag>();
+        pTag->setName(QString("Tag%1").arg(i));
+        pPost->add("tags", pTag);
+        if (i > 0)
+            QCOMPARE(pTag->id(), tags.last()->id() + 1);
+        tags.append(pTag);
+    }
+
+    TagPtr pDropped = m_pDataManager->createPending<Tag>();
+    pPost->add("tags", pDropped);
+    pDropped->del();
+
+    QCOMPARE(m_pDataManager->pendingCount(), 6);
+    QCOMPARE(m_pDataManager->all<Post>().size(), 0);
+    QCOMPARE(m_pDataManager->object<Post>(pPost->id()), pPost);
+    QCOMPARE(pComment->one<Post>("post"), pPost);
+
+    QVERIFY(m_pDataManager->persistPending());
+    QCOMPARE(m_pDataManager->pendingCount(), 0);
+    QCOMPARE(m_pDataManager->all<Post>().size(), 1);
+    QCOMPARE(m_pDataManager->all<Tag>().size(), 3);
+    QCOMPARE(pUser->many<Post>("posts").size(), 1);
+    QCOMPARE(pPost->many<Comment>("comments").size(), 1);
+    QCOMPARE(pPost->many<Tag>("tags").size(), 3);
+
+    // objects created the usual way take ids from the same blocks
+    UserPtr pUser2 = m_pDataManager->createObject<User>();
+    QCOMPARE(pUser2->id(), pUser->id() + 1);
+
+    TagPtr pDiscarded = m_pDataManager->createPending<Tag>();
+    qint64 discardedId = pDiscarded->id();
+    m_pDataManager->discardPending();
+    QCOMPARE(m_pDataManager->pendingCount(), 0);
+    pDiscarded.reset();
+    QVERIFY(m_pDataManager->object<Tag>(discardedId) == nullptr);
+
+    // the rest of a block is skipped after reopening, never handed out twice
+    qint64 lastUserId = pUser2->id();
+    m_pDataManager->close();
+    QVERIFY(m_pDataManager->open("C:\\Temp\\database.db"));
+    QVERIFY(m_pDataManager->createObject<User>()->id() >= lastUserId + 9);
+
+    // a block reserved in a rolled-back transaction is handed out again, so the pending
+    // objects holding its ids are dropped
+    QVERIFY(m_pDataManager->beginTransaction());
+    TagPtr pRolledBack = m_pDataManager->createPending<Tag>();
+    qint64 rolledBackId = pRolledBack->id();
+    QVERIFY(m_pDataManager->rollbackTransaction());
+    QCOMPARE(m_pDataManager->pendingCount(), 0);
+
+    TagPtr pTag = m_pDataManager->createPending<Tag>();
+    QCOMPARE(pTag->id(), rolledBackId);
+    QCOMPARE(m_pDataManager->object<Tag>(rolledBackId), pTag);
+
+    // inside a transaction the objects are announced when it commits
+    QObject context;
+    int createdCount = 0;
+    connect(m_pDataManager, &DataManager::objectCreated, &context, [&createdCount](DataObjectPtr) { createdCount++; });
+
+    QVERIFY(m_pDataManager->beginTransaction());
+    QVERIFY(m_pDataManager->persistPending());
+    QCOMPARE(createdCount, 0);
+    QVERIFY(m_pDataManager->commitTransaction());
+    QCOMPARE(createdCount, 1);
+    QCOMPARE(m_pDataManager->all<Tag>().size(), 4);
+
+    // and not at all when it is rolled back
+    TagPtr pTag2 = m_pDataManager->createPending<Tag>();
+    QVERIFY(m_pDataManager->beginTransaction());
+    QVERIFY(m_pDataManager->persistPending());
+    QVERIFY(m_pDataManager->rollbackTransaction());
+    QCOMPARE(createdCount, 1);
+    QCOMPARE(m_pDataManager->all<Tag>().size(), 4);
+}
+
+void DataTest::testDataGenerator()
+{
+    GeneratorOptions options;
+    options.seed = 42;
+    options.users = 20;
+    options.tags = 20;
+    options.vocabularySize = 500;
+    options.batchSize = 5;
+
+    m_pDataManager->setCacheLimit(&User::staticMetaObject, 5, DataManager::EstimatedBytesCost);
+
+    DataGenerator generator(options);
+    GeneratorReport report = generator.populate(m_pDataManager);
+    QCOMPARE(report.users, qint64(20));
+    QCOMPARE(report.tags, qint64(20));
+
+    // the caller's cache limit is restored
+    QCOMPARE(m_pDataManager->cacheLimit(&User::staticMetaObject), 5);
+    QCOMPARE(m_pDataManager->cacheCost(&User::staticMetaObject), DataManager::EstimatedBytesCost);
+
+    // the same seed produces the same data
+    DataManager generated;
+    generated.registerClass<User>();
+    generated.registerClass<Post>();
+    generated.registerClass<Comment>();
+    generated.registerClass<Tag>();
+    generated.registerClass<UserProfile>();
+    generated.setConnectionName("generated");
+
+    QString path = "C:\\Temp\\generated.db";
+    QFile::remove(path);
+    QVERIFY(generated.open(path));
+
+    DataGenerator generator2(options);
+    GeneratorReport report2 = generator2.populate(&generated);
+    QCOMPARE(report2.rows(), report.rows());
+    QCOMPARE(report2.comments, report.comments);
+    QCOMPARE(report2.tagLinks, report.tagLinks);
+
+    QStringList names = QStringList() << "id" << "title" << "body";
+    DataRows posts = m_pDataManager->select<Post>(names, QVariantMap());
+    DataRows posts2 = generated.select<Post>(names, QVariantMap());
+    QCOMPARE(posts2.rowCount(), posts.rowCount());
+    for (int i = 0; i < posts.rowCount(); i++)
+    {
+        for (auto & name : names)
+            QCOMPARE(posts2.value(i, name), posts.value(i, name));
+    }
+
+    generated.close();
+}
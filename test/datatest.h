@@ -23,6 +23,10 @@
 #include <QTime>
 #include <QDateTime>
 #include <QColor>
+#include <QUuid>
+#include <QPointF>
+#include <QStringList>
+#include <QJsonObject>
 
 namespace cg
 {
@@ -94,6 +98,87 @@ private:
 
 typedef QSharedPointer<Class2> Class2Ptr;
 
+// a user type with no built-in converter
+struct Version
+{
+    Version(int majorVersion = 0, int minorVersion = 0)
+        : majorVersion(majorVersion), minorVersion(minorVersion) {}
+
+    bool operator==(const Version &other) const { return majorVersion == other.majorVersion && minorVersion == other.minorVersion; }
+
+    int majorVersion;
+    int minorVersion;
+};
+
+Q_DECLARE_METATYPE(Version)
+
+class Class3 : public cg::DataObject
+{
+    Q_OBJECT
+    QD_PROPERTY(uuidValue, QUuid, m_uuidValue)
+    QD_PROPERTY(stringListValue, QStringList, m_stringListValue)
+    QD_PROPERTY(pointValue, QPointF, m_pointValue)
+    QD_PROPERTY(jsonValue, QJsonObject, m_jsonValue)
+    QD_PROPERTY(versionValue, Version, m_versionValue)
+
+public:
+    Q_INVOKABLE Class3() {}
+
+    QUuid uuidValue() const { return m_uuidValue; }
+    void setUuidValue(const QUuid &uuid) { m_uuidValue = uuid; }
+
+    QStringList stringListValue() const { return m_stringListValue; }
+    void setStringListValue(const QStringList &list) { m_stringListValue = list; }
+
+    QPointF pointValue() const { return m_pointValue; }
+    void setPointValue(const QPointF &point) { m_pointValue = point; }
+
+    QJsonObject jsonValue() const { return m_jsonValue; }
+    void setJsonValue(const QJsonObject &json) { m_jsonValue = json; }
+
+    Version versionValue() const { return m_versionValue; }
+    void setVersionValue(const Version &version) { m_versionValue = version; }
+};
+
+typedef QSharedPointer<Class3> Class3Ptr;
+
+class Class4 : public cg::DataObject
+{
+    Q_OBJECT
+    QD_PROPERTY(name, QString, m_name)
+    QD_BLOB_PROPERTY(data, m_data)
+
+public:
+    Q_INVOKABLE Class4() {}
+
+    QString name() const { return m_name; }
+    void setName(const QString &name) { m_name = name; }
+
+    QByteArray data() const { return qd_get_data(); }
+    void setData(const QByteArray &data) { qd_set_data(data); }
+};
+
+typedef QSharedPointer<Class4> Class4Ptr;
+
+class Class5 : public cg::DataObject
+{
+    Q_OBJECT
+    QD_UNIQUE(code)
+    QD_PROPERTY(code, QString, m_code)
+    QD_PROPERTY(value, int, m_value)
+
+public:
+    Q_INVOKABLE Class5() : m_value(0) {}
+
+    QString code() const { return m_code; }
+    void setCode(const QString &code) { m_code = code; }
+
+    int value() const { return m_value; }
+    void setValue(int value) { m_value = value; }
+};
+
+typedef QSharedPointer<Class5> Class5Ptr;
+
 class DataTest : public QObject
 {
     Q_OBJECT
@@ -105,8 +190,32 @@ private slots:
     void init();
     void cleanup();
     void testClass1Class2();
+    void testTypeConverters();
+    void testBlobProperty();
     void testDataModel();
     void testTextSearch();
+    void testLazyProperty();
+    void testProjection();
+    void testColumn();
+    void testRegisterClass();
+    void testObjectPool();
+    void testObjectCache();
+    void testRelationshipCache();
+    void testChangeNotifications();
+    void testWriteBehind();
+    void testStatistics();
+    void testSlowQueryLog();
+    void testTrace();
+    void testBackup();
+    void testInMemory();
+    void testImportExport();
+    void testShardedDataManager();
+    void testArchive();
+    void testChangeDetection();
+    void testChangeCapture();
+    void testUpsert();
+    void testIdBlocks();
+    void testDataGenerator();
 
 private:
     cg::DataManager *m_pDataManager;
@@ -23,6 +23,6 @@ void Post::init(UserPtr pUser, const QString & title, const QString & body)
 {
     setOne("user", pUser);
     m_title = title;
-    m_body = body;
+    setBody(body);
 }
 
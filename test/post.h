@@ -24,7 +24,7 @@ class Post : public cg::DataObject
 {
     Q_OBJECT
     QD_PROPERTY(title, QString, m_title)
-    QD_PROPERTY(body, QString, m_body)
+    QD_LAZY_PROPERTY(body, QString, m_body)
     QD_MANY_TO_ONE_RELATIONSHIP(user, User, posts)
     QD_ONE_TO_MANY_RELATIONSHIP(comments, Comment, post)
     QD_MANY_TO_MANY_RELATIONSHIP(tags, Tag, posts)
@@ -37,8 +37,8 @@ public:
     QString title() const { return m_title; }
     void setTitle(const QString &title) { m_title = title; }
 
-    QString body() const { return m_body; }
-    void setBody(const QString &body) { m_body = body; }
+    QString body() const { return qd_get_body(); }
+    void setBody(const QString &body) { qd_set_body(body); }
 };
 
 #endif // CGDATA_POST_H
\ No newline at end of file
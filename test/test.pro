@@ -6,6 +6,7 @@ CONFIG += testcase
 TEMPLATE = app
 
 HEADERS += datatest.h \
+	../generator/datagenerator.h \
 	comment.h \
 	datatypes.h \
 	post.h \
@@ -14,6 +15,7 @@ HEADERS += datatest.h \
 	userprofile.h
 	
 SOURCES += datatest.cpp \
+	../generator/datagenerator.cpp \
 	comment.cpp \
     main.cpp \
 	post.cpp \
@@ -21,7 +23,7 @@ SOURCES += datatest.cpp \
 	user.cpp \
 	userprofile.cpp
 
-INCLUDEPATH += ../src
+INCLUDEPATH += ../src ../generator
 
 CONFIG(debug, debug|release) {
     LIBS += -L../src/debug -lcgData0